@@ -0,0 +1,23 @@
+#include <benchmark/benchmark.h>
+
+#include <filesystem>
+
+int main(int argc, char** argv) {
+    std::filesystem::path previous_directory = std::filesystem::current_path();
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "search_engine_benchmarks";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    std::filesystem::current_path(directory);
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+
+    std::filesystem::current_path(previous_directory);
+    std::filesystem::remove_all(directory);
+
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include "Indexer/LevenshteinAutomaton.hpp"
+#include "Indexer/MappedIndex.hpp"
+#include "SyntheticCorpus.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr size_t kCountTerms = 2'000'000;
+constexpr size_t kCountQueries = 256;
+
+const std::string kPathMappedIndex = "fuzzy_benchmark.map";
+
+struct FuzzyFixture {
+    std::vector<std::string> terms;
+    std::vector<std::string> queries;
+    std::unique_ptr<MappedIndex> mapped_index;
+};
+
+FuzzyFixture& GetFuzzyFixture() {
+    static FuzzyFixture fixture = []() {
+        FuzzyFixture result;
+        SyntheticCorpus corpus(kCountTerms);
+        result.terms = corpus.Terms();
+        std::sort(result.terms.begin(), result.terms.end());
+
+        MappedIndex::Builder builder(kPathMappedIndex, {{0, "document"}}, {{0, result.terms.size()}});
+        const std::vector<uint64_t> file_ids = {0};
+        const std::vector<uint64_t> lines_size = {1};
+        const std::vector<uint64_t> lines = {1};
+        for (const std::string& term : result.terms) {
+            builder.AddTerm(term, file_ids, lines_size, lines);
+        }
+        builder.Finish();
+        result.mapped_index = std::make_unique<MappedIndex>(kPathMappedIndex);
+
+        for (size_t i = 0; i < kCountQueries; ++i) {
+            result.queries.push_back(corpus.Misspell(result.terms[corpus.UniformIndex(result.terms.size())]));
+        }
+
+        return result;
+    }();
+
+    return fixture;
+}
+
+std::vector<FuzzyTerm> LinearScan(const std::vector<std::string>& terms, const std::string& word,
+                                  size_t max_distance) {
+    LevenshteinAutomaton automaton(word, max_distance);
+    LevenshteinAutomaton::State state;
+    LevenshteinAutomaton::State next;
+    std::vector<FuzzyTerm> result;
+    for (const std::string& term : terms) {
+        state = automaton.Start();
+        for (char symbol : term) {
+            automaton.Step(state, symbol, next);
+            std::swap(state, next);
+        }
+        if (automaton.IsMatch(state)) {
+            result.push_back(FuzzyTerm{term, automaton.Distance(state)});
+        }
+    }
+    LevenshteinAutomaton::SelectClosest(result, LevenshteinAutomaton::kMaxExpansions);
+
+    return result;
+}
+
+void ExpandFuzzy(benchmark::State& state) {
+    FuzzyFixture& fixture = GetFuzzyFixture();
+    size_t query = 0;
+    size_t count_matches = 0;
+    for (auto _ : state) {
+        count_matches += fixture.mapped_index->ExpandFuzzy(fixture.queries[query], state.range(0)).size();
+        query = (query + 1) % fixture.queries.size();
+    }
+    state.counters["matches"] = benchmark::Counter(static_cast<double>(count_matches),
+                                                   benchmark::Counter::kAvgIterations);
+}
+
+void ExpandFuzzyLinearScan(benchmark::State& state) {
+    FuzzyFixture& fixture = GetFuzzyFixture();
+    size_t query = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(LinearScan(fixture.terms, fixture.queries[query], state.range(0)));
+        query = (query + 1) % fixture.queries.size();
+    }
+}
+
+}
+
+BENCHMARK(ExpandFuzzy)->DenseRange(1, LevenshteinAutomaton::kMaxDistance)->Unit(benchmark::kMicrosecond);
+BENCHMARK(ExpandFuzzyLinearScan)->DenseRange(1, LevenshteinAutomaton::kMaxDistance)->Iterations(5)
+    ->Unit(benchmark::kMillisecond);
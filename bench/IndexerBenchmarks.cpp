@@ -0,0 +1,153 @@
+#include "Indexer/Indexer.hpp"
+#include "Indexer/Ties.hpp"
+#include "Indexer/Tokenizer.hpp"
+#include "SyntheticCorpus.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr size_t kCountTerms = 50'000;
+constexpr size_t kCountLines = 200;
+
+const std::string kFileNameTies = "benchmark_trie.bin";
+
+struct Occurrence {
+    std::string word;
+    size_t index;
+    size_t value;
+};
+
+std::vector<Occurrence> GenerateOccurrences(size_t count_occurrences) {
+    SyntheticCorpus corpus(kCountTerms);
+    std::vector<Occurrence> occurrences;
+    occurrences.reserve(count_occurrences);
+    for (size_t i = 0; i < count_occurrences; ++i) {
+        occurrences.push_back(Occurrence{corpus.SampleTerm(), i / 1'000, i % kCountLines});
+    }
+
+    return occurrences;
+}
+
+Ties BuildTies(const std::vector<Occurrence>& occurrences) {
+    Ties ties;
+    for (const Occurrence& occurrence : occurrences) {
+        ties.insert(occurrence.word, occurrence.index, occurrence.value);
+    }
+
+    return ties;
+}
+
+void TiesPush(benchmark::State& state) {
+    SyntheticCorpus corpus(state.range(0));
+    for (auto _ : state) {
+        Ties ties;
+        for (const std::string& term : corpus.Terms()) {
+            ties.push(term);
+        }
+        benchmark::DoNotOptimize(ties.CountNode());
+    }
+    state.SetItemsProcessed(state.iterations() * corpus.Terms().size());
+}
+
+void TiesInsert(benchmark::State& state) {
+    std::vector<Occurrence> occurrences = GenerateOccurrences(state.range(0));
+    for (auto _ : state) {
+        Ties ties = BuildTies(occurrences);
+        benchmark::DoNotOptimize(ties.CountNode());
+    }
+    state.SetItemsProcessed(state.iterations() * occurrences.size());
+}
+
+void TiesSearch(benchmark::State& state) {
+    SyntheticCorpus corpus(kCountTerms);
+    Ties ties = BuildTies(GenerateOccurrences(state.range(0)));
+
+    std::vector<std::string> queries;
+    for (size_t i = 0; i < 4'096; ++i) {
+        queries.push_back(corpus.UniformIndex(4) == 0 ? corpus.Misspell(corpus.SampleTerm()) : corpus.SampleTerm());
+    }
+
+    size_t query = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ties.search(queries[query]));
+        query = (query + 1) % queries.size();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void SaveTies(benchmark::State& state) {
+    Ties ties = BuildTies(GenerateOccurrences(state.range(0)));
+    for (auto _ : state) {
+        ties.SaveTies(kFileNameTies);
+    }
+    state.SetBytesProcessed(state.iterations() * std::filesystem::file_size(kFileNameTies));
+    std::filesystem::remove(kFileNameTies);
+}
+
+void ReadTiesFromFile(benchmark::State& state) {
+    BuildTies(GenerateOccurrences(state.range(0))).SaveTies(kFileNameTies);
+    for (auto _ : state) {
+        Ties ties(kFileNameTies);
+        benchmark::DoNotOptimize(ties.CountNode());
+    }
+    state.SetBytesProcessed(state.iterations() * std::filesystem::file_size(kFileNameTies));
+    std::filesystem::remove(kFileNameTies);
+}
+
+void Tokenize(benchmark::State& state) {
+    SyntheticCorpus corpus(kCountTerms);
+    std::string content = corpus.GenerateFile(state.range(0));
+    std::vector<char> buffer(content.size());
+    size_t count_words = 0;
+    for (auto _ : state) {
+        std::copy(content.begin(), content.end(), buffer.begin());
+        Tokenizer tokenizer(buffer.data(), buffer.size());
+        std::string_view word;
+        count_words = 0;
+        while (tokenizer.Next(word)) {
+            ++count_words;
+        }
+        benchmark::DoNotOptimize(count_words);
+    }
+    state.SetBytesProcessed(state.iterations() * content.size());
+    state.counters["words"] = static_cast<double>(count_words);
+}
+
+void SaveWordsFromFile(benchmark::State& state) {
+    SyntheticCorpus corpus(kCountTerms);
+    std::vector<std::filesystem::path> files = corpus.WriteTree("corpus", state.range(0), kCountLines);
+    size_t count_bytes = 0;
+    for (const std::filesystem::path& file : files) {
+        count_bytes += std::filesystem::file_size(file);
+    }
+
+    for (auto _ : state) {
+        auto indexer = std::make_unique<Indexer<true>>();
+        for (size_t file_id = 0; file_id < files.size(); ++file_id) {
+            indexer->SaveWordsFromFile(files[file_id], file_id);
+        }
+        benchmark::DoNotOptimize(indexer->CountDocuments());
+        state.PauseTiming();
+        indexer.reset();
+        state.ResumeTiming();
+    }
+    state.SetBytesProcessed(state.iterations() * count_bytes);
+    state.SetItemsProcessed(state.iterations() * files.size());
+    std::filesystem::remove_all("corpus");
+}
+
+}
+
+BENCHMARK(TiesPush)->Arg(10'000)->Arg(100'000)->Unit(benchmark::kMillisecond);
+BENCHMARK(TiesInsert)->Arg(100'000)->Arg(1'000'000)->Unit(benchmark::kMillisecond);
+BENCHMARK(TiesSearch)->Arg(1'000'000);
+BENCHMARK(SaveTies)->Arg(100'000)->Arg(1'000'000)->Unit(benchmark::kMillisecond);
+BENCHMARK(ReadTiesFromFile)->Arg(100'000)->Arg(1'000'000)->Unit(benchmark::kMillisecond);
+BENCHMARK(Tokenize)->Arg(1'000)->Arg(10'000);
+BENCHMARK(SaveWordsFromFile)->Arg(64)->Arg(256)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,82 @@
+#include "ParserArgument/ParserArgument.hpp"
+#include "ParserArgument/QueryPlan.hpp"
+#include "SyntheticCorpus.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+constexpr size_t kCountDocuments = 1'000'000;
+
+const std::vector<std::vector<std::string>> kQueries = {
+    {"rare1", "AND", "common1"},
+    {"common1", "AND", "medium1", "AND", "common2", "AND", "rare2"},
+    {"(", "common1", "OR", "common2", ")", "AND", "rare1"},
+    {"common1", "OR", "medium1", "OR", "medium2"},
+    {"(", "medium1", "OR", "medium2", ")", "AND", "(", "medium3", "OR", "common1", ")", "AND", "rare2"},
+    {"(", "common1", "OR", "common2", ")", "AND", "missing"},
+    {"common1", "AND", "(", "common2", "OR", "medium1", ")"}
+};
+
+std::unordered_map<std::string, std::vector<size_t>>& FileWordsAndIndexes() {
+    static std::unordered_map<std::string, std::vector<size_t>> file_words_and_indexes = []() {
+        SyntheticCorpus corpus(1);
+        return std::unordered_map<std::string, std::vector<size_t>>{
+            {"common1", corpus.Postings(500'000, kCountDocuments)},
+            {"common2", corpus.Postings(400'000, kCountDocuments)},
+            {"medium1", corpus.Postings(50'000, kCountDocuments)},
+            {"medium2", corpus.Postings(20'000, kCountDocuments)},
+            {"medium3", corpus.Postings(10'000, kCountDocuments)},
+            {"rare1", corpus.Postings(100, kCountDocuments)},
+            {"rare2", corpus.Postings(1'000, kCountDocuments)}
+        };
+    }();
+
+    return file_words_and_indexes;
+}
+
+ParserArgument CreateParserArgument(benchmark::State& state) {
+    const std::vector<std::string>& query = kQueries[state.range(0)];
+    std::string label;
+    for (const std::string& token : query) {
+        label += (label.empty() ? "" : " ") + token;
+    }
+    state.SetLabel(label);
+
+    ParserArgument parser_argument;
+    parser_argument.CreateStackRequest(query);
+
+    return parser_argument;
+}
+
+void ExpressionCalculation(benchmark::State& state) {
+    ParserArgument parser_argument = CreateParserArgument(state);
+    auto& file_words_and_indexes = FileWordsAndIndexes();
+    size_t count_documents = 0;
+    for (auto _ : state) {
+        count_documents = parser_argument.ExpressionCalculation(file_words_and_indexes).size();
+        benchmark::DoNotOptimize(count_documents);
+    }
+    state.counters["docs"] = static_cast<double>(count_documents);
+}
+
+void QueryPlanExecute(benchmark::State& state) {
+    ParserArgument parser_argument = CreateParserArgument(state);
+    auto& file_words_and_indexes = FileWordsAndIndexes();
+    size_t count_documents = 0;
+    for (auto _ : state) {
+        QueryPlan query_plan(parser_argument, file_words_and_indexes);
+        count_documents = query_plan.Execute().size();
+        benchmark::DoNotOptimize(count_documents);
+    }
+    state.counters["docs"] = static_cast<double>(count_documents);
+}
+
+}
+
+BENCHMARK(ExpressionCalculation)->DenseRange(0, kQueries.size() - 1)->Unit(benchmark::kMicrosecond);
+BENCHMARK(QueryPlanExecute)->DenseRange(0, kQueries.size() - 1)->Unit(benchmark::kMicrosecond);
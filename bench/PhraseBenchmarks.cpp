@@ -0,0 +1,95 @@
+#include "Indexer/Indexer.hpp"
+#include "Indexer/MappedIndex.hpp"
+#include "Indexer/PostingCodec.hpp"
+#include "ParserArgument/ParserArgument.hpp"
+#include "Searcher/Searcher.hpp"
+#include "SyntheticCorpus.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+constexpr size_t kCountTerms = 5'000;
+constexpr size_t kCountFiles = 1'024;
+constexpr size_t kCountLines = 200;
+
+const std::string kDirectoryCorpus = "phrase_corpus";
+
+const std::vector<std::string> kQueries = {
+    "\"const int\"",
+    "\"static const int\"",
+    "return NEXT int",
+    "std NEAR/3 template",
+    "\"const int\" AND typename",
+    "\"const int\" OR \"return int\""
+};
+
+struct PhraseFixture {
+    std::unique_ptr<MappedIndex> mapped_index;
+};
+
+PhraseFixture& GetPhraseFixture() {
+    static PhraseFixture fixture = []() {
+        SyntheticCorpus corpus(kCountTerms);
+        corpus.WriteTree(kDirectoryCorpus, kCountFiles, kCountLines);
+        {
+            Indexer<true> indexer;
+            indexer.StartIndexer(kDirectoryCorpus);
+        }
+        std::filesystem::remove_all(kDirectoryCorpus);
+
+        PhraseFixture result;
+        result.mapped_index = std::make_unique<MappedIndex>();
+        return result;
+    }();
+
+    return fixture;
+}
+
+void PhraseQuery(benchmark::State& state) {
+    const MappedIndex& mapped_index = *GetPhraseFixture().mapped_index;
+    const std::string& query = kQueries[state.range(0)];
+    state.SetLabel(query);
+
+    ParserArgument parser_argument;
+    parser_argument.CreateStackRequest(Searcher::TokenizeExpression(query));
+
+    std::unordered_map<std::string, std::vector<size_t>> file_words_and_indexes;
+    std::unordered_map<std::string, MappedIndex::iterator> iterators;
+    for (const std::string& word : ParserArgument::GetWordsFromExpression(Searcher::TokenizeExpression(query))) {
+        MappedIndex::iterator iterator = mapped_index.SearchWord(word);
+        if (iterator == mapped_index.end()) {
+            state.SkipWithError("phrase term is missing from the corpus");
+            return;
+        }
+        const auto& sorted_keys = iterator.GetSortedKeys();
+        file_words_and_indexes[word].assign(sorted_keys.begin(), sorted_keys.end());
+        iterators.emplace(word, iterator);
+    }
+
+    ParserArgument::PositionsLookup positions_lookup = [&iterators](const std::string& word, size_t file_id,
+                                                                    std::vector<uint64_t>& offsets) {
+        offsets.clear();
+        const MappedIndex::iterator& iterator = iterators.at(word);
+        for (auto it = iterator.GetStartArray(file_id); it != iterator.GetEndArray(file_id); ++it) {
+            offsets.push_back(PostingCodec::PositionOffset(*it));
+        }
+    };
+
+    size_t count_documents = 0;
+    for (auto _ : state) {
+        count_documents = parser_argument.ExpressionCalculation(file_words_and_indexes, positions_lookup).size();
+        benchmark::DoNotOptimize(count_documents);
+    }
+    state.counters["docs"] = static_cast<double>(count_documents);
+}
+
+}
+
+BENCHMARK(PhraseQuery)->DenseRange(0, kQueries.size() - 1)->Unit(benchmark::kMicrosecond);
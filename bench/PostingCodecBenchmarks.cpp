@@ -0,0 +1,106 @@
+#include "Indexer/PostingCodec.hpp"
+#include "SyntheticCorpus.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+constexpr size_t kCountTerms = 1'000;
+
+std::vector<uint64_t> GeneratePostings(const benchmark::State& state) {
+    SyntheticCorpus corpus(kCountTerms);
+    std::vector<size_t> postings = corpus.Postings(state.range(0), state.range(1));
+    return std::vector<uint64_t>(postings.begin(), postings.end());
+}
+
+void EncodeVarintDeltas(const std::vector<uint64_t>& values, std::vector<uint8_t>& output) {
+    uint64_t previous = 0;
+    for (uint64_t value : values) {
+        PostingCodec::EncodeVarint(value - previous, output);
+        previous = value;
+    }
+}
+
+void SetCodecCounters(benchmark::State& state, size_t count_values, size_t encoded_size) {
+    state.SetItemsProcessed(state.iterations() * count_values);
+    state.counters["bytes"] = static_cast<double>(encoded_size);
+    state.counters["bytes_per_posting"] = static_cast<double>(encoded_size) / count_values;
+}
+
+void VarintEncode(benchmark::State& state) {
+    std::vector<uint64_t> values = GeneratePostings(state);
+    std::vector<uint8_t> output;
+
+    for (auto _ : state) {
+        output.clear();
+        EncodeVarintDeltas(values, output);
+        benchmark::DoNotOptimize(output.data());
+    }
+    SetCodecCounters(state, values.size(), output.size());
+}
+
+void VarintDecode(benchmark::State& state) {
+    std::vector<uint64_t> values = GeneratePostings(state);
+    std::vector<uint8_t> encoded;
+    EncodeVarintDeltas(values, encoded);
+    std::vector<uint64_t> decoded(values.size());
+
+    for (auto _ : state) {
+        const uint8_t* input = encoded.data();
+        uint64_t previous = 0;
+        for (uint64_t& value : decoded) {
+            previous += PostingCodec::DecodeVarint(input);
+            value = previous;
+        }
+        benchmark::DoNotOptimize(decoded.data());
+    }
+    if (decoded != values) {
+        state.SkipWithError("varint round trip mismatch");
+    }
+    SetCodecCounters(state, values.size(), encoded.size());
+}
+
+void BlockEncode(benchmark::State& state) {
+    std::vector<uint64_t> values = GeneratePostings(state);
+    std::vector<uint8_t> output;
+
+    for (auto _ : state) {
+        output.clear();
+        PostingCodec::EncodeList(values, true, output);
+        benchmark::DoNotOptimize(output.data());
+    }
+    SetCodecCounters(state, values.size(), output.size());
+}
+
+void BlockDecode(benchmark::State& state) {
+    std::vector<uint64_t> values = GeneratePostings(state);
+    std::vector<uint8_t> encoded;
+    PostingCodec::EncodeList(values, true, encoded);
+    std::vector<uint64_t> decoded(values.size());
+
+    for (auto _ : state) {
+        PostingCodec::DecodeList(encoded.data(), decoded.size(), true, decoded.data());
+        benchmark::DoNotOptimize(decoded.data());
+    }
+    if (decoded != values) {
+        state.SkipWithError("block round trip mismatch");
+    }
+    SetCodecCounters(state, values.size(), encoded.size());
+}
+
+void ApplyPostingSizes(benchmark::internal::Benchmark* benchmark) {
+    benchmark->ArgNames({"postings", "documents"});
+    benchmark->Args({1 << 10, 1 << 20});
+    benchmark->Args({1 << 14, 1 << 20});
+    benchmark->Args({1 << 18, 1 << 20});
+}
+
+}
+
+BENCHMARK(VarintEncode)->Apply(ApplyPostingSizes);
+BENCHMARK(VarintDecode)->Apply(ApplyPostingSizes);
+BENCHMARK(BlockEncode)->Apply(ApplyPostingSizes);
+BENCHMARK(BlockDecode)->Apply(ApplyPostingSizes);
@@ -0,0 +1,134 @@
+#include "Server/QueryClient.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const char* connections_flag = "--connections";
+const char* pipeline_flag = "--pipeline";
+const char* requests_flag = "--requests";
+
+struct ConnectionResult {
+    std::vector<double> latencies;
+    size_t count_errors = 0;
+};
+
+void RunConnection(const std::string& socket_path, const std::vector<std::string>& queries, size_t first_query,
+                   size_t count_requests, size_t pipeline_depth, ConnectionResult& result) {
+    QueryClient client(socket_path);
+    std::deque<std::chrono::steady_clock::time_point> sent_at;
+    result.latencies.reserve(count_requests);
+
+    size_t count_sent = 0;
+    while (result.latencies.size() < count_requests) {
+        while (count_sent < count_requests && sent_at.size() < pipeline_depth) {
+            client.Send(queries[(first_query + count_sent) % queries.size()]);
+            sent_at.push_back(std::chrono::steady_clock::now());
+            ++count_sent;
+        }
+
+        std::string response = client.ReadResponse();
+        result.latencies.push_back(std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - sent_at.front()).count());
+        sent_at.pop_front();
+        if (response.starts_with("error: ") || response.find("\nerror: ") != std::string::npos) {
+            ++result.count_errors;
+        }
+    }
+}
+
+double Percentile(const std::vector<double>& sorted_latencies, size_t percentile) {
+    return sorted_latencies[std::min(sorted_latencies.size() - 1, sorted_latencies.size() * percentile / 100)];
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "usage: " << argv[0] << " <socket> <queries-file> [" << connections_flag << " N] ["
+                  << pipeline_flag << " N] [" << requests_flag << " N]\n";
+        return 1;
+    }
+
+    std::string socket_path = argv[1];
+    size_t count_connections = 1;
+    size_t pipeline_depth = 1;
+    size_t count_requests = 1000;
+    for (int i = 3; i < argc; ++i) {
+        if (std::string(argv[i]) == connections_flag && i + 1 < argc) {
+            count_connections = std::stoul(argv[++i]);
+        }
+        if (std::string(argv[i]) == pipeline_flag && i + 1 < argc) {
+            pipeline_depth = std::stoul(argv[++i]);
+        }
+        if (std::string(argv[i]) == requests_flag && i + 1 < argc) {
+            count_requests = std::stoul(argv[++i]);
+        }
+    }
+    if (count_connections == 0 || pipeline_depth == 0 || count_requests < count_connections) {
+        throw std::invalid_argument("connections, pipeline depth and requests must be positive");
+    }
+
+    std::vector<std::string> queries;
+    std::ifstream file_queries(argv[2]);
+    for (std::string query; std::getline(file_queries, query);) {
+        if (!query.empty()) {
+            queries.push_back(query);
+        }
+    }
+    if (queries.empty()) {
+        throw std::runtime_error("no queries in " + std::string(argv[2]));
+    }
+
+    std::vector<ConnectionResult> results(count_connections);
+    std::vector<std::thread> connections;
+    std::mutex error_mutex;
+    std::string error_message;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count_connections; ++i) {
+        size_t count_connection_requests = count_requests / count_connections + (i < count_requests % count_connections);
+        connections.emplace_back([&, i, count_connection_requests]() {
+            try {
+                RunConnection(socket_path, queries, i * queries.size() / count_connections, count_connection_requests,
+                              pipeline_depth, results[i]);
+            } catch (const std::exception& error) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                error_message = error.what();
+            }
+        });
+    }
+    for (std::thread& connection : connections) {
+        connection.join();
+    }
+    double elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (!error_message.empty()) {
+        throw std::runtime_error(error_message);
+    }
+
+    std::vector<double> latencies;
+    size_t count_errors = 0;
+    for (const ConnectionResult& result : results) {
+        latencies.insert(latencies.end(), result.latencies.begin(), result.latencies.end());
+        count_errors += result.count_errors;
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    std::cout << std::fixed << std::setprecision(3)
+              << "connections: " << count_connections << ", pipeline: " << pipeline_depth
+              << ", requests: " << latencies.size() << ", errors: " << count_errors << '\n'
+              << "qps: " << latencies.size() / elapsed_seconds << '\n'
+              << "latency ms: p50 " << Percentile(latencies, 50) << ", p90 " << Percentile(latencies, 90)
+              << ", p99 " << Percentile(latencies, 99) << ", max " << latencies.back() << '\n';
+
+    return 0;
+}
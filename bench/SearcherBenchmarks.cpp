@@ -0,0 +1,81 @@
+#include "Searcher/Searcher.hpp"
+#include "SyntheticCorpus.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+constexpr size_t kCountTerms = 50'000;
+constexpr size_t kCountQueryTerms = 4;
+constexpr double kAverageDocumentLength = 600;
+
+void GetBM25(benchmark::State& state) {
+    SyntheticCorpus corpus(kCountTerms);
+    size_t count_matched = state.range(0);
+
+    std::vector<std::string> documents;
+    std::unordered_map<std::string, size_t> count_word_in_file;
+    for (size_t i = 0; i < count_matched; ++i) {
+        documents.push_back("module/file" + std::to_string(i) + ".cpp");
+        count_word_in_file[documents.back()] = 100 + corpus.UniformIndex(1'000);
+    }
+
+    std::unordered_map<std::string, std::unordered_map<std::string, size_t>> data_word;
+    for (size_t i = 0; i < kCountQueryTerms; ++i) {
+        auto& postings = data_word[corpus.Terms()[i * 97]];
+        for (size_t document : corpus.Postings(count_matched / (i + 1), count_matched)) {
+            postings[documents[document]] = 1 + corpus.UniformIndex(20);
+        }
+    }
+
+    for (auto _ : state) {
+        Searcher searcher(documents, count_word_in_file, kAverageDocumentLength, count_matched * 4);
+        benchmark::DoNotOptimize(searcher.GetBM25(data_word));
+    }
+    state.SetItemsProcessed(state.iterations() * count_matched);
+}
+
+void GetTopBM25(benchmark::State& state) {
+    SyntheticCorpus corpus(kCountTerms);
+    size_t count_documents = state.range(0);
+
+    std::vector<size_t> document_lengths;
+    for (size_t i = 0; i < count_documents; ++i) {
+        document_lengths.push_back(100 + corpus.UniformIndex(1'000));
+    }
+    auto document_length = [&](size_t index) {
+        return document_lengths[index];
+    };
+
+    std::vector<std::vector<size_t>> file_ids;
+    std::vector<std::vector<size_t>> frequencies;
+    for (size_t i = 0; i < kCountQueryTerms; ++i) {
+        file_ids.push_back(corpus.Postings(count_documents / (4 << (2 * i)), count_documents));
+        frequencies.emplace_back();
+        for (size_t j = 0; j < file_ids.back().size(); ++j) {
+            frequencies.back().push_back(1 + corpus.UniformIndex(20));
+        }
+    }
+
+    Searcher searcher(kAverageDocumentLength, count_documents);
+    std::vector<TermPostings> terms;
+    for (size_t i = 0; i < kCountQueryTerms; ++i) {
+        terms.push_back(TermPostings{file_ids[i], frequencies[i],
+                                     searcher.GetMaxScore(file_ids[i], frequencies[i], document_length)});
+    }
+
+    for (auto _ : state) {
+        Searcher top_searcher(kAverageDocumentLength, count_documents);
+        benchmark::DoNotOptimize(top_searcher.GetTopBM25(terms, document_length, 10));
+        state.counters["scored"] = static_cast<double>(top_searcher.CountScoredDocuments());
+    }
+}
+
+}
+
+BENCHMARK(GetBM25)->Arg(1'000)->Arg(4'000)->Unit(benchmark::kMillisecond);
+BENCHMARK(GetTopBM25)->Arg(100'000)->Arg(1'000'000)->Unit(benchmark::kMicrosecond);
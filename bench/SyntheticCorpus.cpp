@@ -0,0 +1,139 @@
+#include "SyntheticCorpus.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <unordered_set>
+
+namespace {
+
+const std::vector<std::string> kKeywords = {
+    "const", "return", "int", "std", "template", "typename", "class", "struct", "void", "if",
+    "for", "size_t", "auto", "namespace", "include", "bool", "static", "public", "private", "value"
+};
+
+const std::vector<std::string> kSyllables = {
+    "ab", "ac", "al", "an", "ar", "as", "at", "be", "ca", "ce", "co", "de", "di", "el", "en",
+    "er", "es", "ex", "fi", "ge", "ic", "id", "in", "io", "is", "it", "le", "li", "lo", "ma",
+    "me", "mi", "mo", "na", "ne", "no", "nt", "ol", "on", "or", "os", "ou", "pa", "pe", "po",
+    "ra", "re", "ri", "ro", "se", "si", "st", "ta", "te", "ti", "to", "tr", "ul", "un", "ur",
+    "us", "va", "ve", "x", "y", "z", "q", "k", "_"
+};
+
+const std::vector<std::string> kSeparators = {" ", " ", " ", "(", ")", ";", "::", ", ", " = ", "->", "<", ">"};
+
+}
+
+SyntheticCorpus::SyntheticCorpus(size_t count_terms, uint64_t seed)
+    : generator_(seed)
+{
+    std::unordered_set<std::string> seen;
+    for (const std::string& keyword : kKeywords) {
+        if (terms_.size() < count_terms && seen.insert(keyword).second) {
+            terms_.push_back(keyword);
+        }
+    }
+
+    while (terms_.size() < count_terms) {
+        std::string term;
+        size_t count_syllables = 2 + UniformIndex(5);
+        for (size_t i = 0; i < count_syllables && term.size() + 2 <= kMaxTermLength; ++i) {
+            term += kSyllables[UniformIndex(kSyllables.size())];
+        }
+        if (seen.insert(term).second) {
+            terms_.push_back(std::move(term));
+        }
+    }
+
+    double total_weight = 0;
+    cumulative_weights_.reserve(terms_.size());
+    for (size_t i = 0; i < terms_.size(); ++i) {
+        total_weight += 1.0 / std::pow(static_cast<double>(i + 1), kZipfExponent);
+        cumulative_weights_.push_back(total_weight);
+    }
+    for (double& weight : cumulative_weights_) {
+        weight /= total_weight;
+    }
+}
+
+const std::vector<std::string>& SyntheticCorpus::Terms() const {
+    return terms_;
+}
+
+const std::string& SyntheticCorpus::SampleTerm() {
+    size_t rank = std::lower_bound(cumulative_weights_.begin(), cumulative_weights_.end(), UniformReal())
+                  - cumulative_weights_.begin();
+    return terms_[std::min(rank, terms_.size() - 1)];
+}
+
+std::string SyntheticCorpus::Misspell(std::string word) {
+    size_t position = UniformIndex(word.size());
+    char symbol = static_cast<char>('a' + UniformIndex(26));
+    switch (UniformIndex(3)) {
+        case 0:
+            word[position] = symbol;
+            break;
+        case 1:
+            word.insert(word.begin() + position, symbol);
+            break;
+        default:
+            word.erase(word.begin() + position);
+            break;
+    }
+
+    return word;
+}
+
+std::string SyntheticCorpus::GenerateFile(size_t count_lines) {
+    std::string content;
+    for (size_t line = 0; line < count_lines; ++line) {
+        content.append(UniformIndex(3) * 4, ' ');
+        size_t count_tokens = 1 + UniformIndex(10);
+        for (size_t i = 0; i < count_tokens; ++i) {
+            content += SampleTerm();
+            content += kSeparators[UniformIndex(kSeparators.size())];
+        }
+        content += '\n';
+    }
+
+    return content;
+}
+
+std::vector<std::filesystem::path> SyntheticCorpus::WriteTree(const std::filesystem::path& root,
+        size_t count_files, size_t count_lines) {
+    constexpr size_t kFilesPerDirectory = 64;
+
+    std::vector<std::filesystem::path> files;
+    for (size_t i = 0; i < count_files; ++i) {
+        std::filesystem::path directory = root / ("module" + std::to_string(i / kFilesPerDirectory));
+        std::filesystem::create_directories(directory);
+
+        std::filesystem::path file_path = directory / ("file" + std::to_string(i) + (i % 2 == 0 ? ".cpp" : ".hpp"));
+        std::ofstream file(file_path, std::ios::binary);
+        file << GenerateFile(count_lines);
+        files.push_back(file_path);
+    }
+
+    return files;
+}
+
+std::vector<size_t> SyntheticCorpus::Postings(size_t count, size_t count_documents) {
+    double probability = static_cast<double>(count) / count_documents;
+    std::vector<size_t> postings;
+    postings.reserve(count);
+    for (size_t i = 0; i < count_documents; ++i) {
+        if (UniformReal() < probability) {
+            postings.push_back(i);
+        }
+    }
+
+    return postings;
+}
+
+size_t SyntheticCorpus::UniformIndex(size_t bound) {
+    return generator_() % bound;
+}
+
+double SyntheticCorpus::UniformReal() {
+    return static_cast<double>(generator_() >> 11) * 0x1.0p-53;
+}
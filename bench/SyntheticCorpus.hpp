@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+class SyntheticCorpus {
+public:
+    constexpr static const uint64_t kDefaultSeed = 42;
+    constexpr static const double kZipfExponent = 1.1;
+    constexpr static const size_t kMaxTermLength = 24;
+
+    explicit SyntheticCorpus(size_t count_terms, uint64_t seed = kDefaultSeed);
+
+    const std::vector<std::string>& Terms() const;
+    const std::string& SampleTerm();
+    std::string Misspell(std::string word);
+    std::string GenerateFile(size_t count_lines);
+    std::vector<std::filesystem::path> WriteTree(const std::filesystem::path& root, size_t count_files,
+                                                 size_t count_lines);
+    std::vector<size_t> Postings(size_t count, size_t count_documents);
+
+    size_t UniformIndex(size_t bound);
+    double UniformReal();
+private:
+    std::mt19937_64 generator_;
+    std::vector<std::string> terms_;
+    std::vector<double> cumulative_weights_;
+};
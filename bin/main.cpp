@@ -1,13 +1,701 @@
 #include "lib/Indexer/Indexer.hpp"
+#include "lib/Indexer/SegmentedIndex.hpp"
+#include "lib/Indexer/ExternalIndexer.hpp"
+#include "lib/Indexer/PostingCodec.hpp"
+#include "lib/ParserArgument/LruCache.hpp"
 #include "lib/ParserArgument/ParserArgument.hpp"
+#include "lib/ParserArgument/QueryPlan.hpp"
+#include "lib/ParserArgument/TermUnion.hpp"
 #include "lib/Searcher/Searcher.hpp"
+#include "lib/Server/QueryServer.hpp"
+#include "lib/Trace/Trace.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <csignal>
 #include <iostream>
 #include <fstream>
 #include <chrono> 
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include <sys/resource.h>
 
 const char* indexer_flag = "--indexer";
 const char* searcher_flag = "--searcher";
+const char* threads_flag = "--threads";
+const char* convert_flag = "--convert";
+const char* cold_flag = "--cold";
+const char* prewarm_flag = "--prewarm";
+const char* top_flag = "--top";
+const char* incremental_flag = "--incremental";
+const char* segmented_flag = "--segmented";
+const char* segment_memory_flag = "--segment-memory";
+const char* mem_limit_flag = "--mem-limit";
+const char* cache_size_flag = "--cache-size";
+const char* socket_flag = "--socket";
+const char* workers_flag = "--workers";
+const char* query_threads_flag = "--query-threads";
+const char* trace_flag = "--trace";
+const char* stats_flag = "--stats";
+const char* kFileNameTrie = "trie.bin";
+
+struct QueryResult {
+    std::vector<std::pair<size_t, double>> documents;
+    size_t count_scored = 0;
+};
+
+double ElapsedMilliseconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+size_t PeakMemoryMiB() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<size_t>(usage.ru_maxrss) / 1024;
+}
+
+void PrintPipelineStats(const IndexPipeline::Stats& stats) {
+    if (stats.inserter.count_items == 0) {
+        return;
+    }
+
+    const std::pair<const char*, const IndexPipeline::StageStats*> stages[] = {
+        {"enumerator", &stats.enumerator}, {"reader", &stats.reader},
+        {"tokenizer", &stats.tokenizer}, {"inserter", &stats.inserter}
+    };
+    std::cout << "indexer pipeline: " << stats.count_bytes << " bytes, " << stats.count_tokens << " tokens\n";
+    for (const auto& [name, stage] : stages) {
+        double busy_seconds = std::max(static_cast<double>(stage->busy_nanoseconds) / 1e9, 1e-9);
+        std::cout << "  " << name << ": " << stage->count_items << " items, " << stage->count_input_stalls
+                  << " input stalls, " << stage->count_output_stalls << " output stalls, busy "
+                  << busy_seconds << " s, " << static_cast<uint64_t>(stage->count_items / busy_seconds) << " files/s, "
+                  << static_cast<uint64_t>(stats.count_bytes / busy_seconds) << " bytes/s, "
+                  << static_cast<uint64_t>(stats.count_tokens / busy_seconds) << " tokens/s\n";
+    }
+}
+
+uint64_t IndexGeneration(const std::vector<std::filesystem::path>& index_files) {
+    uint64_t generation = 0;
+    for (const std::filesystem::path& path : index_files) {
+        std::error_code error;
+        auto write_time = std::filesystem::last_write_time(path, error);
+        uint64_t file_size = error ? 0 : std::filesystem::file_size(path, error);
+        uint64_t file_generation = error ? 0 : static_cast<uint64_t>(write_time.time_since_epoch().count()) ^ file_size;
+        generation = generation * 1000003 ^ file_generation;
+    }
+
+    return generation;
+}
+
+template<typename Value>
+void PrintCacheStats(const char* name, const std::vector<const LruCache<Value>*>& caches) {
+    typename LruCache<Value>::Stats stats;
+    size_t count_entries = 0;
+    size_t byte_size = 0;
+    for (const LruCache<Value>* cache : caches) {
+        stats.count_hits += cache->GetStats().count_hits;
+        stats.count_misses += cache->GetStats().count_misses;
+        stats.count_evictions += cache->GetStats().count_evictions;
+        stats.count_invalidations += cache->GetStats().count_invalidations;
+        count_entries += cache->size();
+        byte_size += cache->ByteSize();
+    }
+
+    std::cout << name << ": " << stats.count_hits << " hits, " << stats.count_misses << " misses, "
+              << stats.count_evictions << " evictions, " << stats.count_invalidations << " invalidations, "
+              << count_entries << " entries, " << byte_size << " bytes\n";
+}
+
+class QueryCaches {
+public:
+    QueryCaches(size_t byte_size, std::vector<std::filesystem::path> index_files, size_t count_workers = 0)
+        : results_(byte_size)
+        , is_enabled_(byte_size != 0)
+        , index_files_(std::move(index_files))
+        , generation_(IndexGeneration(index_files_))
+    {
+        for (size_t i = 0; i <= count_workers; ++i) {
+            subexpressions_.push_back(std::make_unique<WorkerSubexpressions>(byte_size / (count_workers + 1)));
+        }
+    }
+
+    QueryCaches* Get() {
+        return is_enabled_ ? this : nullptr;
+    }
+
+    bool IsIndexChanged() {
+        uint64_t generation = 0;
+        if (!IsIndexChanged(generation)) {
+            return false;
+        }
+
+        UpdateGeneration(generation);
+        return true;
+    }
+
+    bool IsIndexChanged(uint64_t& generation) {
+        generation = IndexGeneration(index_files_);
+        std::lock_guard<std::mutex> lock(mutex_);
+        return generation != generation_;
+    }
+
+    void UpdateGeneration(uint64_t generation) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        generation_ = generation;
+        ++count_reloads_;
+        results_.Clear();
+    }
+
+    size_t CountReloads() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return count_reloads_;
+    }
+
+    std::shared_ptr<const QueryResult> FindResult(const std::string& key, size_t count_reloads) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (count_reloads != count_reloads_) {
+            return nullptr;
+        }
+        const std::shared_ptr<const QueryResult>* result = results_.Find(key);
+        return result == nullptr ? nullptr : *result;
+    }
+
+    void InsertResult(const std::string& key, QueryResult result, size_t count_reloads) {
+        size_t byte_size = result.documents.size() * sizeof(result.documents.front());
+        auto value = std::make_shared<const QueryResult>(std::move(result));
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (count_reloads != count_reloads_) {
+            return;
+        }
+        results_.Insert(key, std::move(value), byte_size);
+    }
+
+    ParserArgument::SubexpressionCache* Subexpressions(size_t count_reloads) {
+        size_t worker = ThreadPool::CurrentWorker();
+        WorkerSubexpressions& subexpressions = *subexpressions_[worker == ThreadPool::kNotWorker ? 0 : worker + 1];
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (count_reloads != count_reloads_) {
+            return nullptr;
+        }
+        if (subexpressions.count_reloads != count_reloads_) {
+            subexpressions.count_reloads = count_reloads_;
+            subexpressions.cache.Clear();
+        }
+        return &subexpressions.cache;
+    }
+
+    void PrintStats() const {
+        if (!is_enabled_) {
+            return;
+        }
+
+        std::vector<const ParserArgument::SubexpressionCache*> subexpressions;
+        for (const auto& worker_subexpressions : subexpressions_) {
+            subexpressions.push_back(&worker_subexpressions->cache);
+        }
+        PrintCacheStats<std::shared_ptr<const QueryResult>>("query cache", {&results_});
+        PrintCacheStats("subexpression cache", subexpressions);
+    }
+private:
+    struct WorkerSubexpressions {
+        explicit WorkerSubexpressions(size_t byte_size)
+            : cache(byte_size)
+        {}
+
+        ParserArgument::SubexpressionCache cache;
+        size_t count_reloads = 0;
+    };
+
+    std::mutex mutex_;
+    LruCache<std::shared_ptr<const QueryResult>> results_;
+    std::vector<std::unique_ptr<WorkerSubexpressions>> subexpressions_;
+    bool is_enabled_;
+    std::vector<std::filesystem::path> index_files_;
+    uint64_t generation_;
+    size_t count_reloads_ = 0;
+};
+
+template<typename Index>
+class SharedIndex {
+public:
+    using Loader = std::function<std::unique_ptr<Index>()>;
+
+    SharedIndex(Loader load_index, QueryCaches& caches)
+        : load_index_(std::move(load_index))
+        , caches_(caches)
+        , indexer_(load_index_())
+    {}
+
+    std::shared_ptr<Index> Get(size_t& count_reloads) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        uint64_t generation = 0;
+        if (caches_.IsIndexChanged(generation)) {
+            indexer_ = load_index_();
+            caches_.UpdateGeneration(generation);
+        }
+        count_reloads = caches_.CountReloads();
+        return indexer_;
+    }
+private:
+    Loader load_index_;
+    QueryCaches& caches_;
+    std::mutex mutex_;
+    std::shared_ptr<Index> indexer_;
+};
+
+template<typename Index>
+void RemoveDeletedDocuments(const Index& indexer, std::vector<size_t>& file_ids, std::vector<size_t>* frequencies) {
+    if constexpr (requires { indexer.HasDeletedDocuments(); }) {
+        if (!indexer.HasDeletedDocuments()) {
+            return;
+        }
+
+        size_t count_live = 0;
+        for (size_t i = 0; i < file_ids.size(); ++i) {
+            if (indexer.ContainsDocument(file_ids[i])) {
+                file_ids[count_live] = file_ids[i];
+                if (frequencies != nullptr) {
+                    (*frequencies)[count_live] = (*frequencies)[i];
+                }
+                ++count_live;
+            }
+        }
+
+        file_ids.resize(count_live);
+        if (frequencies != nullptr) {
+            frequencies->resize(count_live);
+        }
+    }
+}
+
+template<typename Term>
+void PrintFileLines(const std::unordered_map<std::string, Term>& name_ties_iterator, size_t file_id,
+        std::ostream& out) {
+    std::vector<uint64_t> lines;
+    for (const auto& element_iterator : name_ties_iterator) {
+        if (!element_iterator.second.size(file_id)) {
+            continue;
+        }
+
+        element_iterator.second.GetPositions(file_id, lines);
+        for (uint64_t& line : lines) {
+            line = PostingCodec::PositionLine(line);
+        }
+        if (!std::is_sorted(lines.begin(), lines.end())) {
+            std::sort(lines.begin(), lines.end());
+        }
+        lines.erase(std::unique(lines.begin(), lines.end()), lines.end());
+
+        for (uint64_t line : lines) {
+            out << element_iterator.first << " " << line << '\n';
+        }
+    }
+}
+
+template<typename Index, typename Term>
+ParserArgument::PositionsLookup CreatePositionsLookup(const Index& indexer,
+        const std::unordered_map<std::string, Term>& name_ties_iterator) {
+    if constexpr (requires { indexer.HasPositions(); }) {
+        if (!indexer.HasPositions()) {
+            return nullptr;
+        }
+    }
+
+    return [&name_ties_iterator](const std::string& word, size_t file_id, std::vector<uint64_t>& offsets) {
+        offsets.clear();
+        auto iterator = name_ties_iterator.find(word);
+        if (iterator == name_ties_iterator.end() || !iterator->second.size(file_id)) {
+            return;
+        }
+
+        iterator->second.GetPositions(file_id, offsets);
+        for (uint64_t& offset : offsets) {
+            offset = PostingCodec::PositionOffset(offset);
+        }
+        if (!std::is_sorted(offsets.begin(), offsets.end())) {
+            std::sort(offsets.begin(), offsets.end());
+        }
+    };
+}
+
+template<typename Index>
+TermUnion<typename Index::iterator> SearchTerm(const Index& indexer, const std::string& word) {
+    std::vector<typename Index::iterator> terms;
+    std::string fuzzy_word;
+    size_t max_distance = 0;
+    if (LevenshteinAutomaton::ParseFuzzy(word, fuzzy_word, max_distance)) {
+        std::vector<double> weights;
+        for (const FuzzyTerm& fuzzy_term : indexer.ExpandFuzzy(fuzzy_word, max_distance)) {
+            terms.push_back(indexer.SearchWord(fuzzy_term.term));
+            weights.push_back(BM25::FuzzyWeight(fuzzy_term.distance));
+        }
+
+        return TermUnion<typename Index::iterator>(std::move(terms), std::move(weights));
+    } else if (Wildcard::IsWildcard(word)) {
+        for (const std::string& term : indexer.ExpandWildcard(word)) {
+            terms.push_back(indexer.SearchWord(term));
+        }
+    } else {
+        auto iterator = indexer.SearchWord(word);
+        if (iterator != indexer.end() && !iterator.GetSortedKeys().empty()) {
+            terms.push_back(iterator);
+        }
+    }
+
+    return TermUnion<typename Index::iterator>(std::move(terms));
+}
+
+template<typename Index>
+std::vector<TermUnion<typename Index::iterator>> SearchTerms(const Index& indexer, const std::vector<std::string>& words,
+        ThreadPool* thread_pool) {
+    Trace::ScopedTimer timer(Trace::Phase::kTermLookup);
+    Trace::Add(Trace::Counter::kTerms, words.size());
+    std::vector<TermUnion<typename Index::iterator>> terms(words.size());
+    ParallelFor(thread_pool, words.size(), [&](size_t i) {
+        terms[i] = SearchTerm(indexer, words[i]);
+    });
+
+    return terms;
+}
+
+template<typename Term>
+void PrintTermFound(const std::string& word, const Term& term, std::ostream& out) {
+    if (term.empty()) {
+        out << word << " not found\n";
+    } else if (term.IsWeighted() || Wildcard::IsWildcard(word)) {
+        out << "found " << word << " (" << term.CountTerms() << " terms)\n";
+    } else {
+        out << "found " << word << '\n';
+    }
+}
+
+template<typename Index, typename Term>
+void PrintQueryResult(Index& indexer, const std::unordered_map<std::string, Term>& name_ties_iterator,
+        const QueryResult& query_result, std::ostream& out) {
+    Trace::ScopedTimer timer(Trace::Phase::kPrinting);
+    for (const auto& [file_id, score] : query_result.documents) {
+        out << "filename: " << indexer.StringIndex(file_id) << '\n';
+        PrintFileLines(name_ties_iterator, file_id, out);
+    }
+}
+
+template<typename Index>
+QueryResult AnswerQuery(Index& indexer, ParserArgument& parser_argument,
+        const std::vector<std::string>& words_from_expression, const QueryResult* cached_result,
+        ParserArgument::SubexpressionCache* subexpression_cache, std::ostream& out, ThreadPool* thread_pool) {
+    std::unordered_map<std::string, std::vector<size_t>> file_words_and_indexes;
+    std::unordered_map<std::string, TermUnion<typename Index::iterator>> name_ties_iterator;
+    std::vector<TermUnion<typename Index::iterator>> terms = SearchTerms(indexer, words_from_expression, thread_pool);
+    std::vector<size_t> fetched_terms;
+    for (size_t i = 0; i < words_from_expression.size(); ++i) {
+        PrintTermFound(words_from_expression[i], terms[i], out);
+        if (!terms[i].empty() && cached_result == nullptr
+            && file_words_and_indexes.try_emplace(words_from_expression[i]).second) {
+            fetched_terms.push_back(i);
+        }
+    }
+
+    {
+        Trace::ScopedTimer timer(Trace::Phase::kPostings);
+        ParallelFor(thread_pool, fetched_terms.size(), [&](size_t i) {
+            std::vector<size_t>& file_ids = file_words_and_indexes.at(words_from_expression[fetched_terms[i]]);
+            terms[fetched_terms[i]].GetPostings(file_ids, nullptr);
+            RemoveDeletedDocuments(indexer, file_ids, nullptr);
+        });
+    }
+    for (size_t i : fetched_terms) {
+        Trace::Add(Trace::Counter::kPostings, file_words_and_indexes.at(words_from_expression[i]).size());
+    }
+    for (size_t i = 0; i < words_from_expression.size(); ++i) {
+        if (!terms[i].empty()) {
+            name_ties_iterator[words_from_expression[i]] = std::move(terms[i]);
+        }
+    }
+
+    if (cached_result != nullptr) {
+        PrintQueryResult(indexer, name_ties_iterator, *cached_result, out);
+        return {};
+    }
+
+    std::vector<size_t> result_calculation;
+    {
+        Trace::ScopedTimer timer(Trace::Phase::kBooleanEvaluation);
+        result_calculation = QueryPlan(parser_argument, file_words_and_indexes,
+            CreatePositionsLookup(indexer, name_ties_iterator), subexpression_cache).Execute(thread_pool);
+    }
+    Trace::Add(Trace::Counter::kMatched, result_calculation.size());
+
+    Trace::ScopedTimer scoring_timer(Trace::Phase::kScoring);
+    std::unordered_map<std::string_view, size_t> reverse_directory_id;
+
+    std::vector<std::string> name_file_result;
+    std::unordered_map<std::string, size_t> count_word_in_file;
+    for (size_t v : result_calculation) {
+        std::string_view name = indexer.StringIndex(v);
+        name_file_result.emplace_back(name);
+        reverse_directory_id[name] = v;
+        count_word_in_file.emplace(name, indexer.DocumentLength(v));
+    }
+
+    Searcher searcher(name_file_result, std::move(count_word_in_file),
+                      indexer.AverageDocumentLength(), indexer.CountDocuments());
+
+    std::unordered_map<std::string, std::unordered_map<std::string, size_t>> info_for_bm25;
+    std::unordered_map<std::string, double> word_weights;
+    for (const std::string& word : words_from_expression) {
+        const TermUnion<typename Index::iterator>& term = name_ties_iterator[word];
+        if (!term.IsWeighted()) {
+            for (const auto& e : file_words_and_indexes[word]) {
+                info_for_bm25[word][std::string(indexer.StringIndex(e))] = term.size(e);
+            }
+            continue;
+        }
+
+        for (size_t i = 0; i < term.CountTerms(); ++i) {
+            std::string term_key = word + '#' + std::to_string(i);
+            word_weights[term_key] = term.Weight(i);
+            for (const auto& e : file_words_and_indexes[word]) {
+                if (size_t count = term.Term(i).size(e); count != 0) {
+                    info_for_bm25[term_key][std::string(indexer.StringIndex(e))] = count;
+                }
+            }
+        }
+    }
+
+    std::vector<std::pair<std::string, double>> result = searcher.GetBM25(info_for_bm25, word_weights, thread_pool);
+
+    QueryResult query_result;
+    for (const auto& elemet : result) {
+        query_result.documents.emplace_back(reverse_directory_id[elemet.first], elemet.second);
+    }
+    Trace::Add(Trace::Counter::kScored, query_result.documents.size());
+    scoring_timer.Stop();
+    PrintQueryResult(indexer, name_ties_iterator, query_result, out);
+
+    return query_result;
+}
+
+template<typename Index>
+QueryResult AnswerTopQuery(Index& indexer, ParserArgument& parser_argument,
+        const std::vector<std::string>& words_from_expression, size_t count_top, const QueryResult* cached_result,
+        ParserArgument::SubexpressionCache* subexpression_cache, std::ostream& out, ThreadPool* thread_pool) {
+    struct PostingsFetch {
+        const TermUnion<typename Index::iterator>* term;
+        std::vector<size_t>* file_ids;
+        std::vector<size_t>* frequencies;
+        double weight;
+        size_t term_index;
+    };
+
+    std::unordered_map<std::string, std::vector<size_t>> file_words_and_indexes;
+    std::unordered_map<std::string, std::vector<size_t>> word_frequencies;
+    std::unordered_map<std::string, TermUnion<typename Index::iterator>> name_ties_iterator;
+    std::deque<std::vector<size_t>> fuzzy_postings;
+    std::deque<TermUnion<typename Index::iterator>> fuzzy_terms;
+    std::vector<PostingsFetch> fetches;
+    std::vector<TermPostings> terms;
+
+    Searcher searcher(indexer.AverageDocumentLength(), indexer.CountDocuments());
+    auto document_length = [&indexer](size_t file_id) {
+        return indexer.DocumentLength(file_id);
+    };
+    auto add_term = [&](const TermUnion<typename Index::iterator>& term, std::vector<size_t>& file_ids,
+                        std::vector<size_t>& frequencies, double weight) {
+        fetches.push_back(PostingsFetch{&term, &file_ids, &frequencies, weight, terms.size()});
+        terms.emplace_back();
+    };
+
+    std::vector<TermUnion<typename Index::iterator>> found_terms = SearchTerms(indexer, words_from_expression,
+                                                                               thread_pool);
+    std::vector<size_t> owners;
+    for (size_t i = 0; i < words_from_expression.size(); ++i) {
+        const std::string& word = words_from_expression[i];
+        if (name_ties_iterator.contains(word)) {
+            continue;
+        }
+
+        const TermUnion<typename Index::iterator>& term = found_terms[i];
+        PrintTermFound(word, term, out);
+        if (term.empty()) {
+            continue;
+        }
+        name_ties_iterator[word];
+        owners.push_back(i);
+        if (cached_result != nullptr) {
+            continue;
+        }
+
+        std::vector<size_t>& file_ids = file_words_and_indexes[word];
+        if (term.IsWeighted()) {
+            fetches.push_back(PostingsFetch{&term, &file_ids, nullptr, 1.0, 0});
+            for (size_t j = 0; j < term.CountTerms(); ++j) {
+                std::vector<size_t>& term_file_ids = fuzzy_postings.emplace_back();
+                std::vector<size_t>& term_frequencies = fuzzy_postings.emplace_back();
+                add_term(fuzzy_terms.emplace_back(std::vector<typename Index::iterator>{term.Term(j)}),
+                         term_file_ids, term_frequencies, term.Weight(j));
+            }
+        } else {
+            add_term(term, file_ids, word_frequencies[word], 1.0);
+        }
+    }
+
+    Trace::ScopedTimer postings_timer(Trace::Phase::kPostings);
+    ParallelFor(thread_pool, fetches.size(), [&](size_t i) {
+        const PostingsFetch& fetch = fetches[i];
+        fetch.term->GetPostings(*fetch.file_ids, fetch.frequencies);
+        RemoveDeletedDocuments(indexer, *fetch.file_ids, fetch.frequencies);
+        if (fetch.frequencies == nullptr) {
+            return;
+        }
+
+        double max_score;
+        if constexpr (requires { fetch.term->MaxScore(); }) {
+            max_score = fetch.term->IsExpanded()
+                        ? searcher.GetMaxScore(*fetch.file_ids, *fetch.frequencies, document_length)
+                        : fetch.term->MaxScore();
+        } else {
+            max_score = searcher.GetMaxScore(*fetch.file_ids, *fetch.frequencies, document_length);
+        }
+        terms[fetch.term_index] = TermPostings{*fetch.file_ids, *fetch.frequencies, max_score, fetch.weight};
+    });
+    postings_timer.Stop();
+    for (const PostingsFetch& fetch : fetches) {
+        if (fetch.frequencies != nullptr) {
+            Trace::Add(Trace::Counter::kPostings, fetch.file_ids->size());
+        }
+    }
+    for (size_t i : owners) {
+        name_ties_iterator[words_from_expression[i]] = std::move(found_terms[i]);
+    }
+
+    if (cached_result != nullptr) {
+        PrintQueryResult(indexer, name_ties_iterator, *cached_result, out);
+        out << "scored: " << cached_result->count_scored << '\n';
+        return {};
+    }
+
+    parser_argument.CheckPostfix();
+    std::vector<size_t> result_calculation;
+    if (!parser_argument.IsDisjunction()) {
+        Trace::ScopedTimer timer(Trace::Phase::kBooleanEvaluation);
+        result_calculation = QueryPlan(parser_argument, file_words_and_indexes,
+            CreatePositionsLookup(indexer, name_ties_iterator), subexpression_cache).Execute(thread_pool);
+        Trace::Add(Trace::Counter::kMatched, result_calculation.size());
+    }
+
+    QueryResult query_result;
+    {
+        Trace::ScopedTimer timer(Trace::Phase::kScoring);
+        query_result.documents = searcher.GetTopBM25(terms, document_length, count_top,
+            parser_argument.IsDisjunction() ? nullptr : &result_calculation, thread_pool);
+        query_result.count_scored = searcher.CountScoredDocuments();
+    }
+    Trace::Add(Trace::Counter::kScored, query_result.count_scored);
+
+    PrintQueryResult(indexer, name_ties_iterator, query_result, out);
+    out << "scored: " << query_result.count_scored << '\n';
+
+    return query_result;
+}
+
+template<typename Index>
+void ProcessQuery(Index& indexer, const std::vector<std::string>& command_expression, size_t count_top,
+        std::ostream& out, QueryCaches* caches = nullptr, size_t count_reloads = 0, ThreadPool* thread_pool = nullptr) {
+    std::vector<std::string> words_from_expression = ParserArgument::GetWordsFromExpression(command_expression);
+
+    ParserArgument parser_argument;
+    parser_argument.CreateStackRequest(command_expression);
+
+    std::string cache_key;
+    std::shared_ptr<const QueryResult> cached_result;
+    ParserArgument::SubexpressionCache* subexpression_cache = nullptr;
+    if (caches != nullptr) {
+        cache_key = parser_argument.GetNormalizedPostfix() + " TOP/" + std::to_string(count_top);
+        cached_result = caches->FindResult(cache_key, count_reloads);
+        subexpression_cache = caches->Subexpressions(count_reloads);
+    }
+
+    QueryResult query_result;
+    if (count_top == 0) {
+        query_result = AnswerQuery(indexer, parser_argument, words_from_expression, cached_result.get(),
+                                   subexpression_cache, out, thread_pool);
+    } else {
+        query_result = AnswerTopQuery(indexer, parser_argument, words_from_expression, count_top,
+                                      cached_result.get(), subexpression_cache, out, thread_pool);
+    }
+
+    if (caches != nullptr && cached_result == nullptr) {
+        caches->InsertResult(cache_key, std::move(query_result), count_reloads);
+    }
+}
+
+using ProcessQueryFunction = std::function<void(const std::vector<std::string>&, std::ostream&)>;
+
+void AnswerCommand(const std::string& command, const ProcessQueryFunction& process_query, std::ostream& out,
+        bool is_trace) {
+    Trace::BeginQuery();
+    auto start_query = std::chrono::steady_clock::now();
+    try {
+        std::vector<std::string> command_expression = Searcher::TokenizeExpression(command);
+        if (command_expression.empty()) {
+            return;
+        }
+
+        process_query(command_expression, out);
+    } catch (const std::exception& error) {
+        out << "error: " << error.what() << '\n';
+    }
+
+    double latency = ElapsedMilliseconds(start_query);
+    if (Trace::IsEnabled()) {
+        Trace::Record(Trace::Phase::kQuery, static_cast<uint64_t>(latency * 1e6));
+    }
+    if (is_trace) {
+        Trace::PrintQuery(out);
+    }
+    out << "latency: " << latency << " ms\n";
+    out << QueryServer::kResponseEnd;
+}
+
+void RunSearcher(const ProcessQueryFunction& process_query, bool is_trace) {
+    std::string command;
+
+    while (std::getline(std::cin, command)) {
+        AnswerCommand(command, process_query, std::cout, is_trace);
+    }
+}
+
+std::atomic<QueryServer*> running_server = nullptr;
+
+void StopServer(int) {
+    if (QueryServer* server = running_server.load()) {
+        server->Stop();
+    }
+}
+
+void RunServer(const std::string& socket_path, size_t count_workers, const ProcessQueryFunction& process_query,
+        bool is_trace) {
+    QueryServer server(socket_path, count_workers, [&process_query, is_trace](const std::string& request,
+                                                                              std::ostream& out) {
+        AnswerCommand(request, process_query, out, is_trace);
+    });
+
+    running_server = &server;
+    std::signal(SIGINT, StopServer);
+    std::signal(SIGTERM, StopServer);
+    std::cout << "server listening: " << socket_path << ", workers: " << server.CountWorkers() << std::endl;
+    server.Run();
+    running_server = nullptr;
+
+    const QueryServer::Stats& stats = server.GetStats();
+    std::cout << "server stopped: " << stats.count_connections << " connections, " << stats.count_requests
+              << " requests, " << stats.count_read_pauses << " read pauses, " << stats.count_accept_pauses
+              << " accept pauses\n";
+}
 
 int main(int argc, char* argv[]) {
     if (argc <= 1) {
@@ -16,78 +704,236 @@ int main(int argc, char* argv[]) {
 
     std::string argument_1 = argv[1];
     std::cout << argument_1 << '\n';
-    if (argument_1 == indexer_flag && argc >= 2) {
-        Indexer<true> indexer;
+    if (argument_1 == indexer_flag && argc >= 3) {
         std::filesystem::path path_folder = argv[2];
         std::cout << "indexer folder: " << path_folder << '\n';
-        indexer.StartIndexer(path_folder);
-    }
 
-    if (argument_1 == searcher_flag) {
-        std::string command;
-
-        while(true) {
-            std::cin >> command;
-
-            std::vector<std::string> command_expression = Searcher::TokenizeExpression(command);
-            std::vector<std::string> words_from_expression = ParserArgument::GetWordsFromExpression(command_expression);
-
-            Indexer<false> indexer(ParserArgument::WordLeveling(words_from_expression));
-
-            ParserArgument parser_argument;
-            parser_argument.CreateStackRequest(command_expression);
-            
-            std::unordered_map<std::string, std::unordered_set<size_t>> file_words_and_indexes;
-            std::unordered_map<std::string, Ties::iterator> name_ties_iterator;
-            for (size_t i = 0; i < words_from_expression.size(); ++i) {
-                auto iterator = indexer.SearchWord(words_from_expression[i]);
-
-                if (iterator == indexer.end()) {
-                    std::cout << words_from_expression[i] << " not found\n";
-                } else {
-                    std::cout << "found " << words_from_expression[i] << '\n';
-                    file_words_and_indexes[words_from_expression[i]] = iterator.GetKeyArray();
-                    name_ties_iterator[words_from_expression[i]] = iterator;
+        size_t count_threads = 1;
+        bool is_incremental = false;
+        bool is_segmented = false;
+        size_t segment_memory = SegmentedIndexer::kDefaultMemoryBudget;
+        size_t memory_limit = 0;
+        for (int i = 3; i < argc; ++i) {
+            if (std::string(argv[i]) == threads_flag && i + 1 < argc) {
+                count_threads = std::stoul(argv[++i]);
+                if (count_threads == 0) {
+                    count_threads = std::max(1u, std::thread::hardware_concurrency());
                 }
             }
-            
-            std::unordered_set<size_t> result_calculation = parser_argument.ExpressionCalculation(file_words_and_indexes);
-            std::unordered_map<std::string, size_t> reverse_directory_id;
+            if (std::string(argv[i]) == segment_memory_flag && i + 1 < argc) {
+                segment_memory = std::stoul(argv[++i]) << 20;
+            }
+            if (std::string(argv[i]) == mem_limit_flag && i + 1 < argc) {
+                memory_limit = std::stoul(argv[++i]) << 20;
+            }
+            is_incremental |= std::string(argv[i]) == incremental_flag;
+            is_segmented |= std::string(argv[i]) == segmented_flag;
+        }
+        if (memory_limit != 0 && count_threads != 1) {
+            std::cout << "indexer: " << threads_flag << " is ignored with " << mem_limit_flag << '\n';
+            count_threads = 1;
+        }
+        std::cout << "indexer threads: " << count_threads << '\n';
 
-            std::vector<std::string> name_file_result;
-            for (size_t v : result_calculation) {
-                name_file_result.push_back(indexer.StringIndex(v));
-                reverse_directory_id[indexer.StringIndex(v)] = v;
+        auto start_indexer = std::chrono::steady_clock::now();
+        size_t count_documents = 0;
+        uint64_t indexed_bytes = 0;
+        if (memory_limit != 0) {
+            ExternalIndexer indexer(memory_limit);
+            indexer.StartIndexer(path_folder);
+            count_documents = indexer.CountDocuments();
+            indexed_bytes = indexer.TotalFileSize();
+            std::cout << "indexer runs: " << indexer.CountRuns()
+                      << ", postings: " << indexer.CountPostings() << '\n';
+        } else if (is_segmented) {
+            if (!is_incremental) {
+                SegmentedIndex::RemoveSegments(SegmentedIndex::kDirectorySegments);
+            }
 
+            SegmentedIndexer indexer(SegmentedIndex::kDirectorySegments, segment_memory);
+            if (is_incremental) {
+                indexer.UpdateIndexer(path_folder);
+            } else {
+                indexer.StartIndexer(path_folder);
+            }
+            indexer.WaitMerges();
+            count_documents = indexer.CountDocuments();
+            indexed_bytes = indexer.TotalFileSize();
+            std::cout << "indexer documents: " << indexer.CountDocuments()
+                      << ", tombstones: " << indexer.CountTombstones()
+                      << ", segments: " << indexer.CountSegments()
+                      << ", merges: " << indexer.CountMerges() << '\n';
+        } else if (is_incremental && std::filesystem::exists(kFileNameTrie)) {
+            Indexer<true> indexer(kFileNameTrie);
+            indexer.UpdateIndexer(path_folder, count_threads);
+            PrintPipelineStats(indexer.PipelineStats());
+            count_documents = indexer.CountDocuments();
+            indexed_bytes = indexer.TotalFileSize();
+            std::cout << "indexer documents: " << indexer.CountDocuments()
+                      << ", tombstones: " << indexer.CountTombstones() << '\n';
+        } else {
+            if (is_incremental) {
+                std::cout << "indexer: no " << kFileNameTrie << ", indexing the whole folder\n";
             }
+            Indexer<true> indexer;
+            indexer.StartIndexer(path_folder, count_threads);
+            PrintPipelineStats(indexer.PipelineStats());
+            count_documents = indexer.CountDocuments();
+            indexed_bytes = indexer.TotalFileSize();
+        }
 
-            Searcher searcher(name_file_result);
+        double elapsed_seconds = ElapsedMilliseconds(start_indexer) / 1000;
+        double indexed_mebibytes = static_cast<double>(indexed_bytes) / (1 << 20);
+        std::cout << "indexer summary: " << count_documents << " documents, " << indexed_mebibytes << " MiB in "
+                  << elapsed_seconds << " s, " << indexed_mebibytes / elapsed_seconds << " MiB/s, peak memory: "
+                  << PeakMemoryMiB() << " MiB\n";
+    }
 
-            std::unordered_map<std::string, std::unordered_map<std::string, size_t>> info_for_bm25;
-            for (const std::string& word : words_from_expression) {
-                for (const auto& e : file_words_and_indexes[word]) {
-                    info_for_bm25[word][indexer.StringIndex(e)] = name_ties_iterator[word].size(e);
-                }
+    if (argument_1 == convert_flag) {
+        Indexer<false> indexer(kFileNameTrie);
+        indexer.ConvertToMappedIndex();
+        std::cout << "converted to " << MappedIndex::kFileNameMappedIndex << '\n';
+    }
+
+    if (argument_1 == searcher_flag) {
+        bool is_cold = false;
+        bool is_prewarm = false;
+        bool is_segmented = false;
+        size_t count_top = 0;
+        size_t cache_size = LruCache<QueryResult>::kDefaultByteSize;
+        std::string socket_path;
+        size_t count_workers = 0;
+        size_t count_query_threads = 1;
+        bool is_trace = false;
+        bool is_stats = false;
+        for (int i = 2; i < argc; ++i) {
+            is_cold |= std::string(argv[i]) == cold_flag;
+            if (std::string(argv[i]) == cache_size_flag && i + 1 < argc) {
+                cache_size = std::stoul(argv[++i]) << 20;
+            }
+            is_prewarm |= std::string(argv[i]) == prewarm_flag;
+            is_segmented |= std::string(argv[i]) == segmented_flag;
+            if (std::string(argv[i]) == top_flag && i + 1 < argc) {
+                count_top = std::stoul(argv[++i]);
+            }
+            if (std::string(argv[i]) == socket_flag && i + 1 < argc) {
+                socket_path = argv[++i];
             }
+            if (std::string(argv[i]) == workers_flag && i + 1 < argc) {
+                count_workers = std::stoul(argv[++i]);
+            }
+            if (std::string(argv[i]) == query_threads_flag && i + 1 < argc) {
+                count_query_threads = std::stoul(argv[++i]);
+            }
+            is_trace |= std::string(argv[i]) == trace_flag;
+            is_stats |= std::string(argv[i]) == stats_flag;
+        }
+        Trace::Enable(is_trace || is_stats);
+        if (is_cold && !std::filesystem::exists(kFileNameTrie)) {
+            throw std::runtime_error(std::string(cold_flag) + " needs " + kFileNameTrie
+                                     + ", rebuild the index without " + mem_limit_flag);
+        }
+        if (count_workers == 0) {
+            count_workers = std::max(1u, std::thread::hardware_concurrency());
+        }
+        if (socket_path.empty()) {
+            count_workers = 0;
+        }
+        if (count_query_threads == 0) {
+            count_query_threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        std::unique_ptr<ThreadPool> query_pool;
+        if (count_query_threads > 1) {
+            query_pool = std::make_unique<ThreadPool>(count_query_threads);
+        }
 
-            std::vector<std::pair<std::string, double>> result = searcher.GetBM25(info_for_bm25);
+        auto run = [&socket_path, count_workers, is_trace](const ProcessQueryFunction& process_query) {
+            if (socket_path.empty()) {
+                RunSearcher(process_query, is_trace);
+            } else {
+                RunServer(socket_path, count_workers, process_query, is_trace);
+            }
+        };
 
-            for (const auto& elemet : result) {
-                std::cout << "filename: " << elemet.first << '\n';
-                
-                for (const auto& element_iterator : name_ties_iterator) {
-                    if (!element_iterator.second.size(reverse_directory_id[elemet.first])) {
-                        continue;
-                    }
-                    for (auto it = element_iterator.second.GetStartArray(reverse_directory_id[elemet.first]);
-                        it != element_iterator.second.GetEndArray(reverse_directory_id[elemet.first]); ++it) {
-                        std::cout << element_iterator.first << " " << *it << '\n';
+        if (is_cold) {
+            QueryCaches caches(cache_size, {kFileNameTrie, Indexer<false>::kFileNameIdDirectory,
+                                            Indexer<false>::kFileNameDocumentLength}, count_workers);
+            run([&caches, &query_pool, count_top](const std::vector<std::string>& command_expression,
+                                                  std::ostream& out) {
+                caches.IsIndexChanged();
+                size_t count_reloads = caches.CountReloads();
+                std::vector<std::string> words_from_expression = ParserArgument::GetWordsFromExpression(command_expression);
+                for (std::string& word : words_from_expression) {
+                    if (LevenshteinAutomaton::IsFuzzy(word)) {
+                        word = Wildcard::kWildcard;
                     }
                 }
-            }
+                Indexer<false> indexer(ParserArgument::WildcardLeveling(words_from_expression));
+                ProcessQuery(indexer, command_expression, count_top, out, caches.Get(), count_reloads,
+                             query_pool.get());
+            });
+            caches.PrintStats();
+        } else if (is_segmented) {
+            auto load_index = []() {
+                auto start_load = std::chrono::steady_clock::now();
+                auto indexer = std::make_unique<SegmentedIndex>();
+                std::cout << "index loaded: " << ElapsedMilliseconds(start_load) << " ms, segments: "
+                          << indexer->CountSegments() << '\n';
+                return indexer;
+            };
+            QueryCaches caches(cache_size, {std::filesystem::path(SegmentedIndex::kDirectorySegments)
+                                            / SegmentedIndex::kFileNameManifest}, count_workers);
+            SharedIndex<SegmentedIndex> indexer(load_index, caches);
+
+            run([&](const std::vector<std::string>& command_expression, std::ostream& out) {
+                size_t count_reloads = 0;
+                std::shared_ptr<SegmentedIndex> index = indexer.Get(count_reloads);
+                ProcessQuery(*index, command_expression, count_top, out, caches.Get(), count_reloads,
+                             query_pool.get());
+            });
+            caches.PrintStats();
+        } else if (std::filesystem::exists(MappedIndex::kFileNameMappedIndex)) {
+            auto load_index = [is_prewarm]() {
+                auto start_load = std::chrono::steady_clock::now();
+                auto indexer = std::make_unique<MappedIndex>();
+                if (is_prewarm) {
+                    indexer->Prewarm();
+                }
+                std::cout << "index loaded: " << ElapsedMilliseconds(start_load) << " ms\n";
+                return indexer;
+            };
+            QueryCaches caches(cache_size, {MappedIndex::kFileNameMappedIndex}, count_workers);
+            SharedIndex<MappedIndex> indexer(load_index, caches);
+
+            run([&](const std::vector<std::string>& command_expression, std::ostream& out) {
+                size_t count_reloads = 0;
+                std::shared_ptr<MappedIndex> index = indexer.Get(count_reloads);
+                ProcessQuery(*index, command_expression, count_top, out, caches.Get(), count_reloads,
+                             query_pool.get());
+            });
+            caches.PrintStats();
+        } else {
+            auto load_index = []() {
+                auto start_load = std::chrono::steady_clock::now();
+                auto indexer = std::make_unique<Indexer<false>>(kFileNameTrie);
+                std::cout << "index loaded: " << ElapsedMilliseconds(start_load) << " ms\n";
+                return indexer;
+            };
+            QueryCaches caches(cache_size, {kFileNameTrie, Indexer<false>::kFileNameIdDirectory,
+                                            Indexer<false>::kFileNameDocumentLength}, count_workers);
+            SharedIndex<Indexer<false>> indexer(load_index, caches);
 
-            std::cout << "end\n";
+            run([&](const std::vector<std::string>& command_expression, std::ostream& out) {
+                size_t count_reloads = 0;
+                std::shared_ptr<Indexer<false>> index = indexer.Get(count_reloads);
+                ProcessQuery(*index, command_expression, count_top, out, caches.Get(), count_reloads,
+                             query_pool.get());
+            });
+            caches.PrintStats();
+        }
 
+        if (is_stats) {
+            Trace::PrintStats(std::cout);
         }
     }
  }
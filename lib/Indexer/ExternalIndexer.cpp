@@ -0,0 +1,353 @@
+#include "ExternalIndexer.hpp"
+#include "PostingCodec.hpp"
+#include "Tokenizer.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+
+ExternalIndexer::RunReader::RunReader(const std::filesystem::path& path_run, size_t buffer_size)
+    : file_run_(path_run, std::ios::binary)
+    , buffer_(buffer_size)
+{
+    if (!file_run_.is_open()) {
+        throw std::runtime_error("error open file " + path_run.string());
+    }
+}
+
+uint8_t ExternalIndexer::RunReader::ReadByte() {
+    if (position_ == size_) {
+        file_run_.read(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        size_ = static_cast<size_t>(file_run_.gcount());
+        position_ = 0;
+        if (size_ == 0) {
+            throw std::runtime_error("unexpected end of run");
+        }
+    }
+
+    return static_cast<uint8_t>(buffer_[position_++]);
+}
+
+uint64_t ExternalIndexer::RunReader::ReadVarint() {
+    uint64_t value = 0;
+    for (size_t shift = 0;; shift += 7) {
+        uint8_t byte = ReadByte();
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+}
+
+bool ExternalIndexer::RunReader::Next() {
+    if (position_ == size_) {
+        file_run_.read(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        size_ = static_cast<size_t>(file_run_.gcount());
+        position_ = 0;
+        if (size_ == 0) {
+            return false;
+        }
+    }
+
+    term_.resize(ReadVarint());
+    for (char& symbol : term_) {
+        symbol = static_cast<char>(ReadByte());
+    }
+
+    file_ids.resize(ReadVarint());
+    lines_size.resize(file_ids.size());
+    lines.clear();
+
+    uint64_t previous_file_id = 0;
+    for (size_t i = 0; i < file_ids.size(); ++i) {
+        previous_file_id += ReadVarint();
+        file_ids[i] = previous_file_id;
+        lines_size[i] = ReadVarint();
+
+        uint64_t previous_line = 0;
+        uint64_t previous_offset = 0;
+        for (size_t j = 0; j < lines_size[i]; ++j) {
+            previous_line += ReadVarint();
+            previous_offset += ReadVarint();
+            lines.push_back(PostingCodec::PackPosition(previous_line, previous_offset));
+        }
+    }
+
+    return true;
+}
+
+ExternalIndexer::ExternalIndexer(size_t memory_limit, const std::filesystem::path& path_scratch)
+    : memory_limit_(memory_limit)
+    , path_scratch_(path_scratch)
+{
+    if (memory_limit_ < sizeof(RunPosting)) {
+        throw std::invalid_argument("memory limit is too small");
+    }
+}
+
+ExternalIndexer::~ExternalIndexer() {
+    RemoveRunsDirectory();
+}
+
+void ExternalIndexer::CreateRunsDirectory(const std::filesystem::path& path_scratch) {
+    RemoveRunsDirectory();
+
+    std::string path_template = (path_scratch / kRunsDirectoryTemplate).string();
+    if (mkdtemp(path_template.data()) == nullptr) {
+        throw std::runtime_error("error create directory " + path_template);
+    }
+    path_runs_ = path_template;
+}
+
+void ExternalIndexer::RemoveRunsDirectory() {
+    if (path_runs_.empty()) {
+        return;
+    }
+
+    std::error_code error;
+    std::filesystem::remove_all(path_runs_, error);
+    path_runs_.clear();
+}
+
+std::filesystem::path ExternalIndexer::RunPath(size_t number) const {
+    return path_runs_ / ("run_" + std::to_string(number) + ".bin");
+}
+
+void ExternalIndexer::StartIndexer(const std::filesystem::path& directory_path,
+        const std::string& path_mapped_index) {
+    if (!std::filesystem::exists(directory_path) || !std::filesystem::is_directory(directory_path)) {
+        throw std::runtime_error("could not find the folder");
+    }
+
+    std::vector<std::filesystem::path> files;
+    CollectFiles(directory_path, files);
+
+    std::filesystem::path path_scratch = path_scratch_;
+    if (path_scratch.empty()) {
+        path_scratch = std::filesystem::absolute(path_mapped_index).parent_path();
+    }
+    CreateRunsDirectory(path_scratch);
+    run_postings_.reserve(memory_limit_ / sizeof(RunPosting));
+    for (const auto& file_path : files) {
+        AddFile(file_path, ++file_id);
+    }
+    SpillRun();
+
+    run_postings_ = std::vector<RunPosting>();
+    run_terms_ = {};
+    run_term_names_ = std::vector<std::string_view>();
+
+    MergeRuns(path_mapped_index);
+    RemoveRunsDirectory();
+    WriteIndexState(std::filesystem::path(path_mapped_index).parent_path());
+}
+
+void ExternalIndexer::WriteIndexState(const std::filesystem::path& path_directory) {
+    WriteIdDirectoryToBinFile((path_directory / kFileNameIdDirectory).string().c_str());
+    WriteDocumentLengthToBinFile((path_directory / kFileNameDocumentLength).string().c_str());
+    WriteFileStateToBinFile((path_directory / kFileNameFileState).string().c_str());
+    std::filesystem::remove(path_directory / kFileNameTrie);
+}
+
+uint32_t ExternalIndexer::InternTerm(std::string_view word) {
+    auto term = run_terms_.find(word);
+    if (term != run_terms_.end()) {
+        return term->second;
+    }
+
+    uint32_t index = static_cast<uint32_t>(run_term_names_.size());
+    term = run_terms_.emplace(std::string(word), index).first;
+    run_term_names_.push_back(term->first);
+    run_terms_byte_ += word.size() + kTermOverhead;
+
+    return index;
+}
+
+size_t ExternalIndexer::MemoryUsage() const {
+    return run_postings_.size() * sizeof(RunPosting) + run_terms_byte_;
+}
+
+void ExternalIndexer::AddFile(const std::filesystem::path& file_path, size_t current_file_id) {
+    FileState state = GetFileState(file_path);
+    Tokenizer tokenizer(file_path);
+    std::string_view word;
+    size_t document_length = 0;
+
+    while (tokenizer.Next(word)) {
+        ++document_length;
+        if (word.size() >= kMaxLenghtWord) {
+            continue;
+        }
+
+        run_postings_.push_back(RunPosting{InternTerm(word),
+                                           PostingCodec::PackPosition(tokenizer.LineNumber(), document_length - 1),
+                                           current_file_id});
+        if (MemoryUsage() >= memory_limit_) {
+            SpillRun();
+        }
+    }
+
+    state.content_hash = tokenizer.ContentHash();
+    id_directory_.Insert(current_file_id, file_path.string());
+    AddDocumentLength(current_file_id, document_length);
+    file_state_[current_file_id] = state;
+}
+
+void ExternalIndexer::SpillRun() {
+    if (run_postings_.empty()) {
+        return;
+    }
+
+    std::vector<uint32_t> term_order(run_term_names_.size());
+    for (uint32_t i = 0; i < term_order.size(); ++i) {
+        term_order[i] = i;
+    }
+    std::sort(term_order.begin(), term_order.end(), [this](uint32_t lhs, uint32_t rhs) {
+        return run_term_names_[lhs] < run_term_names_[rhs];
+    });
+
+    std::vector<uint32_t> term_rank(term_order.size());
+    for (uint32_t i = 0; i < term_order.size(); ++i) {
+        term_rank[term_order[i]] = i;
+    }
+
+    std::sort(run_postings_.begin(), run_postings_.end(), [&term_rank](const RunPosting& lhs, const RunPosting& rhs) {
+        if (lhs.term != rhs.term) {
+            return term_rank[lhs.term] < term_rank[rhs.term];
+        }
+        if (lhs.file_id != rhs.file_id) {
+            return lhs.file_id < rhs.file_id;
+        }
+        return lhs.position < rhs.position;
+    });
+    run_postings_.erase(std::unique(run_postings_.begin(), run_postings_.end(),
+        [](const RunPosting& lhs, const RunPosting& rhs) {
+            return lhs.term == rhs.term && lhs.file_id == rhs.file_id && lhs.position == rhs.position;
+        }), run_postings_.end());
+    count_postings_ += run_postings_.size();
+
+    std::ofstream file_run(RunPath(count_runs_), std::ios::binary);
+    if (!file_run.is_open()) {
+        throw std::runtime_error("error open file " + RunPath(count_runs_).string());
+    }
+
+    std::vector<uint8_t> output;
+    for (size_t term_begin = 0; term_begin < run_postings_.size();) {
+        uint32_t term = run_postings_[term_begin].term;
+        size_t term_end = term_begin;
+        size_t count_files = 0;
+        for (; term_end < run_postings_.size() && run_postings_[term_end].term == term; ++term_end) {
+            if (term_end == term_begin || run_postings_[term_end].file_id != run_postings_[term_end - 1].file_id) {
+                ++count_files;
+            }
+        }
+
+        std::string_view name = run_term_names_[term];
+        PostingCodec::EncodeVarint(name.size(), output);
+        output.insert(output.end(), name.begin(), name.end());
+        PostingCodec::EncodeVarint(count_files, output);
+
+        size_t previous_file_id = 0;
+        for (size_t file_begin = term_begin; file_begin < term_end;) {
+            size_t file_end = file_begin;
+            while (file_end < term_end && run_postings_[file_end].file_id == run_postings_[file_begin].file_id) {
+                ++file_end;
+            }
+
+            PostingCodec::EncodeVarint(run_postings_[file_begin].file_id - previous_file_id, output);
+            PostingCodec::EncodeVarint(file_end - file_begin, output);
+            previous_file_id = run_postings_[file_begin].file_id;
+
+            uint64_t previous_line = 0;
+            uint64_t previous_offset = 0;
+            for (size_t i = file_begin; i < file_end; ++i) {
+                uint64_t line = PostingCodec::PositionLine(run_postings_[i].position);
+                uint64_t offset = PostingCodec::PositionOffset(run_postings_[i].position);
+                PostingCodec::EncodeVarint(line - previous_line, output);
+                PostingCodec::EncodeVarint(offset - previous_offset, output);
+                previous_line = line;
+                previous_offset = offset;
+            }
+            file_begin = file_end;
+        }
+        term_begin = term_end;
+
+        if (output.size() >= kRunBufferSize) {
+            file_run.write(reinterpret_cast<const char*>(output.data()), static_cast<std::streamsize>(output.size()));
+            output.clear();
+        }
+    }
+    file_run.write(reinterpret_cast<const char*>(output.data()), static_cast<std::streamsize>(output.size()));
+
+    ++count_runs_;
+    run_postings_.clear();
+    run_terms_.clear();
+    run_term_names_.clear();
+    run_terms_byte_ = 0;
+}
+
+void ExternalIndexer::MergeRuns(const std::string& path_mapped_index) {
+    size_t buffer_size = std::clamp<size_t>(memory_limit_ / (2 * std::max<size_t>(1, count_runs_)),
+                                            1 << 16, kRunBufferSize);
+
+    std::vector<std::unique_ptr<RunReader>> readers;
+    auto is_greater = [&readers](size_t lhs, size_t rhs) {
+        int compare = readers[lhs]->Term().compare(readers[rhs]->Term());
+        return compare > 0 || (compare == 0 && lhs > rhs);
+    };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(is_greater)> queue(is_greater);
+
+    for (size_t i = 0; i < count_runs_; ++i) {
+        readers.push_back(std::make_unique<RunReader>(RunPath(i), buffer_size));
+        if (readers.back()->Next()) {
+            queue.push(i);
+        }
+    }
+
+    MappedIndex::Builder builder(path_mapped_index, id_directory_, document_length_);
+    std::string term;
+    std::vector<uint64_t> file_ids;
+    std::vector<uint64_t> lines_size;
+    std::vector<uint64_t> lines;
+
+    while (!queue.empty()) {
+        term = readers[queue.top()]->Term();
+        file_ids.clear();
+        lines_size.clear();
+        lines.clear();
+
+        while (!queue.empty() && readers[queue.top()]->Term() == term) {
+            size_t run = queue.top();
+            queue.pop();
+
+            RunReader& reader = *readers[run];
+            auto run_lines = reader.lines.begin();
+            for (size_t i = 0; i < reader.file_ids.size(); ++i) {
+                auto run_lines_end = run_lines + reader.lines_size[i];
+                if (!file_ids.empty() && file_ids.back() == reader.file_ids[i]) {
+                    for (; run_lines != run_lines_end; ++run_lines) {
+                        if (*run_lines != lines.back()) {
+                            lines.push_back(*run_lines);
+                            ++lines_size.back();
+                        }
+                    }
+                } else {
+                    file_ids.push_back(reader.file_ids[i]);
+                    lines_size.push_back(reader.lines_size[i]);
+                    lines.insert(lines.end(), run_lines, run_lines_end);
+                    run_lines = run_lines_end;
+                }
+            }
+
+            if (reader.Next()) {
+                queue.push(run);
+            }
+        }
+
+        builder.AddTerm(term, file_ids, lines_size, lines);
+    }
+
+    builder.Finish();
+}
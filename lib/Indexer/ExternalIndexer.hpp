@@ -0,0 +1,102 @@
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Indexer.hpp"
+#include "MappedIndex.hpp"
+
+class ExternalIndexer : public IndexerBase<true> {
+public:
+    constexpr static const size_t kDefaultMemoryLimit = 256 << 20;
+    constexpr static const size_t kTermOverhead = 64;
+    constexpr static const size_t kRunBufferSize = 1 << 20;
+    constexpr static const char* kRunsDirectoryTemplate = "index_runs_XXXXXX";
+
+    explicit ExternalIndexer(size_t memory_limit = kDefaultMemoryLimit,
+        const std::filesystem::path& path_scratch = {});
+    ~ExternalIndexer();
+
+    ExternalIndexer(const ExternalIndexer&) = delete;
+    ExternalIndexer& operator=(const ExternalIndexer&) = delete;
+
+    void StartIndexer(const std::filesystem::path& directory_path,
+        const std::string& path_mapped_index = MappedIndex::kFileNameMappedIndex);
+
+    size_t CountDocuments() const {
+        return id_directory_.size();
+    }
+
+    size_t CountRuns() const {
+        return count_runs_;
+    }
+
+    size_t CountPostings() const {
+        return count_postings_;
+    }
+
+    size_t file_id = 0;
+private:
+    struct TermHash {
+        using is_transparent = void;
+
+        size_t operator()(std::string_view term) const {
+            return std::hash<std::string_view>{}(term);
+        }
+    };
+
+    struct RunPosting {
+        uint32_t term;
+        uint64_t position;
+        size_t file_id;
+    };
+
+    class RunReader {
+    public:
+        RunReader(const std::filesystem::path& path_run, size_t buffer_size);
+
+        bool Next();
+
+        const std::string& Term() const {
+            return term_;
+        }
+
+        std::vector<uint64_t> file_ids;
+        std::vector<uint64_t> lines_size;
+        std::vector<uint64_t> lines;
+    private:
+        uint8_t ReadByte();
+        uint64_t ReadVarint();
+
+        std::ifstream file_run_;
+        std::vector<char> buffer_;
+        size_t position_ = 0;
+        size_t size_ = 0;
+        std::string term_;
+    };
+
+    void AddFile(const std::filesystem::path& file_path, size_t current_file_id);
+    uint32_t InternTerm(std::string_view word);
+    size_t MemoryUsage() const;
+    void SpillRun();
+    void MergeRuns(const std::string& path_mapped_index);
+    void WriteIndexState(const std::filesystem::path& path_directory);
+    void CreateRunsDirectory(const std::filesystem::path& path_scratch);
+    void RemoveRunsDirectory();
+    std::filesystem::path RunPath(size_t number) const;
+
+    size_t memory_limit_;
+    std::filesystem::path path_scratch_;
+    std::filesystem::path path_runs_;
+    std::unordered_map<std::string, uint32_t, TermHash, std::equal_to<>> run_terms_;
+    std::vector<std::string_view> run_term_names_;
+    size_t run_terms_byte_ = 0;
+    std::vector<RunPosting> run_postings_;
+    size_t count_runs_ = 0;
+    size_t count_postings_ = 0;
+};
@@ -0,0 +1,192 @@
+#include "IdDirectory.hpp"
+#include "PostingCodec.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+IdDirectory::const_iterator::const_iterator(const IdDirectory* directory, size_t id)
+    : directory_(directory)
+    , id_(id)
+{
+    SkipMissing();
+}
+
+IdDirectory::const_iterator::value_type IdDirectory::const_iterator::operator*() const {
+    return {id_, (*directory_)[id_]};
+}
+
+IdDirectory::const_iterator& IdDirectory::const_iterator::operator++() {
+    ++id_;
+    SkipMissing();
+    return *this;
+}
+
+void IdDirectory::const_iterator::SkipMissing() {
+    while (id_ < directory_->entries_.size() && directory_->entries_[id_].offset == kMissing) {
+        ++id_;
+    }
+}
+
+IdDirectory::IdDirectory(std::initializer_list<std::pair<size_t, std::string_view>> entries) {
+    for (const auto& [id, path] : entries) {
+        Insert(id, path);
+    }
+}
+
+void IdDirectory::Insert(size_t id, std::string_view path) {
+    if (id >= entries_.size()) {
+        entries_.resize(id + 1);
+    }
+
+    Entry& entry = entries_[id];
+    if (entry.offset == kMissing) {
+        ++count_;
+    } else {
+        garbage_size_ += entry.size;
+    }
+    entry.offset = blob_.size();
+    entry.size = path.size();
+    blob_.append(path);
+
+    if (garbage_size_ > blob_.size() / 2) {
+        Compact();
+    }
+}
+
+void IdDirectory::Erase(size_t id) {
+    if (!Contains(id)) {
+        return;
+    }
+
+    garbage_size_ += entries_[id].size;
+    entries_[id] = Entry();
+    --count_;
+    while (!entries_.empty() && entries_.back().offset == kMissing) {
+        entries_.pop_back();
+    }
+}
+
+void IdDirectory::Clear() {
+    entries_.clear();
+    blob_.clear();
+    count_ = 0;
+    garbage_size_ = 0;
+}
+
+IdDirectory::const_iterator IdDirectory::begin() const {
+    return const_iterator(this, 0);
+}
+
+IdDirectory::const_iterator IdDirectory::end() const {
+    return const_iterator(this, entries_.size());
+}
+
+void IdDirectory::Compact() {
+    std::string blob;
+    blob.reserve(blob_.size() - garbage_size_);
+    for (Entry& entry : entries_) {
+        if (entry.offset != kMissing) {
+            uint64_t offset = blob.size();
+            blob.append(blob_, entry.offset, entry.size);
+            entry.offset = offset;
+        }
+    }
+
+    blob_ = std::move(blob);
+    garbage_size_ = 0;
+}
+
+void IdDirectory::Write(std::ostream& output) const {
+    std::vector<uint8_t> encoded;
+    size_t previous_id = 0;
+    std::string_view previous_path;
+    for (const auto& [id, path] : *this) {
+        size_t shared_size = 0;
+        size_t max_shared_size = std::min(path.size(), previous_path.size());
+        while (shared_size < max_shared_size && path[shared_size] == previous_path[shared_size]) {
+            ++shared_size;
+        }
+
+        PostingCodec::EncodeVarint(id - previous_id, encoded);
+        PostingCodec::EncodeVarint(shared_size, encoded);
+        PostingCodec::EncodeVarint(path.size() - shared_size, encoded);
+        encoded.insert(encoded.end(), path.begin() + shared_size, path.end());
+
+        previous_id = id;
+        previous_path = path;
+    }
+
+    uint64_t count = count_;
+    uint64_t encoded_size = encoded.size();
+    output.write(kMagic, sizeof(kMagic));
+    output.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    output.write(reinterpret_cast<const char*>(&encoded_size), sizeof(encoded_size));
+    output.write(reinterpret_cast<const char*>(encoded.data()), static_cast<std::streamsize>(encoded.size()));
+}
+
+void IdDirectory::Read(std::istream& input) {
+    Clear();
+
+    char magic[sizeof(kMagic)] = {};
+    input.read(magic, sizeof(magic));
+    if (!input) {
+        return;
+    }
+    if (!std::equal(magic, magic + sizeof(magic), kMagic)) {
+        input.clear();
+        input.seekg(0, std::ios::beg);
+        ReadLegacy(input);
+        return;
+    }
+
+    uint64_t count = 0;
+    uint64_t encoded_size = 0;
+    input.read(reinterpret_cast<char*>(&count), sizeof(count));
+    input.read(reinterpret_cast<char*>(&encoded_size), sizeof(encoded_size));
+    std::vector<uint8_t> encoded(encoded_size);
+    input.read(reinterpret_cast<char*>(encoded.data()), static_cast<std::streamsize>(encoded.size()));
+    if (!input) {
+        throw std::runtime_error("invalid id directory");
+    }
+
+    constexpr size_t kMaxVarintSize = 10;
+    encoded.resize(encoded.size() + 3 * kMaxVarintSize);
+    const uint8_t* encoded_input = encoded.data();
+    const uint8_t* encoded_end = encoded.data() + encoded_size;
+
+    blob_.reserve(encoded_size);
+    size_t id = 0;
+    std::string path;
+    for (uint64_t i = 0; i < count; ++i) {
+        id += PostingCodec::DecodeVarint(encoded_input);
+        uint64_t shared_size = PostingCodec::DecodeVarint(encoded_input);
+        uint64_t suffix_size = PostingCodec::DecodeVarint(encoded_input);
+        if (encoded_input > encoded_end || shared_size > path.size()
+            || suffix_size > static_cast<uint64_t>(encoded_end - encoded_input)) {
+            throw std::runtime_error("invalid id directory");
+        }
+
+        path.resize(shared_size);
+        path.append(reinterpret_cast<const char*>(encoded_input), suffix_size);
+        encoded_input += suffix_size;
+        Insert(id, path);
+    }
+}
+
+void IdDirectory::ReadLegacy(std::istream& input) {
+    uint64_t count = 0;
+    input.read(reinterpret_cast<char*>(&count), sizeof(count));
+
+    std::string path;
+    for (uint64_t i = 0; i < count && input; ++i) {
+        uint64_t id = 0;
+        uint64_t path_size = 0;
+        input.read(reinterpret_cast<char*>(&id), sizeof(id));
+        input.read(reinterpret_cast<char*>(&path_size), sizeof(path_size));
+        path.resize(path_size);
+        input.read(path.data(), static_cast<std::streamsize>(path_size));
+        if (input) {
+            Insert(id, path);
+        }
+    }
+}
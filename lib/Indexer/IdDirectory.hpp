@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+class IdDirectory {
+private:
+    constexpr static const uint64_t kMissing = std::numeric_limits<uint64_t>::max();
+
+    struct Entry {
+        uint64_t offset = kMissing;
+        uint64_t size = 0;
+    };
+public:
+    constexpr static const char kMagic[8] = "SSEDIR1";
+
+    class const_iterator {
+    public:
+        using value_type = std::pair<size_t, std::string_view>;
+
+        const_iterator(const IdDirectory* directory, size_t id);
+
+        value_type operator*() const;
+        const_iterator& operator++();
+
+        friend bool operator==(const const_iterator& lhs, const const_iterator& rhs) {
+            return lhs.id_ == rhs.id_;
+        }
+
+        friend bool operator!=(const const_iterator& lhs, const const_iterator& rhs) {
+            return !(lhs == rhs);
+        }
+    private:
+        void SkipMissing();
+
+        const IdDirectory* directory_;
+        size_t id_;
+    };
+
+    IdDirectory() = default;
+    IdDirectory(std::initializer_list<std::pair<size_t, std::string_view>> entries);
+
+    void Insert(size_t id, std::string_view path);
+    void Erase(size_t id);
+    void Clear();
+
+    bool Contains(size_t id) const {
+        return id < entries_.size() && entries_[id].offset != kMissing;
+    }
+
+    std::string_view operator[](size_t id) const {
+        if (!Contains(id)) {
+            return std::string_view();
+        }
+
+        return std::string_view(blob_.data() + entries_[id].offset, entries_[id].size);
+    }
+
+    size_t size() const {
+        return count_;
+    }
+
+    bool empty() const {
+        return count_ == 0;
+    }
+
+    size_t MaxId() const {
+        return entries_.empty() ? 0 : entries_.size() - 1;
+    }
+
+    size_t BlobSize() const {
+        return blob_.size();
+    }
+
+    const_iterator begin() const;
+    const_iterator end() const;
+
+    void Write(std::ostream& output) const;
+    void Read(std::istream& input);
+private:
+    void Compact();
+    void ReadLegacy(std::istream& input);
+
+    std::vector<Entry> entries_;
+    std::string blob_;
+    size_t count_ = 0;
+    size_t garbage_size_ = 0;
+};
@@ -0,0 +1,162 @@
+#include "IndexPipeline.hpp"
+#include "PostingCodec.hpp"
+#include "Tokenizer.hpp"
+
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+uint64_t ElapsedNanoseconds(std::chrono::steady_clock::time_point start) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count());
+}
+
+}
+
+IndexPipeline::IndexPipeline(Source source, size_t max_lenght_word, size_t queue_capacity)
+    : max_lenght_word_(max_lenght_word)
+    , paths_(queue_capacity)
+    , contents_(queue_capacity)
+    , documents_(queue_capacity)
+{
+    stages_.emplace_back(&IndexPipeline::EnumerateFiles, this, std::move(source));
+    stages_.emplace_back(&IndexPipeline::ReadFiles, this);
+    stages_.emplace_back(&IndexPipeline::TokenizeFiles, this);
+}
+
+IndexPipeline::~IndexPipeline() {
+    documents_.Cancel();
+    Join();
+}
+
+void IndexPipeline::Join() {
+    for (std::thread& stage : stages_) {
+        if (stage.joinable()) {
+            stage.join();
+        }
+    }
+}
+
+void IndexPipeline::EnumerateFiles(Source source) {
+    auto start = std::chrono::steady_clock::now();
+    uint64_t push_nanoseconds = 0;
+    try {
+        source([this, &push_nanoseconds](const std::filesystem::path& file_path) {
+            std::filesystem::path path = file_path;
+            auto start_push = std::chrono::steady_clock::now();
+            bool is_pushed = paths_.Push(std::move(path));
+            push_nanoseconds += ElapsedNanoseconds(start_push);
+            if (!is_pushed) {
+                return false;
+            }
+            ++stats_.enumerator.count_items;
+            return true;
+        });
+    } catch (...) {
+        exceptions_[0] = std::current_exception();
+    }
+    stats_.enumerator.busy_nanoseconds = ElapsedNanoseconds(start) - push_nanoseconds;
+    paths_.Close();
+}
+
+void IndexPipeline::ReadFiles() {
+    try {
+        std::filesystem::path file_path;
+        while (paths_.Pop(file_path)) {
+            auto start = std::chrono::steady_clock::now();
+            Document document;
+            document.modification_time = static_cast<int64_t>(
+                std::filesystem::last_write_time(file_path).time_since_epoch().count());
+            document.size = static_cast<uint64_t>(std::filesystem::file_size(file_path));
+
+            std::ifstream file(file_path, std::ios::binary);
+            if (!file.is_open()) {
+                throw std::runtime_error("error open file " + file_path.string());
+            }
+            document.content.resize(document.size);
+            file.read(document.content.data(), static_cast<std::streamsize>(document.content.size()));
+            document.content.resize(static_cast<size_t>(file.gcount()));
+            document.path = std::move(file_path);
+
+            stats_.count_bytes += document.content.size();
+            stats_.reader.busy_nanoseconds += ElapsedNanoseconds(start);
+            if (!contents_.Push(std::move(document))) {
+                break;
+            }
+            ++stats_.reader.count_items;
+        }
+    } catch (...) {
+        exceptions_[1] = std::current_exception();
+    }
+    paths_.Cancel();
+    contents_.Close();
+}
+
+void IndexPipeline::TokenizeFiles() {
+    try {
+        Document document;
+        while (contents_.Pop(document)) {
+            auto start = std::chrono::steady_clock::now();
+            Tokenizer tokenizer(document.content.data(), document.content.size());
+            std::string_view word;
+            while (tokenizer.Next(word)) {
+                ++document.document_length;
+                if (word.size() >= max_lenght_word_) {
+                    continue;
+                }
+
+                document.tokens.push_back(Token{word, PostingCodec::PackPosition(tokenizer.LineNumber(),
+                                                                                 document.document_length - 1)});
+            }
+            document.content_hash = tokenizer.ContentHash();
+
+            stats_.count_tokens += document.tokens.size();
+            stats_.tokenizer.busy_nanoseconds += ElapsedNanoseconds(start);
+            if (!documents_.Push(std::move(document))) {
+                break;
+            }
+            ++stats_.tokenizer.count_items;
+            document = Document();
+        }
+    } catch (...) {
+        exceptions_[2] = std::current_exception();
+    }
+    contents_.Cancel();
+    documents_.Close();
+}
+
+bool IndexPipeline::Next(Document& document) {
+    if (is_inserter_busy_) {
+        stats_.inserter.busy_nanoseconds += ElapsedNanoseconds(inserter_start_);
+        is_inserter_busy_ = false;
+    }
+
+    if (documents_.Pop(document)) {
+        ++stats_.inserter.count_items;
+        inserter_start_ = std::chrono::steady_clock::now();
+        is_inserter_busy_ = true;
+        return true;
+    }
+
+    Join();
+    for (const std::exception_ptr& exception : exceptions_) {
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+    }
+
+    return false;
+}
+
+IndexPipeline::Stats IndexPipeline::GetStats() const {
+    Stats stats = stats_;
+    stats.enumerator.count_output_stalls = paths_.CountPushStalls();
+    stats.reader.count_input_stalls = paths_.CountPopStalls();
+    stats.reader.count_output_stalls = contents_.CountPushStalls();
+    stats.tokenizer.count_input_stalls = contents_.CountPopStalls();
+    stats.tokenizer.count_output_stalls = documents_.CountPushStalls();
+    stats.inserter.count_input_stalls = documents_.CountPopStalls();
+
+    return stats;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "../ThreadPool/BoundedQueue.hpp"
+
+class IndexPipeline {
+public:
+    constexpr static const size_t kQueueCapacity = 64;
+
+    using Emit = std::function<bool(const std::filesystem::path&)>;
+    using Source = std::function<void(const Emit&)>;
+
+    struct Token {
+        std::string_view word;
+        uint64_t position;
+    };
+
+    struct Document {
+        std::filesystem::path path;
+        int64_t modification_time = 0;
+        uint64_t size = 0;
+        uint64_t content_hash = 0;
+        size_t document_length = 0;
+        std::vector<char> content;
+        std::vector<Token> tokens;
+    };
+
+    struct StageStats {
+        size_t count_items = 0;
+        size_t count_input_stalls = 0;
+        size_t count_output_stalls = 0;
+        uint64_t busy_nanoseconds = 0;
+    };
+
+    struct Stats {
+        StageStats enumerator;
+        StageStats reader;
+        StageStats tokenizer;
+        StageStats inserter;
+        uint64_t count_bytes = 0;
+        size_t count_tokens = 0;
+    };
+
+    IndexPipeline(Source source, size_t max_lenght_word, size_t queue_capacity = kQueueCapacity);
+    ~IndexPipeline();
+
+    IndexPipeline(const IndexPipeline&) = delete;
+    IndexPipeline& operator=(const IndexPipeline&) = delete;
+
+    bool Next(Document& document);
+    Stats GetStats() const;
+private:
+    void EnumerateFiles(Source source);
+    void ReadFiles();
+    void TokenizeFiles();
+    void Join();
+
+    size_t max_lenght_word_;
+    BoundedQueue<std::filesystem::path> paths_;
+    BoundedQueue<Document> contents_;
+    BoundedQueue<Document> documents_;
+    Stats stats_;
+    std::exception_ptr exceptions_[3];
+    std::chrono::steady_clock::time_point inserter_start_;
+    bool is_inserter_busy_ = false;
+    std::vector<std::thread> stages_;
+};
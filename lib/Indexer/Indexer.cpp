@@ -1,5 +1,10 @@
 #include "Indexer.hpp"
+#include "PostingCodec.hpp"
+#include "Tokenizer.hpp"
+#include "../ThreadPool/ThreadPool.hpp"
+#include "../Trace/Trace.hpp"
 
+#include <algorithm>
 #include <iostream>
 
 template<bool IsWriteWords>
@@ -22,12 +27,23 @@ IndexerBase<IsWriteWords>::IndexerBase()
     : word_repository_(std::make_unique<Ties>())
 {}
 
+template<bool IsWriteWords>
+IndexerBase<IsWriteWords>::IndexerBase(const std::string& path_word_repository)
+    : word_repository_(std::make_unique<Ties>(path_word_repository))
+{
+    ReadIdDirectoryFromBinFile();
+    ReadDocumentLengthFromBinFile();
+    ReadFileStateFromBinFile();
+}
+
 template<bool IsWriteWords>
 IndexerBase<IsWriteWords>::IndexerBase(std::unordered_map<size_t, std::unordered_set<char>>
         letters_by_level, const std::string& path_word_repository)
     : word_repository_(std::make_unique<Ties>(letters_by_level, path_word_repository))
 {
     ReadIdDirectoryFromBinFile();
+    ReadDocumentLengthFromBinFile();
+    ReadFileStateFromBinFile();
 }
 
 template<bool IsWriteWords>
@@ -38,45 +54,250 @@ void IndexerBase<IsWriteWords>::WriteTiesToBinFile(const std::string& filename_t
 template<bool IsWriteWords>
 void IndexerBase<IsWriteWords>::WriteIdDirectoryToBinFile(const char* filename_id_directory) {
     std::ofstream file_id_directory(filename_id_directory, std::ios::binary);
+    id_directory_.Write(file_id_directory);
+}
 
-    size_t size_id_directory = id_directory_.size();
-    file_id_directory.write(reinterpret_cast<char*>(&size_id_directory), sizeof(size_t));
+template<bool IsWriteWords>
+void IndexerBase<IsWriteWords>::WriteDocumentLengthToBinFile(const char* filename_document_length) {
+    std::ofstream file_document_length(filename_document_length, std::ios::binary);
+
+    size_t size_document_length = document_length_.size();
+    file_document_length.write(reinterpret_cast<char*>(&size_document_length), sizeof(size_t));
+    file_document_length.write(reinterpret_cast<char*>(&total_document_length_), sizeof(size_t));
 
-    for (const auto& element_directory_id : id_directory_) {
-        size_t tmp = element_directory_id.first;
-        file_id_directory.write(reinterpret_cast<char*>(&tmp), sizeof(size_t));
-        size_t str_size = element_directory_id.second.size();
-        
-        file_id_directory.write(reinterpret_cast<char*>(&str_size), sizeof(size_t));
-        file_id_directory.write(element_directory_id.second.data(), str_size);
+    for (const auto& element_document_length : document_length_) {
+        file_document_length.write(reinterpret_cast<const char*>(&element_document_length.first), sizeof(size_t));
+        file_document_length.write(reinterpret_cast<const char*>(&element_document_length.second), sizeof(size_t));
     }
 }
 
 template<bool IsWriteWords>
-void IndexerBase<IsWriteWords>::ReadIdDirectoryFromBinFile(const char* filename_id_directory) {
-    std::ifstream file_id_directory(filename_id_directory, std::ios::binary);
+void IndexerBase<IsWriteWords>::ReadDocumentLengthFromBinFile(const char* filename_document_length) {
+    Trace::ScopedTimer timer(Trace::Phase::kReadDocumentLength);
+    std::ifstream file_document_length(filename_document_length, std::ios::binary);
+
+    size_t size_document_length = 0;
+    file_document_length.read(reinterpret_cast<char*>(&size_document_length), sizeof(size_t));
+    file_document_length.read(reinterpret_cast<char*>(&total_document_length_), sizeof(size_t));
+    if (!file_document_length) {
+        total_document_length_ = 0;
+        return;
+    }
+
+    document_length_.reserve(size_document_length);
+    for (size_t i = 0; i < size_document_length; ++i) {
+        size_t id_element_document_length;
+        size_t value_element_document_length;
+        file_document_length.read(reinterpret_cast<char*>(&id_element_document_length), sizeof(size_t));
+        file_document_length.read(reinterpret_cast<char*>(&value_element_document_length), sizeof(size_t));
+
+        document_length_[id_element_document_length] = value_element_document_length;
+    }
+}
+
+template<bool IsWriteWords>
+void IndexerBase<IsWriteWords>::AddDocumentLength(size_t file_id, size_t document_length) {
+    document_length_[file_id] = document_length;
+    total_document_length_ += document_length;
+}
+
+template<bool IsWriteWords>
+void IndexerBase<IsWriteWords>::RemoveDocument(size_t file_id) {
+    auto document_length = document_length_.find(file_id);
+    if (document_length != document_length_.end()) {
+        total_document_length_ -= document_length->second;
+        document_length_.erase(document_length);
+    }
+
+    id_directory_.Erase(file_id);
+    file_state_.erase(file_id);
+    tombstones_.insert(file_id);
+}
+
+template<bool IsWriteWords>
+void IndexerBase<IsWriteWords>::WriteFileStateToBinFile(const char* filename_file_state) {
+    std::ofstream file_state(filename_file_state, std::ios::binary);
+
+    size_t size_file_state = file_state_.size();
+    file_state.write(reinterpret_cast<char*>(&size_file_state), sizeof(size_t));
+    for (const auto& [file_id, state] : file_state_) {
+        file_state.write(reinterpret_cast<const char*>(&file_id), sizeof(size_t));
+        file_state.write(reinterpret_cast<const char*>(&state), sizeof(FileState));
+    }
+
+    std::vector<size_t> tombstones(tombstones_.begin(), tombstones_.end());
+    for (const std::vector<size_t>* file_ids : {&tombstones, &free_file_ids_}) {
+        size_t size_file_ids = file_ids->size();
+        file_state.write(reinterpret_cast<char*>(&size_file_ids), sizeof(size_t));
+        file_state.write(reinterpret_cast<const char*>(file_ids->data()), size_file_ids * sizeof(size_t));
+    }
+}
+
+template<bool IsWriteWords>
+void IndexerBase<IsWriteWords>::ReadFileStateFromBinFile(const char* filename_file_state) {
+    std::ifstream file_state(filename_file_state, std::ios::binary);
+
+    size_t size_file_state = 0;
+    file_state.read(reinterpret_cast<char*>(&size_file_state), sizeof(size_t));
+    if (!file_state) {
+        return;
+    }
+
+    file_state_.reserve(size_file_state);
+    for (size_t i = 0; i < size_file_state; ++i) {
+        size_t file_id;
+        FileState state;
+        file_state.read(reinterpret_cast<char*>(&file_id), sizeof(size_t));
+        file_state.read(reinterpret_cast<char*>(&state), sizeof(FileState));
+
+        file_state_[file_id] = state;
+    }
+
+    std::vector<size_t> tombstones;
+    for (std::vector<size_t>* file_ids : {&tombstones, &free_file_ids_}) {
+        size_t size_file_ids = 0;
+        file_state.read(reinterpret_cast<char*>(&size_file_ids), sizeof(size_t));
+        file_ids->resize(size_file_ids);
+        file_state.read(reinterpret_cast<char*>(file_ids->data()), size_file_ids * sizeof(size_t));
+    }
+    tombstones_.insert(tombstones.begin(), tombstones.end());
+
+    if (!file_state) {
+        throw std::runtime_error("error read file " + std::string(filename_file_state));
+    }
+}
+
+template<bool IsWriteWords>
+uint64_t IndexerBase<IsWriteWords>::TotalFileSize() const {
+    uint64_t total_file_size = 0;
+    for (const auto& [file_id, state] : file_state_) {
+        total_file_size += state.size;
+    }
+
+    return total_file_size;
+}
+
+template<bool IsWriteWords>
+typename IndexerBase<IsWriteWords>::FileState IndexerBase<IsWriteWords>::GetFileState(
+        const std::filesystem::path& file_path) {
+    return FileState{
+        static_cast<int64_t>(std::filesystem::last_write_time(file_path).time_since_epoch().count()),
+        static_cast<uint64_t>(std::filesystem::file_size(file_path)),
+        0
+    };
+}
+
+template<bool IsWriteWords>
+uint64_t IndexerBase<IsWriteWords>::HashFile(const std::filesystem::path& file_path) {
+    std::ifstream file(file_path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("error open file");
+    }
+
+    std::vector<char> buffer(Tokenizer::kBufferSize);
+    uint64_t content_hash = Tokenizer::kHashSeed;
+    while (file.read(buffer.data(), static_cast<std::streamsize>(buffer.size())) || file.gcount() != 0) {
+        content_hash = Tokenizer::HashBytes(content_hash, buffer.data(), static_cast<size_t>(file.gcount()));
+    }
+
+    return content_hash;
+}
+
+template<bool IsWriteWords>
+std::vector<std::filesystem::path> IndexerBase<IsWriteWords>::CollectChangedFiles(
+        const std::filesystem::path& directory_path) {
+    if (!std::filesystem::exists(directory_path) || !std::filesystem::is_directory(directory_path)) {
+        throw std::runtime_error("could not find the folder");
+    }
+
+    std::vector<std::filesystem::path> files;
+    CollectFiles(directory_path, files);
+
+    std::unordered_map<std::string_view, size_t> directory_id;
+    for (const auto& [index, path] : id_directory_) {
+        directory_id[path] = index;
+    }
+
+    std::vector<std::filesystem::path> changed_files;
+    std::unordered_set<size_t> current_file_ids;
+    for (const auto& file_path : files) {
+        auto known_file = directory_id.find(file_path.string());
+        if (known_file == directory_id.end()) {
+            changed_files.push_back(file_path);
+            continue;
+        }
+        current_file_ids.insert(known_file->second);
+
+        FileState state = GetFileState(file_path);
+        auto stored_state = file_state_.find(known_file->second);
+        if (stored_state != file_state_.end() && stored_state->second.modification_time == state.modification_time
+                && stored_state->second.size == state.size) {
+            continue;
+        }
+
+        state.content_hash = HashFile(file_path);
+        if (stored_state != file_state_.end() && stored_state->second.content_hash == state.content_hash) {
+            stored_state->second = state;
+            continue;
+        }
 
-    size_t size_id_directory = 0;
-    file_id_directory.read(reinterpret_cast<char*>(&size_id_directory), sizeof(size_t));
- 
-    for (size_t i = 0; i < size_id_directory; ++i) {
-        size_t id_element_id_directory;
-        file_id_directory.read(reinterpret_cast<char*>(&id_element_id_directory), sizeof(size_t));
-        
-        size_t str_size;
-        file_id_directory.read(reinterpret_cast<char*>(&str_size), sizeof(size_t));
-        std::string value_element_id_directory(str_size, ' ');
-        file_id_directory.read(&value_element_id_directory[0], str_size);
+        RemoveDocument(known_file->second);
+        changed_files.push_back(file_path);
+    }
+
+    for (const auto& [path, index] : directory_id) {
+        if (!current_file_ids.contains(index) && id_directory_.Contains(index)) {
+            RemoveDocument(index);
+        }
+    }
+
+    return changed_files;
+}
 
-        id_directory_[id_element_id_directory] = value_element_id_directory;
+template<bool IsWriteWords>
+void IndexerBase<IsWriteWords>::CheckPositions() const {
+    if (!word_repository_->HasPositions()) {
+        throw std::runtime_error("trie has no token positions, rebuild the index");
     }
 }
 
+template<bool IsWriteWords>
+void IndexerBase<IsWriteWords>::WriteMappedIndexToBinFile(const char* filename_mapped_index) {
+    CheckPositions();
+    MappedIndex::WriteMappedIndex(*word_repository_, id_directory_, document_length_, filename_mapped_index,
+                                  tombstones_);
+}
+
+template<bool IsWriteWords>
+void IndexerBase<IsWriteWords>::ReadIdDirectoryFromBinFile(const char* filename_id_directory) {
+    Trace::ScopedTimer timer(Trace::Phase::kReadIdDirectory);
+    std::ifstream file_id_directory(filename_id_directory, std::ios::binary);
+    id_directory_.Read(file_id_directory);
+}
+
 template<>
 Indexer<true>::Indexer()
     : IndexerBase<true>::IndexerBase()
 {}
 
+template<>
+Indexer<true>::Indexer(const std::string& path_word_repository)
+    : IndexerBase<true>::IndexerBase(path_word_repository)
+{
+    file_id = this->id_directory_.MaxId();
+    for (size_t index : this->tombstones_) {
+        file_id = std::max(file_id, index);
+    }
+    for (size_t index : this->free_file_ids_) {
+        file_id = std::max(file_id, index);
+    }
+}
+
+template<>
+Indexer<false>::Indexer(const std::string& path_word_repository)
+    : IndexerBase<false>::IndexerBase(path_word_repository)
+{}
+
 template<>
 Indexer<false>::Indexer(std::unordered_map<size_t, std::unordered_set<char>> letters_by_level,
         const std::string& path_word_repository)
@@ -98,9 +319,29 @@ Ties::iterator Indexer<IsWriteWords>::SearchWord(const std::string& word) const
     return this->SearchWordAtRepository(word);
 }
 
+template<bool IsWriteWords>
+std::vector<std::string> Indexer<IsWriteWords>::ExpandWildcard(const std::string& pattern,
+        size_t max_expansions) const {
+    return this->word_repository_->ExpandWildcard(this->ProcessingWord(pattern), max_expansions);
+}
+
+template<bool IsWriteWords>
+std::vector<FuzzyTerm> Indexer<IsWriteWords>::ExpandFuzzy(const std::string& word, size_t max_distance,
+        size_t max_expansions) const {
+    return this->word_repository_->ExpandFuzzy(this->ProcessingWord(word), max_distance, max_expansions);
+}
+
 template<>
 Indexer<true>::~Indexer() {
-    SaveIndexer();
+    if (!is_consistent_ || !this->HasPositions()) {
+        return;
+    }
+
+    try {
+        SaveIndexer();
+    } catch (const std::exception& error) {
+        std::cerr << "Error save indexer: " << error.what() << '\n';
+    }
 }
 
 template<>
@@ -122,22 +363,182 @@ bool IndexerBase<IsWriteWords>::IsValidFile(const std::filesystem::path& file_pa
     return kValidExtension.contains(file_path.extension());
 }
 
-template<>
-void Indexer<true>::StartIndexer(const std::filesystem::path& directory_path) {   
-    if (!std::filesystem::exists(directory_path) || !std::filesystem::is_directory(directory_path)) {
-        throw std::runtime_error("could not find the folder");
-    }
+template<bool IsWriteWords>
+bool IndexerBase<IsWriteWords>::VisitFiles(const std::filesystem::path& directory_path,
+        const IndexPipeline::Emit& visit) {
+    std::vector<std::filesystem::directory_entry> entries(
+        std::filesystem::directory_iterator(directory_path), std::filesystem::directory_iterator{});
+    std::sort(entries.begin(), entries.end());
 
-    for (const auto& entry : std::filesystem::directory_iterator(directory_path)) {
+    for (const auto& entry : entries) {
         if (entry.is_directory()) {
-            StartIndexer(entry.path());
+            if (!VisitFiles(entry.path(), visit)) {
+                return false;
+            }
         } else if (entry.is_regular_file()) {
-            if (this->IsValidFile(entry.path())) {
-                ++file_id;
-                this->SaveWordsFromFile(entry.path(), file_id);
+            if (IsValidFile(entry.path()) && !visit(entry.path())) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+template<bool IsWriteWords>
+void IndexerBase<IsWriteWords>::CollectFiles(const std::filesystem::path& directory_path,
+        std::vector<std::filesystem::path>& files) {
+    VisitFiles(directory_path, [&files](const std::filesystem::path& file_path) {
+        files.push_back(file_path);
+        return true;
+    });
+}
+
+template<>
+void Indexer<true>::IndexPipelined(IndexPipeline::Source source, const std::function<size_t()>& next_file_id) {
+    IndexPipeline pipeline(std::move(source), kMaxLenghtWord);
+    Ties::TermCache term_cache(*this->word_repository_);
+    IndexPipeline::Document document;
+
+    while (pipeline.Next(document)) {
+        size_t current_file_id = next_file_id();
+        for (const IndexPipeline::Token& token : document.tokens) {
+            term_cache.insert(token.word, current_file_id, token.position);
+        }
+
+        this->id_directory_.Insert(current_file_id, document.path.string());
+        this->AddDocumentLength(current_file_id, document.document_length);
+        this->file_state_[current_file_id] = FileState{document.modification_time, document.size,
+                                                       document.content_hash};
+    }
+
+    pipeline_stats_ = pipeline.GetStats();
+}
+
+template<>
+void Indexer<true>::IndexFiles(const std::vector<std::filesystem::path>& files, const std::vector<size_t>& file_ids,
+        size_t count_threads) {
+    if (count_threads <= 1) {
+        size_t next_file = 0;
+        IndexPipelined([&files](const IndexPipeline::Emit& emit) {
+            for (const auto& file_path : files) {
+                if (!emit(file_path)) {
+                    return;
+                }
             }
+        }, [&file_ids, &next_file] {
+            return file_ids[next_file++];
+        });
+        return;
+    }
+
+    ThreadPool thread_pool(count_threads);
+    std::vector<Ties> partial_repositories(count_threads);
+    std::vector<size_t> document_lengths(files.size());
+    std::vector<FileState> file_states(files.size());
+
+    for (size_t i = 0; i < files.size(); ++i) {
+        this->id_directory_.Insert(file_ids[i], files[i].string());
+
+        thread_pool.Submit([&partial_repositories, &document_lengths, &file_states, &files, &file_ids, i] {
+            file_states[i] = GetFileState(files[i]);
+            document_lengths[i] = SaveWordsToTies(files[i], file_ids[i],
+                                                  partial_repositories[ThreadPool::CurrentWorker()],
+                                                  &file_states[i].content_hash);
+        });
+    }
+    thread_pool.Wait();
+
+    for (size_t i = 0; i < files.size(); ++i) {
+        this->AddDocumentLength(file_ids[i], document_lengths[i]);
+        this->file_state_[file_ids[i]] = file_states[i];
+    }
+
+    for (Ties& partial_repository : partial_repositories) {
+        this->word_repository_->merge(std::move(partial_repository));
+    }
+}
+
+template<>
+size_t Indexer<true>::NextFileId() {
+    if (this->free_file_ids_.empty()) {
+        return ++file_id;
+    }
+
+    size_t next_file_id = this->free_file_ids_.back();
+    this->free_file_ids_.pop_back();
+    return next_file_id;
+}
+
+template<>
+void Indexer<true>::StartIndexer(const std::filesystem::path& directory_path, size_t count_threads) {
+    if (!std::filesystem::exists(directory_path) || !std::filesystem::is_directory(directory_path)) {
+        throw std::runtime_error("could not find the folder");
+    }
+    this->CheckPositions();
+
+    is_consistent_ = false;
+    if (count_threads <= 1) {
+        IndexPipelined([&directory_path](const IndexPipeline::Emit& emit) {
+            VisitFiles(directory_path, emit);
+        }, [this] {
+            return ++file_id;
+        });
+    } else {
+        std::vector<std::filesystem::path> files;
+        this->CollectFiles(directory_path, files);
+
+        std::vector<size_t> file_ids(files.size());
+        for (size_t& current_file_id : file_ids) {
+            current_file_id = ++file_id;
         }
+
+        IndexFiles(files, file_ids, count_threads);
+    }
+    is_consistent_ = true;
+}
+
+template<>
+void Indexer<true>::Compact() {
+    this->word_repository_->RemoveDocuments(this->tombstones_);
+
+    this->free_file_ids_.insert(this->free_file_ids_.end(), this->tombstones_.begin(), this->tombstones_.end());
+    std::sort(this->free_file_ids_.begin(), this->free_file_ids_.end(), std::greater<size_t>());
+    this->tombstones_.clear();
+}
+
+template<>
+void Indexer<false>::Compact() {
+    throw std::runtime_error("error mode indexer");
+}
+
+template<>
+void Indexer<true>::UpdateIndexer(const std::filesystem::path& directory_path, size_t count_threads) {
+    this->CheckPositions();
+
+    is_consistent_ = false;
+    std::vector<std::filesystem::path> changed_files = this->CollectChangedFiles(directory_path);
+
+    std::vector<size_t> file_ids(changed_files.size());
+    for (size_t& current_file_id : file_ids) {
+        current_file_id = NextFileId();
+    }
+    IndexFiles(changed_files, file_ids, count_threads);
+
+    if (this->tombstones_.size() > kCompactionRatio * this->id_directory_.size()) {
+        Compact();
     }
+    is_consistent_ = true;
+}
+
+template<>
+void Indexer<false>::UpdateIndexer(const std::filesystem::path& directory_path, size_t count_threads) {
+    throw std::runtime_error("error mode indexer");
+}
+
+template<>
+void Indexer<true>::StartIndexer(const std::filesystem::path& directory_path) {
+    StartIndexer(directory_path, 1);
 }
 
 template<>
@@ -145,52 +546,59 @@ void Indexer<false>::StartIndexer(const std::filesystem::path& directory_path) {
     throw std::runtime_error("error mode indexer");
 }
 
+template<>
+void Indexer<false>::StartIndexer(const std::filesystem::path& directory_path, size_t count_threads) {
+    throw std::runtime_error("error mode indexer");
+}
+
 template<bool IsWriteWords>
 std::string IndexerBase<IsWriteWords>::ProcessingWord(const std::string& word) {
-    std::string result_word;
-    
-    for (char symbol : word) {
-        if (std::isalpha(symbol)) {
-            result_word += std::tolower(symbol);
-        } else {
-            result_word += symbol;
-        }
-    }
+    std::string result_word = word;
+    Tokenizer::ToLower(result_word.data(), result_word.size());
 
     return result_word;
 }
 
 template<bool IsWriteWords>
-void Indexer<IsWriteWords>::SaveWordsFromFile(const std::filesystem::path& file_path, size_t& file_id) {
+size_t IndexerBase<IsWriteWords>::SaveWordsToTies(const std::filesystem::path& file_path, size_t file_id,
+        Ties& word_repository, uint64_t* content_hash) {
     if (!std::filesystem::exists(file_path)) {
         throw std::runtime_error("file not found");
     }
-    
-    std::ifstream file(file_path);
-    if (!file.is_open()) {
-        throw std::runtime_error("error open file");
+
+    Tokenizer tokenizer(file_path);
+    Ties::TermCache term_cache(word_repository);
+    std::string_view word;
+    size_t document_length = 0;
+
+    while (tokenizer.Next(word)) {
+        ++document_length;
+        if (word.size() >= kMaxLenghtWord) {
+            continue;
+        }
+
+        term_cache.insert(word, file_id,
+                          PostingCodec::PackPosition(tokenizer.LineNumber(), document_length - 1));
     }
 
-    this->id_directory_[file_id] = file_path;
+    if (content_hash != nullptr) {
+        *content_hash = tokenizer.ContentHash();
+    }
 
-    std::string line;
-    size_t line_number = 0;
-    
-    while (std::getline(file, line)) {
-        ++line_number;
-        std::istringstream line_stream(line);
-        std::string word;
-        while (line_stream >> word) {
-            if (word.size() >= this->kMaxLenghtWord) {
-                continue;
-            }
-            
-            AddWord(this->ProcessingWord(word));
+    return document_length;
+}
 
-            auto iterator_word = this->SearchWordAtRepository(word);
-            iterator_word.insert(file_id, line_number);
-        }
+template<bool IsWriteWords>
+void Indexer<IsWriteWords>::SaveWordsFromFile(const std::filesystem::path& file_path, size_t& file_id) {
+    if constexpr (!IsWriteWords) {
+        throw std::runtime_error("error mode indexer");
     }
+
+    typename IndexerBase<IsWriteWords>::FileState state = this->GetFileState(file_path);
+    size_t document_length = this->SaveWordsToTies(file_path, file_id, *this->word_repository_, &state.content_hash);
+    this->id_directory_.Insert(file_id, file_path.string());
+    this->AddDocumentLength(file_id, document_length);
+    this->file_state_[file_id] = state;
 }
 
 template class Indexer<true>;
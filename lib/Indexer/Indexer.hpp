@@ -1,70 +1,175 @@
 #pragma once
 
 #include <string>
-#include <string>
+#include <vector>
 
+#include "IdDirectory.hpp"
 #include "Ties.hpp"
+#include "MappedIndex.hpp"
+#include "IndexPipeline.hpp"
+#include "Wildcard.hpp"
 
 template<bool IsWriteWords>
 class IndexerBase {
-protected:	
+public:
+    struct FileState {
+        int64_t modification_time;
+        uint64_t size;
+        uint64_t content_hash;
+    };
+
     constexpr static const char* kFileNameTrie = "trie.bin";
     constexpr static const char* kFileNameIdDirectory = "id_directory.bin";
+    constexpr static const char* kFileNameDocumentLength = "document_length.bin";
+    constexpr static const char* kFileNameFileState = "file_state.bin";
+
+    static std::string ProcessingWord(const std::string& word);
+
+    uint64_t TotalFileSize() const;
+protected:	
     constexpr static const size_t kMaxLenghtWord = 32;
 
     static const std::unordered_set<std::string> kValidExtension;
 
     IndexerBase();
+    explicit IndexerBase(const std::string& path_word_repository);
     explicit IndexerBase(std::unordered_map<size_t, std::unordered_set<char>> letters_by_level,
         const std::string& path_word_repository);
 
     Ties::iterator SearchWordAtRepository(const std::string& word) const;
+    void CheckPositions() const;
     void AddWordAtRepository(const std::string& word);
 
     void WriteTiesToBinFile(const std::string& filename_ties = kFileNameTrie);
     void WriteIdDirectoryToBinFile(const char* filename_id_directory = kFileNameIdDirectory);
+    void WriteDocumentLengthToBinFile(const char* filename_document_length = kFileNameDocumentLength);
+    void WriteMappedIndexToBinFile(const char* filename_mapped_index = MappedIndex::kFileNameMappedIndex);
+    void WriteFileStateToBinFile(const char* filename_file_state = kFileNameFileState);
 
-    std::string StringIndexFromUnMap(size_t index) {
+    std::string_view StringIndexFromUnMap(size_t index) const {
         return id_directory_[index];
     }
 
+    size_t DocumentLengthFromUnMap(size_t index) const {
+        auto document_length = document_length_.find(index);
+        return document_length == document_length_.end() ? 0 : document_length->second;
+    }
+
+    double AverageDocumentLengthFromUnMap() const {
+        return document_length_.empty() ? 0.0 : static_cast<double>(total_document_length_) / document_length_.size();
+    }
+
     std::unique_ptr<Ties> word_repository_;
-    std::unordered_map<size_t, std::string> id_directory_;
+    IdDirectory id_directory_;
+    std::unordered_map<size_t, size_t> document_length_;
+    size_t total_document_length_ = 0;
+    std::unordered_map<size_t, FileState> file_state_;
+    std::unordered_set<size_t> tombstones_;
+    std::vector<size_t> free_file_ids_;
 
     static bool IsValidFile(const std::filesystem::path& file_path);
-    static std::string ProcessingWord(const std::string& word);
-private:
+    static void CollectFiles(const std::filesystem::path& directory_path, std::vector<std::filesystem::path>& files);
+    static bool VisitFiles(const std::filesystem::path& directory_path, const IndexPipeline::Emit& visit);
+    static size_t SaveWordsToTies(const std::filesystem::path& file_path, size_t file_id, Ties& word_repository,
+        uint64_t* content_hash = nullptr);
+    static FileState GetFileState(const std::filesystem::path& file_path);
+    static uint64_t HashFile(const std::filesystem::path& file_path);
+    void AddDocumentLength(size_t file_id, size_t document_length);
+    void RemoveDocument(size_t file_id);
+    std::vector<std::filesystem::path> CollectChangedFiles(const std::filesystem::path& directory_path);
+
     void ReadIdDirectoryFromBinFile(const char* filename_id_directory = kFileNameIdDirectory);
+    void ReadDocumentLengthFromBinFile(const char* filename_document_length = kFileNameDocumentLength);
+    void ReadFileStateFromBinFile(const char* filename_file_state = kFileNameFileState);
 };
 
 template<bool IsWriteWords>
 struct Indexer : IndexerBase<IsWriteWords> {
+    using iterator = Ties::iterator;
+
+    constexpr static const double kCompactionRatio = 0.1;
+
     Indexer();
+    explicit Indexer(const std::string& path_word_repository);
     explicit Indexer(std::unordered_map<size_t, std::unordered_set<char>> letters_by_level,
         const std::string& path_word_repository = IndexerBase<IsWriteWords>::kFileNameTrie);
 
 
     Ties::iterator SearchWord(const std::string& word) const;
+    std::vector<std::string> ExpandWildcard(const std::string& pattern,
+        size_t max_expansions = Wildcard::kMaxExpansions) const;
+    std::vector<FuzzyTerm> ExpandFuzzy(const std::string& word, size_t max_distance,
+        size_t max_expansions = LevenshteinAutomaton::kMaxExpansions) const;
     void AddWord(const std::string& word);
     void StartIndexer(const std::filesystem::path& directory_path);
+    void StartIndexer(const std::filesystem::path& directory_path, size_t count_threads);
+    void UpdateIndexer(const std::filesystem::path& directory_path, size_t count_threads = 1);
+    void Compact();
     void SaveWordsFromFile(const std::filesystem::path& file_path, size_t& file_id);
 
-    std::string StringIndex(size_t index) {
+    std::string_view StringIndex(size_t index) const {
         return this->StringIndexFromUnMap(index);
     }
 
+    size_t DocumentLength(size_t index) const {
+        return this->DocumentLengthFromUnMap(index);
+    }
+
+    double AverageDocumentLength() const {
+        return this->AverageDocumentLengthFromUnMap();
+    }
+
+    size_t CountDocuments() const {
+        return this->id_directory_.size();
+    }
+
+    bool ContainsDocument(size_t index) const {
+        return this->id_directory_.Contains(index);
+    }
+
+    bool HasPositions() const {
+        return this->word_repository_->HasPositions();
+    }
+
+    bool HasDeletedDocuments() const {
+        return !this->tombstones_.empty();
+    }
+
+    size_t CountTombstones() const {
+        return this->tombstones_.size();
+    }
+
+    const IndexPipeline::Stats& PipelineStats() const {
+        return pipeline_stats_;
+    }
+
     Ties::iterator begin() const;
     Ties::iterator end() const;
 
     void SaveIndexer() {
+        this->CheckPositions();
         this->WriteTiesToBinFile();
         this->WriteIdDirectoryToBinFile();
+        this->WriteDocumentLengthToBinFile();
+        this->WriteMappedIndexToBinFile();
+        this->WriteFileStateToBinFile();
+    }
+
+    void ConvertToMappedIndex(const char* filename_mapped_index = MappedIndex::kFileNameMappedIndex) {
+        this->WriteMappedIndexToBinFile(filename_mapped_index);
     }
     
     ~Indexer();
 
     size_t file_id = 0;
+private:
+    size_t NextFileId();
+    void IndexFiles(const std::vector<std::filesystem::path>& files, const std::vector<size_t>& file_ids,
+        size_t count_threads);
+    void IndexPipelined(IndexPipeline::Source source, const std::function<size_t()>& next_file_id);
 
+    IndexPipeline::Stats pipeline_stats_;
+    bool is_consistent_ = true;
 };
 
 
@@ -0,0 +1,81 @@
+#include "LevenshteinAutomaton.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+LevenshteinAutomaton::LevenshteinAutomaton(std::string_view word, size_t max_distance)
+    : word_(word)
+    , max_distance_(static_cast<uint8_t>(std::min(max_distance, kMaxDistance)))
+{
+    if (max_distance > kMaxDistance) {
+        throw std::invalid_argument("fuzzy distance must be at most " + std::to_string(kMaxDistance));
+    }
+}
+
+LevenshteinAutomaton::State LevenshteinAutomaton::Start() const {
+    State state(word_.size() + 1);
+    for (size_t i = 0; i < state.size(); ++i) {
+        state[i] = static_cast<uint8_t>(std::min<size_t>(i, max_distance_ + 1));
+    }
+
+    return state;
+}
+
+void LevenshteinAutomaton::Step(const State& state, char symbol, State& next) const {
+    uint8_t limit = max_distance_ + 1;
+    next.resize(state.size());
+    next[0] = std::min<uint8_t>(state[0] + 1, limit);
+
+    for (size_t i = 1; i < state.size(); ++i) {
+        uint8_t cost = std::min<uint8_t>(next[i - 1], state[i]) + 1;
+        cost = std::min<uint8_t>(cost, state[i - 1] + (word_[i - 1] == symbol ? 0 : 1));
+        next[i] = std::min(cost, limit);
+    }
+}
+
+bool LevenshteinAutomaton::CanMatch(const State& state) const {
+    return *std::min_element(state.begin(), state.end()) <= max_distance_;
+}
+
+bool LevenshteinAutomaton::IsMatch(const State& state) const {
+    return state.back() <= max_distance_;
+}
+
+size_t LevenshteinAutomaton::Distance(const State& state) const {
+    return state.back();
+}
+
+bool LevenshteinAutomaton::ParseFuzzy(const std::string& word, std::string& term, size_t& max_distance) {
+    size_t fuzzy = word.rfind(kFuzzy);
+    if (fuzzy == std::string::npos || fuzzy == 0) {
+        return false;
+    }
+
+    std::string_view distance(word.data() + fuzzy + 1, word.size() - fuzzy - 1);
+    if (!std::all_of(distance.begin(), distance.end(), [](char symbol) { return symbol >= '0' && symbol <= '9'; })) {
+        return false;
+    }
+
+    max_distance = distance.empty() ? kMaxDistance : std::stoul(std::string(distance));
+    if (max_distance > kMaxDistance) {
+        throw std::invalid_argument("fuzzy distance must be at most " + std::to_string(kMaxDistance));
+    }
+    term = word.substr(0, fuzzy);
+
+    return true;
+}
+
+bool LevenshteinAutomaton::IsFuzzy(const std::string& word) {
+    std::string term;
+    size_t max_distance = 0;
+    return ParseFuzzy(word, term, max_distance);
+}
+
+void LevenshteinAutomaton::SelectClosest(std::vector<FuzzyTerm>& terms, size_t max_expansions) {
+    std::sort(terms.begin(), terms.end(), [](const FuzzyTerm& lhs, const FuzzyTerm& rhs) {
+        return lhs.distance < rhs.distance || (lhs.distance == rhs.distance && lhs.term < rhs.term);
+    });
+    if (terms.size() > max_expansions) {
+        terms.resize(max_expansions);
+    }
+}
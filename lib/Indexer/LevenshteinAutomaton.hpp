@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct FuzzyTerm {
+    std::string term;
+    size_t distance;
+};
+
+class LevenshteinAutomaton {
+public:
+    using State = std::vector<uint8_t>;
+
+    constexpr static const char kFuzzy = '~';
+    constexpr static const size_t kMaxDistance = 2;
+    constexpr static const size_t kMaxExpansions = 64;
+
+    LevenshteinAutomaton(std::string_view word, size_t max_distance);
+
+    State Start() const;
+    void Step(const State& state, char symbol, State& next) const;
+    bool CanMatch(const State& state) const;
+    bool IsMatch(const State& state) const;
+    size_t Distance(const State& state) const;
+
+    static bool ParseFuzzy(const std::string& word, std::string& term, size_t& max_distance);
+    static bool IsFuzzy(const std::string& word);
+    static void SelectClosest(std::vector<FuzzyTerm>& terms, size_t max_expansions);
+private:
+    std::string word_;
+    uint8_t max_distance_;
+};
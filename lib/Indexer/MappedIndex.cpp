@@ -0,0 +1,955 @@
+#include "MappedIndex.hpp"
+#include "PostingCodec.hpp"
+#include "Tokenizer.hpp"
+#include "../Searcher/Searcher.hpp"
+#include "../Trace/Trace.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <limits>
+#include <numeric>
+#include <ranges>
+#include <fstream>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t kSectionAlignment = 8;
+
+std::string ProcessingWord(const std::string& word) {
+    std::string result_word = word;
+    Tokenizer::ToLower(result_word.data(), result_word.size());
+
+    return result_word;
+}
+
+uint64_t AlignOffset(uint64_t offset) {
+    return (offset + kSectionAlignment - 1) / kSectionAlignment * kSectionAlignment;
+}
+
+uint64_t AlignSection(std::ofstream& file_mapped, uint64_t offset) {
+    static const char kPadding[kSectionAlignment] = {};
+
+    uint64_t section_offset = AlignOffset(offset);
+    file_mapped.write(kPadding, static_cast<std::streamsize>(section_offset - offset));
+
+    return section_offset;
+}
+
+template<typename T>
+uint64_t WriteSection(std::ofstream& file_mapped, uint64_t offset, const std::vector<T>& section) {
+    uint64_t section_offset = AlignSection(file_mapped, offset);
+    file_mapped.write(reinterpret_cast<const char*>(section.data()),
+                      static_cast<std::streamsize>(section.size() * sizeof(T)));
+
+    return section_offset;
+}
+
+}
+
+void MappedIndex::SuffixTable::Add(std::string_view term, uint32_t node) {
+    strings.insert(strings.end(), term.rbegin(), term.rend());
+    offsets.push_back(static_cast<uint32_t>(strings.size()));
+    nodes.push_back(node);
+}
+
+void MappedIndex::SuffixTable::Sort() {
+    auto reversed_term = [this](uint32_t index) {
+        return std::string_view(strings.data() + offsets[index], offsets[index + 1] - offsets[index]);
+    };
+
+    std::vector<uint32_t> permutation(nodes.size());
+    std::iota(permutation.begin(), permutation.end(), 0);
+    std::sort(permutation.begin(), permutation.end(), [&reversed_term](uint32_t lhs, uint32_t rhs) {
+        return reversed_term(lhs) < reversed_term(rhs);
+    });
+
+    SuffixTable sorted;
+    sorted.nodes.reserve(nodes.size());
+    sorted.offsets.reserve(offsets.size());
+    sorted.strings.reserve(strings.size());
+    for (uint32_t index : permutation) {
+        std::string_view term = reversed_term(index);
+        sorted.strings.insert(sorted.strings.end(), term.begin(), term.end());
+        sorted.offsets.push_back(static_cast<uint32_t>(sorted.strings.size()));
+        sorted.nodes.push_back(nodes[index]);
+    }
+
+    *this = std::move(sorted);
+}
+
+MappedIndex::MappedIterator::MappedIterator(const MappedIndex* index, uint32_t current_node)
+    : index_(index)
+    , current_node_(current_node)
+{}
+
+char MappedIndex::MappedIterator::operator*() const {
+    if (current_node_ == kNullNode) {
+        return '\0';
+    }
+
+    return index_->symbols_[current_node_];
+}
+
+const MappedIndex::DecodedPostings& MappedIndex::MappedIterator::Decode() const {
+    if (decoded_ != nullptr) {
+        return *decoded_;
+    }
+
+    decoded_ = std::make_shared<DecodedPostings>();
+    if (current_node_ == kNullNode) {
+        return *decoded_;
+    }
+
+    const uint8_t* input = index_->DecodeNodePostings(current_node_, decoded_->file_ids, decoded_->lines_size,
+                                                      decoded_->lines_offset);
+
+    uint64_t lines_offset = input - index_->postings_;
+    for (uint64_t& offset : decoded_->lines_offset) {
+        uint64_t size = offset;
+        offset = lines_offset;
+        lines_offset += size;
+    }
+
+    return *decoded_;
+}
+
+size_t MappedIndex::MappedIterator::FindPosting(size_t index) const {
+    const std::vector<uint64_t>& file_ids = Decode().file_ids;
+
+    auto posting = std::lower_bound(file_ids.begin(), file_ids.end(), index);
+    if (posting == file_ids.end() || *posting != index) {
+        return file_ids.size();
+    }
+
+    return posting - file_ids.begin();
+}
+
+const std::vector<uint64_t>* MappedIndex::MappedIterator::GetLines(size_t index) const {
+    size_t posting = FindPosting(index);
+    if (posting == decoded_->file_ids.size()) {
+        return nullptr;
+    }
+
+    auto [lines, is_inserted] = decoded_->lines.try_emplace(index);
+    if (is_inserted) {
+        PostingCodec::DecodePositions(index_->postings_ + decoded_->lines_offset[posting],
+                                      decoded_->lines_size[posting], lines->second);
+    }
+
+    return &lines->second;
+}
+
+const uint64_t* MappedIndex::MappedIterator::GetStartArray(size_t index) const {
+    const std::vector<uint64_t>* lines = GetLines(index);
+    if (lines == nullptr) {
+        return nullptr;
+    }
+
+    return lines->data();
+}
+
+const uint64_t* MappedIndex::MappedIterator::GetEndArray(size_t index) const {
+    const std::vector<uint64_t>* lines = GetLines(index);
+    if (lines == nullptr) {
+        return nullptr;
+    }
+
+    return lines->data() + lines->size();
+}
+
+const std::vector<uint64_t>& MappedIndex::MappedIterator::GetSortedKeys() const {
+    return Decode().file_ids;
+}
+
+const std::vector<uint64_t>& MappedIndex::MappedIterator::GetSortedFrequencies() const {
+    return Decode().lines_size;
+}
+
+double MappedIndex::MappedIterator::MaxScore() const {
+    if (current_node_ == kNullNode) {
+        return 0.0;
+    }
+
+    return index_->nodes_[current_node_].max_score;
+}
+
+std::unordered_set<size_t> MappedIndex::MappedIterator::GetKeyArray() const {
+    const std::vector<uint64_t>& file_ids = Decode().file_ids;
+    return std::unordered_set<size_t>(file_ids.begin(), file_ids.end());
+}
+
+bool MappedIndex::MappedIterator::empty(size_t index) const {
+    return size(index) == 0;
+}
+
+size_t MappedIndex::MappedIterator::size(size_t index) const {
+    size_t posting = FindPosting(index);
+    if (posting == decoded_->file_ids.size()) {
+        return 0;
+    }
+
+    return decoded_->lines_size[posting];
+}
+
+MappedIndex::MappedIndex(const std::string& path_mapped_index) {
+    Trace::ScopedTimer timer(Trace::Phase::kLoadMappedIndex);
+    int file_descriptor = open(path_mapped_index.c_str(), O_RDONLY);
+    if (file_descriptor == -1) {
+        throw std::runtime_error("error open file " + path_mapped_index);
+    }
+
+    struct stat file_stat;
+    if (fstat(file_descriptor, &file_stat) == -1 || static_cast<size_t>(file_stat.st_size) < sizeof(MappedHeader)) {
+        close(file_descriptor);
+        throw std::runtime_error("invalid mapped index " + path_mapped_index);
+    }
+
+    size_ = static_cast<size_t>(file_stat.st_size);
+    void* data = mmap(nullptr, size_, PROT_READ, MAP_SHARED, file_descriptor, 0);
+    close(file_descriptor);
+
+    if (data == MAP_FAILED) {
+        throw std::runtime_error("error mmap file " + path_mapped_index);
+    }
+    data_ = static_cast<const char*>(data);
+
+    header_ = Section<MappedHeader>(0);
+    if (!IsValidHeader()) {
+        munmap(const_cast<char*>(data_), size_);
+        throw std::runtime_error("invalid mapped index " + path_mapped_index);
+    }
+
+    symbols_ = Section<char>(header_->symbols_offset);
+    nodes_ = Section<MappedNode>(header_->nodes_offset);
+    postings_ = Section<uint8_t>(header_->postings_offset);
+    directory_ = Section<MappedDirectoryEntry>(header_->directory_offset);
+    directory_strings_ = Section<char>(header_->directory_strings_offset);
+    suffix_nodes_ = Section<uint32_t>(header_->suffix_nodes_offset);
+    suffix_offsets_ = Section<uint32_t>(header_->suffix_offsets_offset);
+    suffix_strings_ = Section<char>(header_->suffix_strings_offset);
+}
+
+bool MappedIndex::IsValidHeader() const {
+    if (std::memcmp(header_->magic, kMagic, sizeof(kMagic)) != 0 || header_->file_size != size_
+            || header_->count_node == 0) {
+        return false;
+    }
+
+    return IsSectionInBounds<char>(header_->symbols_offset, header_->count_node)
+        && IsSectionInBounds<MappedNode>(header_->nodes_offset, header_->count_node)
+        && IsSectionInBounds<uint8_t>(header_->postings_offset, header_->count_postings_byte)
+        && IsSectionInBounds<MappedDirectoryEntry>(header_->directory_offset, header_->count_file)
+        && IsSectionInBounds<char>(header_->directory_strings_offset, 0)
+        && IsSectionInBounds<uint32_t>(header_->suffix_nodes_offset, header_->count_term)
+        && header_->count_term < std::numeric_limits<uint64_t>::max()
+        && IsSectionInBounds<uint32_t>(header_->suffix_offsets_offset, header_->count_term + 1)
+        && IsSectionInBounds<char>(header_->suffix_strings_offset, 0);
+}
+
+MappedIndex::~MappedIndex() {
+    if (data_ != nullptr) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+}
+
+uint32_t MappedIndex::FindChild(uint32_t node, char symbol) const {
+    const MappedNode& parent = nodes_[node];
+    const char* begin = symbols_ + parent.children_begin;
+    const void* found = std::memchr(begin, symbol, parent.children_size);
+
+    if (found == nullptr) {
+        return kNullNode;
+    }
+
+    return parent.children_begin + static_cast<uint32_t>(static_cast<const char*>(found) - begin);
+}
+
+MappedIndex::iterator MappedIndex::SearchWord(const std::string& word) const {
+    std::string processing_word = ProcessingWord(word);
+    uint32_t current_node = 0;
+
+    for (char symbol : processing_word) {
+        current_node = FindChild(current_node, symbol);
+        if (current_node == kNullNode) {
+            return end();
+        }
+    }
+
+    if (nodes_[current_node].postings_size == 0) {
+        return end();
+    }
+
+    return iterator(this, current_node);
+}
+
+std::string_view MappedIndex::ReversedTerm(size_t index) const {
+    return std::string_view(suffix_strings_ + suffix_offsets_[index], suffix_offsets_[index + 1] - suffix_offsets_[index]);
+}
+
+std::vector<std::string> MappedIndex::ExpandWildcard(const std::string& pattern, size_t max_expansions) const {
+    std::string processing_pattern = ProcessingWord(pattern);
+    std::string_view prefix = Wildcard::LiteralPrefix(processing_pattern);
+    std::string_view suffix = Wildcard::LiteralSuffix(processing_pattern);
+    std::vector<std::string> terms;
+
+    if (suffix.size() > prefix.size()) {
+        std::string reversed_suffix(suffix.rbegin(), suffix.rend());
+        auto term_indexes = std::views::iota(size_t(0), static_cast<size_t>(header_->count_term));
+        auto first = std::ranges::lower_bound(term_indexes, std::string_view(reversed_suffix), {},
+            [this](size_t index) { return ReversedTerm(index); });
+
+        for (auto it = first; it != term_indexes.end() && ReversedTerm(*it).starts_with(reversed_suffix); ++it) {
+            std::string_view reversed_term = ReversedTerm(*it);
+            std::string term(reversed_term.rbegin(), reversed_term.rend());
+            if (Wildcard::Match(processing_pattern, term)) {
+                terms.push_back(std::move(term));
+                Wildcard::CheckExpansions(terms.size(), pattern, max_expansions);
+            }
+        }
+    } else {
+        uint32_t prefix_node = 0;
+        for (char symbol : prefix) {
+            prefix_node = FindChild(prefix_node, symbol);
+            if (prefix_node == kNullNode) {
+                return terms;
+            }
+        }
+
+        std::string term(prefix);
+        std::vector<std::pair<uint32_t, size_t>> stack = {{prefix_node, prefix.size()}};
+        while (!stack.empty()) {
+            auto [node, depth] = stack.back();
+            stack.pop_back();
+
+            if (depth > prefix.size()) {
+                term.resize(depth - 1);
+                term.push_back(symbols_[node]);
+            }
+
+            const MappedNode& mapped_node = nodes_[node];
+            if (mapped_node.postings_size != 0 && Wildcard::Match(processing_pattern, term)) {
+                terms.push_back(term);
+                Wildcard::CheckExpansions(terms.size(), pattern, max_expansions);
+            }
+
+            for (uint32_t i = 0; i < mapped_node.children_size; ++i) {
+                stack.emplace_back(mapped_node.children_begin + i, depth + 1);
+            }
+        }
+    }
+    std::sort(terms.begin(), terms.end());
+
+    return terms;
+}
+
+std::vector<FuzzyTerm> MappedIndex::ExpandFuzzy(const std::string& word, size_t max_distance,
+        size_t max_expansions) const {
+    LevenshteinAutomaton automaton(ProcessingWord(word), max_distance);
+    std::vector<LevenshteinAutomaton::State> states = {automaton.Start()};
+    std::vector<FuzzyTerm> terms;
+    std::string term;
+
+    std::vector<std::pair<uint32_t, size_t>> stack = {{0, 0}};
+    while (!stack.empty()) {
+        auto [node, depth] = stack.back();
+        stack.pop_back();
+
+        if (depth > 0) {
+            term.resize(depth - 1);
+            term.push_back(symbols_[node]);
+            if (states.size() <= depth) {
+                states.resize(depth + 1);
+            }
+
+            automaton.Step(states[depth - 1], term.back(), states[depth]);
+            if (!automaton.CanMatch(states[depth])) {
+                continue;
+            }
+
+            if (nodes_[node].postings_size != 0 && automaton.IsMatch(states[depth])) {
+                terms.push_back(FuzzyTerm{term, automaton.Distance(states[depth])});
+            }
+        }
+
+        const MappedNode& mapped_node = nodes_[node];
+        for (uint32_t i = 0; i < mapped_node.children_size; ++i) {
+            stack.emplace_back(mapped_node.children_begin + i, depth + 1);
+        }
+    }
+    LevenshteinAutomaton::SelectClosest(terms, max_expansions);
+
+    return terms;
+}
+
+MappedIndex::iterator MappedIndex::begin() const {
+    return iterator(this, 0);
+}
+
+MappedIndex::iterator MappedIndex::end() const {
+    return iterator(this, kNullNode);
+}
+
+const MappedIndex::MappedDirectoryEntry* MappedIndex::FindDirectoryEntry(size_t index) const {
+    const MappedDirectoryEntry* begin = directory_;
+    const MappedDirectoryEntry* end = directory_ + header_->count_file;
+    if (index != 0 && index <= header_->count_file && directory_[index - 1].file_id == index) {
+        return directory_ + index - 1;
+    }
+
+    const MappedDirectoryEntry* entry = std::lower_bound(begin, end, index,
+        [](const MappedDirectoryEntry& lhs, size_t file_id) { return lhs.file_id < file_id; });
+    if (entry == end || entry->file_id != index) {
+        return nullptr;
+    }
+
+    return entry;
+}
+
+std::string_view MappedIndex::StringIndex(size_t index) const {
+    const MappedDirectoryEntry* entry = FindDirectoryEntry(index);
+    if (entry == nullptr) {
+        return std::string_view();
+    }
+
+    return std::string_view(directory_strings_ + entry->offset, entry->size);
+}
+
+size_t MappedIndex::DocumentLength(size_t index) const {
+    const MappedDirectoryEntry* entry = FindDirectoryEntry(index);
+    if (entry == nullptr) {
+        return 0;
+    }
+
+    return entry->document_length;
+}
+
+double MappedIndex::AverageDocumentLength() const {
+    if (header_->count_file == 0) {
+        return 0.0;
+    }
+
+    return static_cast<double>(header_->total_document_length) / header_->count_file;
+}
+
+size_t MappedIndex::CountDocuments() const {
+    return header_->count_file;
+}
+
+size_t MappedIndex::CountFile() const {
+    return header_->count_file;
+}
+
+uint64_t MappedIndex::TotalDocumentLength() const {
+    return header_->total_document_length;
+}
+
+bool MappedIndex::ContainsDocument(size_t index) const {
+    return FindDirectoryEntry(index) != nullptr;
+}
+
+const uint8_t* MappedIndex::DecodeNodePostings(uint32_t node, std::vector<uint64_t>& file_ids,
+        std::vector<uint64_t>& lines_size, std::vector<uint64_t>& lines_byte_size) const {
+    const MappedNode& mapped_node = nodes_[node];
+    const uint8_t* input = postings_ + mapped_node.postings_offset;
+
+    input = PostingCodec::DecodeList(input, mapped_node.postings_size, true, file_ids);
+    input = PostingCodec::DecodeList(input, mapped_node.postings_size, false, lines_size);
+    input = PostingCodec::DecodeList(input, mapped_node.postings_size, false, lines_byte_size);
+
+    return input;
+}
+
+size_t MappedIndex::Prewarm() const {
+    madvise(const_cast<char*>(data_), size_, MADV_WILLNEED);
+
+    size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t checksum = 0;
+    for (size_t offset = 0; offset < size_; offset += page_size) {
+        checksum += static_cast<unsigned char>(*static_cast<const volatile char*>(data_ + offset));
+    }
+
+    return checksum;
+}
+
+uint64_t MappedIndex::BuildDirectory(const IdDirectory& id_directory,
+        const std::unordered_map<size_t, size_t>& document_length,
+        std::vector<MappedDirectoryEntry>& directory,
+        std::vector<char>& directory_strings) {
+    directory.reserve(id_directory.size());
+    directory_strings.reserve(id_directory.BlobSize());
+
+    uint64_t total_document_length = 0;
+    for (const auto& [file_id, path] : id_directory) {
+        auto file_document_length = document_length.find(file_id);
+        uint64_t length = file_document_length == document_length.end() ? 0 : file_document_length->second;
+
+        directory.push_back(MappedDirectoryEntry{file_id, directory_strings.size(), path.size(), length});
+        directory_strings.insert(directory_strings.end(), path.begin(), path.end());
+        total_document_length += length;
+    }
+
+    return total_document_length;
+}
+
+void MappedIndex::WriteMappedIndex(const Ties& word_repository,
+        const IdDirectory& id_directory,
+        const std::unordered_map<size_t, size_t>& document_length,
+        const std::string& path_mapped_index,
+        const std::unordered_set<size_t>& deleted_file_ids) {
+    const Ties::TiesArena& arena = *word_repository.arena_;
+
+    std::vector<MappedDirectoryEntry> directory;
+    std::vector<char> directory_strings;
+    uint64_t total_document_length = BuildDirectory(id_directory, document_length, directory, directory_strings);
+
+    double average_document_length = directory.empty() ? 0.0
+        : static_cast<double>(total_document_length) / directory.size();
+    Searcher searcher(average_document_length, directory.size());
+    auto file_document_length = [&document_length](size_t file_id) -> size_t {
+        auto length = document_length.find(file_id);
+        return length == document_length.end() ? 0 : length->second;
+    };
+
+    std::vector<uint32_t> order = {Ties::kHeadNode};
+    std::vector<char> symbols;
+    std::vector<MappedNode> nodes;
+    std::vector<uint8_t> postings;
+
+    std::vector<uint64_t> file_ids;
+    std::vector<uint64_t> lines_size;
+    std::vector<uint64_t> lines_byte_size;
+    std::vector<uint8_t> lines_buffer;
+    std::vector<uint64_t> lines;
+
+    for (size_t i = 0; i < order.size(); ++i) {
+        const Ties::TiesNode& node = arena.nodes[order[i]];
+
+        MappedNode mapped_node{static_cast<uint32_t>(order.size()), node.children_size, 0, 0, postings.size()};
+        for (uint32_t j = 0; j < node.children_size; ++j) {
+            order.push_back(arena.child_nodes[node.children_begin + j]);
+        }
+
+        const Ties::Postings* node_postings = arena.GetPostings(order[i]);
+        if (node_postings != nullptr && !node_postings->empty()) {
+            file_ids.clear();
+            lines_size.clear();
+            lines_byte_size.clear();
+            lines_buffer.clear();
+
+            for (size_t posting = 0; posting < node_postings->size(); ++posting) {
+                if (deleted_file_ids.contains(node_postings->file_ids[posting])) {
+                    continue;
+                }
+
+                file_ids.push_back(node_postings->file_ids[posting]);
+                node_postings->GetPositions(posting, lines);
+
+                size_t lines_begin = lines_buffer.size();
+                PostingCodec::EncodePositions(lines, lines_buffer);
+                lines_size.push_back(lines.size());
+                lines_byte_size.push_back(lines_buffer.size() - lines_begin);
+            }
+
+            PostingCodec::EncodeList(file_ids, true, postings);
+            PostingCodec::EncodeList(lines_size, false, postings);
+            PostingCodec::EncodeList(lines_byte_size, false, postings);
+            postings.insert(postings.end(), lines_buffer.begin(), lines_buffer.end());
+
+            mapped_node.postings_size = static_cast<uint32_t>(file_ids.size());
+            float max_score = static_cast<float>(searcher.GetMaxScore(file_ids, lines_size, file_document_length));
+            mapped_node.max_score = std::nextafter(max_score, std::numeric_limits<float>::infinity());
+        }
+
+        symbols.push_back(node.symbol);
+        nodes.push_back(mapped_node);
+    }
+
+    MappedHeader header = {};
+    header.total_document_length = total_document_length;
+    WriteMappedFile(path_mapped_index, header, symbols, nodes, postings, directory, directory_strings);
+}
+
+size_t MappedIndex::MergeMappedIndex(const std::vector<const MappedIndex*>& segments,
+        const std::string& path_mapped_index,
+        const std::unordered_set<size_t>& deleted_file_ids) {
+    std::vector<MappedDirectoryEntry> directory;
+    std::vector<char> directory_strings;
+    std::unordered_map<size_t, size_t> document_length;
+    uint64_t total_document_length = 0;
+    for (const MappedIndex* segment : segments) {
+        for (size_t i = 0; i < segment->header_->count_file; ++i) {
+            const MappedDirectoryEntry& entry = segment->directory_[i];
+            if (deleted_file_ids.contains(entry.file_id)) {
+                continue;
+            }
+
+            const char* path = segment->directory_strings_ + entry.offset;
+            directory.push_back(MappedDirectoryEntry{entry.file_id, directory_strings.size(), entry.size,
+                                                     entry.document_length});
+            directory_strings.insert(directory_strings.end(), path, path + entry.size);
+            document_length[entry.file_id] = entry.document_length;
+            total_document_length += entry.document_length;
+        }
+    }
+    std::sort(directory.begin(), directory.end(), [](const MappedDirectoryEntry& lhs, const MappedDirectoryEntry& rhs) {
+        return lhs.file_id < rhs.file_id;
+    });
+
+    double average_document_length = directory.empty() ? 0.0
+        : static_cast<double>(total_document_length) / directory.size();
+    Searcher searcher(average_document_length, directory.size());
+    auto file_document_length = [&document_length](size_t file_id) -> size_t {
+        auto length = document_length.find(file_id);
+        return length == document_length.end() ? 0 : length->second;
+    };
+
+    struct MergedPosting {
+        uint64_t file_id;
+        uint64_t lines_size;
+        uint64_t lines_byte_size;
+        const uint8_t* lines;
+    };
+
+    using SourceNode = std::pair<size_t, uint32_t>;
+    std::deque<std::vector<SourceNode>> order(1);
+    for (size_t i = 0; i < segments.size(); ++i) {
+        order.front().emplace_back(i, 0);
+    }
+    uint32_t count_order = 1;
+
+    std::vector<char> symbols;
+    std::vector<MappedNode> nodes;
+    std::vector<uint8_t> postings;
+
+    std::vector<std::tuple<char, size_t, uint32_t>> children;
+    std::vector<MergedPosting> merged_postings;
+    std::vector<uint64_t> file_ids;
+    std::vector<uint64_t> lines_size;
+    std::vector<uint64_t> lines_byte_size;
+
+    while (!order.empty()) {
+        std::vector<SourceNode> sources = std::move(order.front());
+        order.pop_front();
+
+        children.clear();
+        merged_postings.clear();
+        for (const auto& [segment, node] : sources) {
+            const MappedIndex& index = *segments[segment];
+            const MappedNode& source_node = index.nodes_[node];
+            for (uint32_t j = 0; j < source_node.children_size; ++j) {
+                uint32_t child = source_node.children_begin + j;
+                children.emplace_back(index.symbols_[child], segment, child);
+            }
+
+            if (source_node.postings_size == 0) {
+                continue;
+            }
+
+            const uint8_t* lines = index.DecodeNodePostings(node, file_ids, lines_size, lines_byte_size);
+            for (size_t j = 0; j < file_ids.size(); ++j) {
+                if (!deleted_file_ids.contains(file_ids[j])) {
+                    merged_postings.push_back(MergedPosting{file_ids[j], lines_size[j], lines_byte_size[j], lines});
+                }
+                lines += lines_byte_size[j];
+            }
+        }
+        std::sort(children.begin(), children.end());
+
+        MappedNode mapped_node{count_order, 0, 0, 0, postings.size()};
+        for (size_t j = 0; j < children.size();) {
+            char symbol = std::get<0>(children[j]);
+            std::vector<SourceNode> child_sources;
+            for (; j < children.size() && std::get<0>(children[j]) == symbol; ++j) {
+                child_sources.emplace_back(std::get<1>(children[j]), std::get<2>(children[j]));
+            }
+            order.push_back(std::move(child_sources));
+            ++mapped_node.children_size;
+        }
+        count_order += mapped_node.children_size;
+
+        if (!merged_postings.empty()) {
+            std::sort(merged_postings.begin(), merged_postings.end(),
+                [](const MergedPosting& lhs, const MergedPosting& rhs) { return lhs.file_id < rhs.file_id; });
+
+            file_ids.clear();
+            lines_size.clear();
+            lines_byte_size.clear();
+            for (const MergedPosting& posting : merged_postings) {
+                file_ids.push_back(posting.file_id);
+                lines_size.push_back(posting.lines_size);
+                lines_byte_size.push_back(posting.lines_byte_size);
+            }
+
+            PostingCodec::EncodeList(file_ids, true, postings);
+            PostingCodec::EncodeList(lines_size, false, postings);
+            PostingCodec::EncodeList(lines_byte_size, false, postings);
+            for (const MergedPosting& posting : merged_postings) {
+                postings.insert(postings.end(), posting.lines, posting.lines + posting.lines_byte_size);
+            }
+
+            mapped_node.postings_size = static_cast<uint32_t>(file_ids.size());
+            float max_score = static_cast<float>(searcher.GetMaxScore(file_ids, lines_size, file_document_length));
+            mapped_node.max_score = std::nextafter(max_score, std::numeric_limits<float>::infinity());
+        }
+
+        char symbol = '\0';
+        if (!sources.empty()) {
+            symbol = segments[sources.front().first]->symbols_[sources.front().second];
+        }
+        symbols.push_back(symbol);
+        nodes.push_back(mapped_node);
+    }
+
+    MappedHeader header = {};
+    header.total_document_length = total_document_length;
+    WriteMappedFile(path_mapped_index, header, symbols, nodes, postings, directory, directory_strings);
+
+    return directory.size();
+}
+
+void MappedIndex::WriteMappedFile(const std::string& path_mapped_index, MappedHeader& header,
+        const std::vector<char>& symbols, const std::vector<MappedNode>& nodes,
+        const std::vector<uint8_t>& postings,
+        const std::vector<MappedDirectoryEntry>& directory,
+        const std::vector<char>& directory_strings) {
+    std::string path_temporary = path_mapped_index + ".tmp";
+    std::ofstream file_mapped(path_temporary, std::ios::binary);
+    if (!file_mapped.is_open()) {
+        throw std::runtime_error("error open file " + path_temporary);
+    }
+
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.count_node = nodes.size();
+    header.count_postings_byte = postings.size();
+    header.count_file = directory.size();
+    file_mapped.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    uint64_t offset = sizeof(header);
+    header.symbols_offset = WriteSection(file_mapped, offset, symbols);
+    offset = header.symbols_offset + symbols.size() * sizeof(char);
+    header.nodes_offset = WriteSection(file_mapped, offset, nodes);
+    offset = header.nodes_offset + nodes.size() * sizeof(MappedNode);
+    header.postings_offset = WriteSection(file_mapped, offset, postings);
+    offset = header.postings_offset + postings.size() * sizeof(uint8_t);
+    header.directory_offset = WriteSection(file_mapped, offset, directory);
+    offset = header.directory_offset + directory.size() * sizeof(MappedDirectoryEntry);
+    header.directory_strings_offset = WriteSection(file_mapped, offset, directory_strings);
+    offset = header.directory_strings_offset + directory_strings.size();
+
+    SuffixTable suffix_table;
+    std::string term;
+    std::vector<std::pair<uint32_t, size_t>> stack = {{0, 0}};
+    while (!stack.empty()) {
+        auto [node, depth] = stack.back();
+        stack.pop_back();
+
+        if (depth > 0) {
+            term.resize(depth - 1);
+            term.push_back(symbols[node]);
+        }
+        if (nodes[node].postings_size != 0) {
+            suffix_table.Add(term, node);
+        }
+        for (uint32_t i = 0; i < nodes[node].children_size; ++i) {
+            stack.emplace_back(nodes[node].children_begin + i, depth + 1);
+        }
+    }
+    suffix_table.Sort();
+    header.file_size = WriteSuffixTable(file_mapped, offset, header, suffix_table);
+
+    file_mapped.seekp(0);
+    file_mapped.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file_mapped.close();
+
+    if (!file_mapped) {
+        throw std::runtime_error("error write file " + path_temporary);
+    }
+    std::filesystem::rename(path_temporary, path_mapped_index);
+}
+
+uint64_t MappedIndex::WriteSuffixTable(std::ofstream& file_mapped, uint64_t offset, MappedHeader& header,
+        const SuffixTable& suffix_table) {
+    header.count_term = suffix_table.nodes.size();
+    header.suffix_nodes_offset = WriteSection(file_mapped, offset, suffix_table.nodes);
+    offset = header.suffix_nodes_offset + suffix_table.nodes.size() * sizeof(uint32_t);
+    header.suffix_offsets_offset = WriteSection(file_mapped, offset, suffix_table.offsets);
+    offset = header.suffix_offsets_offset + suffix_table.offsets.size() * sizeof(uint32_t);
+    header.suffix_strings_offset = WriteSection(file_mapped, offset, suffix_table.strings);
+
+    return header.suffix_strings_offset + suffix_table.strings.size();
+}
+
+MappedIndex::Builder::Builder(const std::string& path_mapped_index,
+        const IdDirectory& id_directory,
+        const std::unordered_map<size_t, size_t>& document_length)
+    : path_mapped_index_(path_mapped_index)
+    , file_mapped_(path_mapped_index + ".tmp", std::ios::binary)
+    , total_document_length_(BuildDirectory(id_directory, document_length, directory_, directory_strings_))
+    , searcher_(directory_.empty() ? 0.0 : static_cast<double>(total_document_length_) / directory_.size(),
+                directory_.size())
+    , nodes_(1)
+    , path_({0})
+{
+    if (!file_mapped_.is_open()) {
+        throw std::runtime_error("error open file " + path_mapped_index + ".tmp");
+    }
+
+    nodes_.front().symbol = '\0';
+    MappedHeader header = {};
+    file_mapped_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+size_t MappedIndex::Builder::DocumentLength(size_t file_id) const {
+    auto entry = std::lower_bound(directory_.begin(), directory_.end(), file_id,
+        [](const MappedDirectoryEntry& lhs, size_t index) { return lhs.file_id < index; });
+    if (entry == directory_.end() || entry->file_id != file_id) {
+        return 0;
+    }
+
+    return entry->document_length;
+}
+
+void MappedIndex::Builder::AddTerm(std::string_view term, const std::vector<uint64_t>& file_ids,
+        const std::vector<uint64_t>& lines_size, const std::vector<uint64_t>& lines) {
+    if (term.empty() || (nodes_.size() > 1 && term <= previous_term_)) {
+        throw std::invalid_argument("terms must be added in strictly increasing order");
+    }
+
+    size_t common_prefix = 0;
+    while (common_prefix < term.size() && common_prefix < previous_term_.size()
+            && term[common_prefix] == previous_term_[common_prefix]) {
+        ++common_prefix;
+    }
+    uint32_t last_child = path_.size() > common_prefix + 1 ? path_[common_prefix + 1] : kNullNode;
+    path_.resize(common_prefix + 1);
+
+    for (size_t i = common_prefix; i < term.size(); ++i) {
+        uint32_t node = static_cast<uint32_t>(nodes_.size());
+        if (last_child == kNullNode) {
+            nodes_[path_.back()].has_children = true;
+        } else {
+            nodes_[last_child].next_sibling = node;
+        }
+        last_child = kNullNode;
+
+        nodes_.push_back(BuilderNode{term[i]});
+        path_.push_back(node);
+    }
+    previous_term_.assign(term);
+
+    lines_buffer_.clear();
+    lines_byte_size_.clear();
+    size_t lines_begin = 0;
+    for (uint64_t file_lines_size : lines_size) {
+        size_t buffer_begin = lines_buffer_.size();
+        PostingCodec::EncodePositions(lines.data() + lines_begin, file_lines_size, lines_buffer_);
+        lines_byte_size_.push_back(lines_buffer_.size() - buffer_begin);
+        lines_begin += file_lines_size;
+    }
+
+    postings_.clear();
+    PostingCodec::EncodeList(file_ids, true, postings_);
+    PostingCodec::EncodeList(lines_size, false, postings_);
+    PostingCodec::EncodeList(lines_byte_size_, false, postings_);
+    postings_.insert(postings_.end(), lines_buffer_.begin(), lines_buffer_.end());
+
+    if (!file_ids.empty()) {
+        suffix_table_.Add(term, path_.back());
+    }
+
+    BuilderNode& node = nodes_[path_.back()];
+    node.postings_offset = count_postings_byte_;
+    node.postings_size = static_cast<uint32_t>(file_ids.size());
+    float max_score = static_cast<float>(searcher_.GetMaxScore(file_ids, lines_size,
+        [this](size_t file_id) { return DocumentLength(file_id); }));
+    node.max_score = std::nextafter(max_score, std::numeric_limits<float>::infinity());
+
+    file_mapped_.write(reinterpret_cast<const char*>(postings_.data()), static_cast<std::streamsize>(postings_.size()));
+    count_postings_byte_ += postings_.size();
+}
+
+uint32_t MappedIndex::Builder::FirstChild(uint32_t node) const {
+    return nodes_[node].has_children ? node + 1 : kNullNode;
+}
+
+void MappedIndex::Builder::Finish() {
+    std::vector<uint32_t> order = {0};
+    order.reserve(nodes_.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        for (uint32_t child = FirstChild(order[i]); child != kNullNode; child = nodes_[child].next_sibling) {
+            order.push_back(child);
+        }
+    }
+
+    MappedHeader header = {};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.count_node = order.size();
+    header.count_postings_byte = count_postings_byte_;
+    header.count_file = directory_.size();
+    header.total_document_length = total_document_length_;
+    header.postings_offset = sizeof(header);
+
+    std::vector<char> symbols;
+    header.symbols_offset = AlignSection(file_mapped_, header.postings_offset + count_postings_byte_);
+    for (size_t i = 0; i < order.size(); i += kChunkSize) {
+        symbols.clear();
+        for (size_t j = i; j < std::min(order.size(), i + kChunkSize); ++j) {
+            symbols.push_back(nodes_[order[j]].symbol);
+        }
+        file_mapped_.write(symbols.data(), static_cast<std::streamsize>(symbols.size()));
+    }
+
+    std::vector<MappedNode> nodes;
+    uint32_t children_begin = 1;
+    header.nodes_offset = AlignSection(file_mapped_, header.symbols_offset + order.size() * sizeof(char));
+    for (size_t i = 0; i < order.size(); i += kChunkSize) {
+        nodes.clear();
+        for (size_t j = i; j < std::min(order.size(), i + kChunkSize); ++j) {
+            const BuilderNode& node = nodes_[order[j]];
+            MappedNode mapped_node{children_begin, 0, node.postings_size, node.max_score, node.postings_offset};
+            for (uint32_t child = FirstChild(order[j]); child != kNullNode; child = nodes_[child].next_sibling) {
+                ++mapped_node.children_size;
+            }
+            children_begin += mapped_node.children_size;
+            nodes.push_back(mapped_node);
+        }
+        file_mapped_.write(reinterpret_cast<const char*>(nodes.data()),
+                           static_cast<std::streamsize>(nodes.size() * sizeof(MappedNode)));
+    }
+
+    uint64_t offset = header.nodes_offset + order.size() * sizeof(MappedNode);
+    header.directory_offset = WriteSection(file_mapped_, offset, directory_);
+    offset = header.directory_offset + directory_.size() * sizeof(MappedDirectoryEntry);
+    header.directory_strings_offset = WriteSection(file_mapped_, offset, directory_strings_);
+    offset = header.directory_strings_offset + directory_strings_.size();
+
+    std::vector<uint32_t> mapped_nodes(nodes_.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        mapped_nodes[order[i]] = static_cast<uint32_t>(i);
+    }
+    for (uint32_t& node : suffix_table_.nodes) {
+        node = mapped_nodes[node];
+    }
+    suffix_table_.Sort();
+    header.file_size = WriteSuffixTable(file_mapped_, offset, header, suffix_table_);
+
+    file_mapped_.seekp(0);
+    file_mapped_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file_mapped_.close();
+
+    if (!file_mapped_) {
+        throw std::runtime_error("error write file " + path_mapped_index_ + ".tmp");
+    }
+    std::filesystem::rename(path_mapped_index_ + ".tmp", path_mapped_index_);
+}
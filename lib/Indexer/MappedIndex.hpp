@@ -0,0 +1,225 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "IdDirectory.hpp"
+#include "Ties.hpp"
+#include "Wildcard.hpp"
+#include "../Searcher/Searcher.hpp"
+
+class MappedIndex {
+private:
+    constexpr static const uint32_t kNullNode = UINT32_MAX;
+
+    struct MappedHeader {
+        char magic[8];
+        uint64_t count_node;
+        uint64_t count_postings_byte;
+        uint64_t count_file;
+        uint64_t total_document_length;
+        uint64_t symbols_offset;
+        uint64_t nodes_offset;
+        uint64_t postings_offset;
+        uint64_t directory_offset;
+        uint64_t directory_strings_offset;
+        uint64_t count_term;
+        uint64_t suffix_nodes_offset;
+        uint64_t suffix_offsets_offset;
+        uint64_t suffix_strings_offset;
+        uint64_t file_size;
+    };
+
+    struct SuffixTable {
+        std::vector<uint32_t> nodes;
+        std::vector<uint32_t> offsets = {0};
+        std::vector<char> strings;
+
+        void Add(std::string_view term, uint32_t node);
+        void Sort();
+    };
+
+    struct MappedNode {
+        uint32_t children_begin;
+        uint32_t children_size;
+        uint32_t postings_size;
+        float max_score;
+        uint64_t postings_offset;
+    };
+
+    struct DecodedPostings {
+        std::vector<uint64_t> file_ids;
+        std::vector<uint64_t> lines_size;
+        std::vector<uint64_t> lines_offset;
+        std::unordered_map<size_t, std::vector<uint64_t>> lines;
+    };
+
+    struct MappedDirectoryEntry {
+        uint64_t file_id;
+        uint64_t offset;
+        uint64_t size;
+        uint64_t document_length;
+    };
+
+    class MappedIterator {
+    public:
+        MappedIterator() = default;
+        MappedIterator(const MappedIndex* index, uint32_t current_node);
+
+        char operator*() const;
+
+        const uint64_t* GetStartArray(size_t index) const;
+        const uint64_t* GetEndArray(size_t index) const;
+        std::unordered_set<size_t> GetKeyArray() const;
+
+        bool empty(size_t index) const;
+        size_t size(size_t index) const;
+
+        friend bool operator==(const MappedIterator& lhs, const MappedIterator& rhs) {
+            return lhs.current_node_ == rhs.current_node_;
+        }
+
+        friend bool operator!=(const MappedIterator& lhs, const MappedIterator& rhs) {
+            return !(lhs == rhs);
+        }
+        const std::vector<uint64_t>& GetSortedKeys() const;
+        const std::vector<uint64_t>& GetSortedFrequencies() const;
+        double MaxScore() const;
+    private:
+        const DecodedPostings& Decode() const;
+        size_t FindPosting(size_t index) const;
+        const std::vector<uint64_t>* GetLines(size_t index) const;
+
+        const MappedIndex* index_ = nullptr;
+        uint32_t current_node_ = kNullNode;
+        mutable std::shared_ptr<DecodedPostings> decoded_;
+    };
+public:
+    using iterator = MappedIterator;
+
+    class Builder {
+    public:
+        Builder(const std::string& path_mapped_index,
+                const IdDirectory& id_directory,
+                const std::unordered_map<size_t, size_t>& document_length);
+
+        void AddTerm(std::string_view term, const std::vector<uint64_t>& file_ids,
+                     const std::vector<uint64_t>& lines_size, const std::vector<uint64_t>& lines);
+        void Finish();
+    private:
+        constexpr static const size_t kChunkSize = 1 << 16;
+
+        struct BuilderNode {
+            char symbol;
+            bool has_children = false;
+            uint32_t next_sibling = kNullNode;
+            uint32_t postings_size = 0;
+            float max_score = 0;
+            uint64_t postings_offset = 0;
+        };
+
+        size_t DocumentLength(size_t file_id) const;
+        uint32_t FirstChild(uint32_t node) const;
+
+        std::string path_mapped_index_;
+        std::ofstream file_mapped_;
+        std::vector<MappedDirectoryEntry> directory_;
+        std::vector<char> directory_strings_;
+        uint64_t total_document_length_;
+        Searcher searcher_;
+
+        std::vector<BuilderNode> nodes_;
+        SuffixTable suffix_table_;
+        std::vector<uint32_t> path_;
+        std::string previous_term_;
+        uint64_t count_postings_byte_ = 0;
+
+        std::vector<uint8_t> postings_;
+        std::vector<uint8_t> lines_buffer_;
+        std::vector<uint64_t> lines_byte_size_;
+    };
+
+    constexpr static const char* kFileNameMappedIndex = "index.map";
+    constexpr static const char kMagic[8] = "SSEMAP6";
+
+    explicit MappedIndex(const std::string& path_mapped_index = kFileNameMappedIndex);
+    ~MappedIndex();
+
+    MappedIndex(const MappedIndex&) = delete;
+    MappedIndex& operator=(const MappedIndex&) = delete;
+
+    iterator SearchWord(const std::string& word) const;
+    std::vector<std::string> ExpandWildcard(const std::string& pattern,
+                                            size_t max_expansions = Wildcard::kMaxExpansions) const;
+    std::vector<FuzzyTerm> ExpandFuzzy(const std::string& word, size_t max_distance,
+                                       size_t max_expansions = LevenshteinAutomaton::kMaxExpansions) const;
+    iterator begin() const;
+    iterator end() const;
+
+    std::string_view StringIndex(size_t index) const;
+    size_t DocumentLength(size_t index) const;
+    double AverageDocumentLength() const;
+    size_t CountDocuments() const;
+    size_t CountFile() const;
+    uint64_t TotalDocumentLength() const;
+    bool ContainsDocument(size_t index) const;
+    size_t Prewarm() const;
+
+    static void WriteMappedIndex(const Ties& word_repository,
+                                 const IdDirectory& id_directory,
+                                 const std::unordered_map<size_t, size_t>& document_length,
+                                 const std::string& path_mapped_index = kFileNameMappedIndex,
+                                 const std::unordered_set<size_t>& deleted_file_ids = {});
+    static size_t MergeMappedIndex(const std::vector<const MappedIndex*>& segments,
+                                   const std::string& path_mapped_index,
+                                   const std::unordered_set<size_t>& deleted_file_ids = {});
+private:
+    template<typename T>
+    const T* Section(uint64_t offset) const {
+        return reinterpret_cast<const T*>(data_ + offset);
+    }
+
+    template<typename T>
+    bool IsSectionInBounds(uint64_t offset, uint64_t count) const {
+        return offset <= size_ && count <= (size_ - offset) / sizeof(T);
+    }
+
+    bool IsValidHeader() const;
+
+    uint32_t FindChild(uint32_t node, char symbol) const;
+    std::string_view ReversedTerm(size_t index) const;
+    const MappedDirectoryEntry* FindDirectoryEntry(size_t index) const;
+    static uint64_t BuildDirectory(const IdDirectory& id_directory,
+                                   const std::unordered_map<size_t, size_t>& document_length,
+                                   std::vector<MappedDirectoryEntry>& directory,
+                                   std::vector<char>& directory_strings);
+    const uint8_t* DecodeNodePostings(uint32_t node, std::vector<uint64_t>& file_ids,
+                                      std::vector<uint64_t>& lines_size,
+                                      std::vector<uint64_t>& lines_byte_size) const;
+
+    static void WriteMappedFile(const std::string& path_mapped_index, MappedHeader& header,
+                                const std::vector<char>& symbols, const std::vector<MappedNode>& nodes,
+                                const std::vector<uint8_t>& postings,
+                                const std::vector<MappedDirectoryEntry>& directory,
+                                const std::vector<char>& directory_strings);
+    static uint64_t WriteSuffixTable(std::ofstream& file_mapped, uint64_t offset, MappedHeader& header,
+                                     const SuffixTable& suffix_table);
+
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    const MappedHeader* header_ = nullptr;
+    const char* symbols_ = nullptr;
+    const MappedNode* nodes_ = nullptr;
+    const uint8_t* postings_ = nullptr;
+    const MappedDirectoryEntry* directory_ = nullptr;
+    const char* directory_strings_ = nullptr;
+    const uint32_t* suffix_nodes_ = nullptr;
+    const uint32_t* suffix_offsets_ = nullptr;
+    const char* suffix_strings_ = nullptr;
+};
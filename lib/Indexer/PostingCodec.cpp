@@ -0,0 +1,212 @@
+#include "PostingCodec.hpp"
+
+#include <array>
+#include <bit>
+#include <cstring>
+#include <utility>
+
+void PostingCodec::EncodeVarint(uint64_t value, std::vector<uint8_t>& output) {
+    while (value >= 0x80) {
+        output.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    output.push_back(static_cast<uint8_t>(value));
+}
+
+uint64_t PostingCodec::DecodeVarint(const uint8_t*& input) {
+    uint64_t value = 0;
+    for (size_t shift = 0; ; shift += 7) {
+        uint8_t byte = *input++;
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+}
+
+void PostingCodec::EncodePositionDelta(uint64_t previous, uint64_t position, std::vector<uint8_t>& output) {
+    int64_t offset_delta = static_cast<int64_t>(PositionOffset(position) - PositionOffset(previous));
+    EncodeVarint(PositionLine(position) - PositionLine(previous), output);
+    EncodeVarint((static_cast<uint64_t>(offset_delta) << 1) ^ static_cast<uint64_t>(offset_delta >> 63), output);
+}
+
+uint64_t PostingCodec::DecodePositionDelta(const uint8_t*& input, uint64_t previous) {
+    uint64_t line = PositionLine(previous) + DecodeVarint(input);
+    uint64_t zigzag_offset = DecodeVarint(input);
+    int64_t offset_delta = static_cast<int64_t>(zigzag_offset >> 1) ^ -static_cast<int64_t>(zigzag_offset & 1);
+    return PackPosition(line, PositionOffset(previous) + static_cast<uint64_t>(offset_delta));
+}
+
+void PostingCodec::PackBlock(const uint64_t* values, uint8_t bit_width, std::vector<uint8_t>& output) {
+    output.push_back(bit_width);
+    if (bit_width == 0) {
+        return;
+    }
+
+    size_t begin = output.size();
+    output.resize(begin + kBlockSize * bit_width / 8);
+    uint8_t* packed = output.data() + begin;
+
+    uint64_t buffer = 0;
+    size_t buffer_bits = 0;
+    for (size_t i = 0; i < kBlockSize; ++i) {
+        buffer |= values[i] << buffer_bits;
+        size_t written_bits = 64 - buffer_bits;
+        buffer_bits += bit_width;
+
+        if (buffer_bits >= 64) {
+            std::memcpy(packed, &buffer, sizeof(buffer));
+            packed += sizeof(buffer);
+            buffer_bits -= 64;
+            buffer = buffer_bits == 0 ? 0 : values[i] >> written_bits;
+        }
+    }
+}
+
+namespace {
+
+template<uint8_t BitWidth, bool IsDelta>
+uint64_t UnpackFixedBlock(const uint8_t* input, uint64_t* values, uint64_t previous) {
+    constexpr uint64_t kMask = BitWidth == 64 ? ~uint64_t(0) : (uint64_t(1) << BitWidth) - 1;
+
+    if constexpr (BitWidth == 0) {
+        for (size_t i = 0; i < PostingCodec::kBlockSize; ++i) {
+            values[i] = IsDelta ? previous : 0;
+        }
+        return previous;
+    }
+
+#pragma GCC unroll 128
+    for (size_t i = 0; i < PostingCodec::kBlockSize; ++i) {
+        size_t bit_position = i * BitWidth;
+        size_t word = bit_position / 64;
+        size_t shift = bit_position % 64;
+
+        uint64_t low;
+        std::memcpy(&low, input + word * sizeof(uint64_t), sizeof(low));
+        uint64_t value = low >> shift;
+        if (shift + BitWidth > 64) {
+            uint64_t high;
+            std::memcpy(&high, input + (word + 1) * sizeof(uint64_t), sizeof(high));
+            value |= high << (64 - shift);
+        }
+
+        if constexpr (IsDelta) {
+            previous += value & kMask;
+            values[i] = previous;
+        } else {
+            values[i] = value & kMask;
+        }
+    }
+
+    return previous;
+}
+
+using UnpackFunction = uint64_t (*)(const uint8_t*, uint64_t*, uint64_t);
+
+template<bool IsDelta, size_t... BitWidths>
+constexpr std::array<UnpackFunction, sizeof...(BitWidths)> MakeUnpackTable(std::index_sequence<BitWidths...>) {
+    return {&UnpackFixedBlock<static_cast<uint8_t>(BitWidths), IsDelta>...};
+}
+
+constexpr auto kUnpackTable = MakeUnpackTable<false>(std::make_index_sequence<65>{});
+constexpr auto kUnpackDeltaTable = MakeUnpackTable<true>(std::make_index_sequence<65>{});
+
+}
+
+const uint8_t* PostingCodec::UnpackBlock(const uint8_t* input, uint8_t bit_width, bool is_delta,
+        uint64_t* values, uint64_t& previous) {
+    if (is_delta) {
+        previous = kUnpackDeltaTable[bit_width](input, values, previous);
+    } else {
+        previous = kUnpackTable[bit_width](input, values, previous);
+    }
+
+    return input + kBlockSize * bit_width / 8;
+}
+
+void PostingCodec::EncodeList(const uint64_t* values, size_t count, bool is_delta, std::vector<uint8_t>& output) {
+    uint64_t block[kBlockSize];
+    uint64_t previous = 0;
+    size_t i = 0;
+
+    for (; i + kBlockSize <= count; i += kBlockSize) {
+        uint64_t max_value = 0;
+        for (size_t j = 0; j < kBlockSize; ++j) {
+            block[j] = is_delta ? values[i + j] - previous : values[i + j];
+            previous = values[i + j];
+            max_value |= block[j];
+        }
+        PackBlock(block, static_cast<uint8_t>(std::bit_width(max_value)), output);
+    }
+
+    for (; i < count; ++i) {
+        EncodeVarint(is_delta ? values[i] - previous : values[i], output);
+        previous = values[i];
+    }
+}
+
+const uint8_t* PostingCodec::DecodeList(const uint8_t* input, size_t count, bool is_delta, uint64_t* values) {
+    uint64_t previous = 0;
+    size_t i = 0;
+
+    for (; i + kBlockSize <= count; i += kBlockSize) {
+        uint8_t bit_width = *input++;
+        input = UnpackBlock(input, bit_width, is_delta, values + i, previous);
+    }
+
+    for (; i < count; ++i) {
+        uint64_t value = DecodeVarint(input);
+        previous = is_delta ? previous + value : value;
+        values[i] = previous;
+    }
+
+    return input;
+}
+
+void PostingCodec::EncodeList(const std::vector<uint64_t>& values, bool is_delta, std::vector<uint8_t>& output) {
+    EncodeList(values.data(), values.size(), is_delta, output);
+}
+
+const uint8_t* PostingCodec::DecodeList(const uint8_t* input, size_t count, bool is_delta,
+        std::vector<uint64_t>& values) {
+    values.resize(count);
+    return DecodeList(input, count, is_delta, values.data());
+}
+
+void PostingCodec::EncodePositions(const uint64_t* positions, size_t count, std::vector<uint8_t>& output) {
+    thread_local std::vector<uint64_t> parts;
+    parts.resize(count);
+
+    for (size_t i = 0; i < count; ++i) {
+        parts[i] = PositionLine(positions[i]);
+    }
+    EncodeList(parts.data(), count, true, output);
+
+    for (size_t i = 0; i < count; ++i) {
+        parts[i] = PositionOffset(positions[i]);
+    }
+    EncodeList(parts.data(), count, true, output);
+}
+
+const uint8_t* PostingCodec::DecodePositions(const uint8_t* input, size_t count, uint64_t* positions) {
+    thread_local std::vector<uint64_t> offsets;
+    offsets.resize(count);
+
+    input = DecodeList(input, count, true, positions);
+    input = DecodeList(input, count, true, offsets.data());
+    for (size_t i = 0; i < count; ++i) {
+        positions[i] = PackPosition(positions[i], offsets[i]);
+    }
+
+    return input;
+}
+
+void PostingCodec::EncodePositions(const std::vector<uint64_t>& positions, std::vector<uint8_t>& output) {
+    EncodePositions(positions.data(), positions.size(), output);
+}
+
+const uint8_t* PostingCodec::DecodePositions(const uint8_t* input, size_t count, std::vector<uint64_t>& positions) {
+    positions.resize(count);
+    return DecodePositions(input, count, positions.data());
+}
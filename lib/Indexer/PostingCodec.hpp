@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct PostingCodec {
+    constexpr static const size_t kBlockSize = 128;
+    constexpr static const size_t kOffsetBits = 32;
+    constexpr static const uint64_t kOffsetMask = (uint64_t(1) << kOffsetBits) - 1;
+
+    static uint64_t PackPosition(uint64_t line, uint64_t offset) {
+        return (line << kOffsetBits) | (offset & kOffsetMask);
+    }
+
+    static uint64_t PositionLine(uint64_t position) {
+        return position >> kOffsetBits;
+    }
+
+    static uint64_t PositionOffset(uint64_t position) {
+        return position & kOffsetMask;
+    }
+
+    static void EncodeVarint(uint64_t value, std::vector<uint8_t>& output);
+    static uint64_t DecodeVarint(const uint8_t*& input);
+
+    static void EncodePositionDelta(uint64_t previous, uint64_t position, std::vector<uint8_t>& output);
+    static uint64_t DecodePositionDelta(const uint8_t*& input, uint64_t previous);
+
+    static void EncodeList(const uint64_t* values, size_t count, bool is_delta, std::vector<uint8_t>& output);
+    static const uint8_t* DecodeList(const uint8_t* input, size_t count, bool is_delta, uint64_t* values);
+
+    static void EncodeList(const std::vector<uint64_t>& values, bool is_delta, std::vector<uint8_t>& output);
+    static const uint8_t* DecodeList(const uint8_t* input, size_t count, bool is_delta, std::vector<uint64_t>& values);
+
+    static void EncodePositions(const uint64_t* positions, size_t count, std::vector<uint8_t>& output);
+    static const uint8_t* DecodePositions(const uint8_t* input, size_t count, uint64_t* positions);
+
+    static void EncodePositions(const std::vector<uint64_t>& positions, std::vector<uint8_t>& output);
+    static const uint8_t* DecodePositions(const uint8_t* input, size_t count, std::vector<uint64_t>& positions);
+private:
+    static void PackBlock(const uint64_t* values, uint8_t bit_width, std::vector<uint8_t>& output);
+    static const uint8_t* UnpackBlock(const uint8_t* input, uint8_t bit_width, bool is_delta,
+                                      uint64_t* values, uint64_t& previous);
+};
@@ -0,0 +1,564 @@
+#include "SegmentedIndex.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <numeric>
+#include <stdexcept>
+
+SegmentedIndex::SegmentedIterator::SegmentedIterator(const SegmentedIndex* index,
+        std::vector<MappedIndex::iterator> iterators)
+    : index_(index)
+    , iterators_(std::move(iterators))
+{}
+
+char SegmentedIndex::SegmentedIterator::operator*() const {
+    if (iterators_.empty()) {
+        return '\0';
+    }
+
+    return *iterators_.front();
+}
+
+const SegmentedIndex::MergedPostings& SegmentedIndex::SegmentedIterator::Merge() const {
+    if (merged_ != nullptr) {
+        return *merged_;
+    }
+
+    MergedPostings merged;
+    for (uint32_t i = 0; i < iterators_.size(); ++i) {
+        const std::vector<uint64_t>& file_ids = iterators_[i].GetSortedKeys();
+        const std::vector<uint64_t>& frequencies = iterators_[i].GetSortedFrequencies();
+        for (size_t j = 0; j < file_ids.size(); ++j) {
+            if (!index_->tombstones_.contains(file_ids[j])) {
+                merged.file_ids.push_back(file_ids[j]);
+                merged.frequencies.push_back(frequencies[j]);
+                merged.segments.push_back(i);
+            }
+        }
+    }
+
+    merged_ = std::make_shared<MergedPostings>();
+    if (std::is_sorted(merged.file_ids.begin(), merged.file_ids.end())) {
+        *merged_ = std::move(merged);
+        return *merged_;
+    }
+
+    std::vector<size_t> order(merged.file_ids.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&merged](size_t lhs, size_t rhs) {
+        return merged.file_ids[lhs] < merged.file_ids[rhs];
+    });
+
+    for (size_t position : order) {
+        merged_->file_ids.push_back(merged.file_ids[position]);
+        merged_->frequencies.push_back(merged.frequencies[position]);
+        merged_->segments.push_back(merged.segments[position]);
+    }
+
+    return *merged_;
+}
+
+const MappedIndex::iterator* SegmentedIndex::SegmentedIterator::FindSegment(size_t index) const {
+    const MergedPostings& merged = Merge();
+
+    auto posting = std::lower_bound(merged.file_ids.begin(), merged.file_ids.end(), index);
+    if (posting == merged.file_ids.end() || *posting != index) {
+        return nullptr;
+    }
+
+    return &iterators_[merged.segments[posting - merged.file_ids.begin()]];
+}
+
+const uint64_t* SegmentedIndex::SegmentedIterator::GetStartArray(size_t index) const {
+    const MappedIndex::iterator* segment = FindSegment(index);
+    if (segment == nullptr) {
+        return nullptr;
+    }
+
+    return segment->GetStartArray(index);
+}
+
+const uint64_t* SegmentedIndex::SegmentedIterator::GetEndArray(size_t index) const {
+    const MappedIndex::iterator* segment = FindSegment(index);
+    if (segment == nullptr) {
+        return nullptr;
+    }
+
+    return segment->GetEndArray(index);
+}
+
+std::unordered_set<size_t> SegmentedIndex::SegmentedIterator::GetKeyArray() const {
+    const std::vector<uint64_t>& file_ids = Merge().file_ids;
+    return std::unordered_set<size_t>(file_ids.begin(), file_ids.end());
+}
+
+const std::vector<uint64_t>& SegmentedIndex::SegmentedIterator::GetSortedKeys() const {
+    return Merge().file_ids;
+}
+
+const std::vector<uint64_t>& SegmentedIndex::SegmentedIterator::GetSortedFrequencies() const {
+    return Merge().frequencies;
+}
+
+bool SegmentedIndex::SegmentedIterator::empty(size_t index) const {
+    return size(index) == 0;
+}
+
+size_t SegmentedIndex::SegmentedIterator::size(size_t index) const {
+    const MappedIndex::iterator* segment = FindSegment(index);
+    if (segment == nullptr) {
+        return 0;
+    }
+
+    return segment->size(index);
+}
+
+SegmentedIndex::SegmentedIndex(const std::filesystem::path& path_segments) {
+    std::vector<SegmentInfo> segments;
+    uint64_t next_segment = 0;
+    if (!ReadManifest(path_segments, segments, next_segment, tombstones_)) {
+        throw std::runtime_error("error open file " + (path_segments / kFileNameManifest).string());
+    }
+
+    for (const SegmentInfo& segment : segments) {
+        segments_.push_back(std::make_unique<MappedIndex>(SegmentPath(path_segments, segment.number).string()));
+        count_documents_ += segments_.back()->CountFile();
+        total_document_length_ += segments_.back()->TotalDocumentLength();
+    }
+
+    for (size_t file_id : tombstones_) {
+        const MappedIndex* segment = FindSegment(file_id);
+        if (segment != nullptr) {
+            --count_documents_;
+            total_document_length_ -= segment->DocumentLength(file_id);
+        }
+    }
+}
+
+const MappedIndex* SegmentedIndex::FindSegment(size_t index) const {
+    for (const auto& segment : segments_) {
+        if (segment->ContainsDocument(index)) {
+            return segment.get();
+        }
+    }
+
+    return nullptr;
+}
+
+SegmentedIndex::iterator SegmentedIndex::SearchWord(const std::string& word) const {
+    std::vector<MappedIndex::iterator> iterators;
+    for (const auto& segment : segments_) {
+        MappedIndex::iterator iterator = segment->SearchWord(word);
+        if (iterator != segment->end()) {
+            iterators.push_back(iterator);
+        }
+    }
+
+    if (iterators.empty()) {
+        return end();
+    }
+
+    return iterator(this, std::move(iterators));
+}
+
+std::vector<std::string> SegmentedIndex::ExpandWildcard(const std::string& pattern, size_t max_expansions) const {
+    std::vector<std::string> terms;
+    for (const auto& segment : segments_) {
+        std::vector<std::string> segment_terms = segment->ExpandWildcard(pattern, max_expansions);
+        terms.insert(terms.end(), std::make_move_iterator(segment_terms.begin()),
+                     std::make_move_iterator(segment_terms.end()));
+    }
+    std::sort(terms.begin(), terms.end());
+    terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+    Wildcard::CheckExpansions(terms.size(), pattern, max_expansions);
+
+    return terms;
+}
+
+std::vector<FuzzyTerm> SegmentedIndex::ExpandFuzzy(const std::string& word, size_t max_distance,
+        size_t max_expansions) const {
+    std::vector<FuzzyTerm> terms;
+    for (const auto& segment : segments_) {
+        std::vector<FuzzyTerm> segment_terms = segment->ExpandFuzzy(word, max_distance, max_expansions);
+        terms.insert(terms.end(), std::make_move_iterator(segment_terms.begin()),
+                     std::make_move_iterator(segment_terms.end()));
+    }
+    LevenshteinAutomaton::SelectClosest(terms, terms.size());
+    terms.erase(std::unique(terms.begin(), terms.end(), [](const FuzzyTerm& lhs, const FuzzyTerm& rhs) {
+        return lhs.term == rhs.term;
+    }), terms.end());
+    LevenshteinAutomaton::SelectClosest(terms, max_expansions);
+
+    return terms;
+}
+
+SegmentedIndex::iterator SegmentedIndex::end() const {
+    return iterator(this, {});
+}
+
+std::string_view SegmentedIndex::StringIndex(size_t index) const {
+    const MappedIndex* segment = FindSegment(index);
+    if (segment == nullptr || tombstones_.contains(index)) {
+        return std::string_view();
+    }
+
+    return segment->StringIndex(index);
+}
+
+size_t SegmentedIndex::DocumentLength(size_t index) const {
+    const MappedIndex* segment = FindSegment(index);
+    if (segment == nullptr || tombstones_.contains(index)) {
+        return 0;
+    }
+
+    return segment->DocumentLength(index);
+}
+
+double SegmentedIndex::AverageDocumentLength() const {
+    if (count_documents_ == 0) {
+        return 0.0;
+    }
+
+    return static_cast<double>(total_document_length_) / count_documents_;
+}
+
+size_t SegmentedIndex::CountDocuments() const {
+    return count_documents_;
+}
+
+size_t SegmentedIndex::CountSegments() const {
+    return segments_.size();
+}
+
+std::filesystem::path SegmentedIndex::SegmentPath(const std::filesystem::path& path_segments, uint64_t number) {
+    return path_segments / ("segment_" + std::to_string(number) + ".map");
+}
+
+bool SegmentedIndex::ReadManifest(const std::filesystem::path& path_segments, std::vector<SegmentInfo>& segments,
+        uint64_t& next_segment, std::unordered_set<size_t>& tombstones) {
+    std::filesystem::path path_manifest = path_segments / kFileNameManifest;
+    std::ifstream file_manifest(path_manifest, std::ios::binary);
+    if (!file_manifest.is_open()) {
+        return false;
+    }
+
+    char magic[sizeof(kMagic)];
+    file_manifest.read(magic, sizeof(magic));
+    if (!file_manifest || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0) {
+        throw std::runtime_error("invalid manifest " + path_manifest.string());
+    }
+
+    size_t size_segments = 0;
+    file_manifest.read(reinterpret_cast<char*>(&next_segment), sizeof(uint64_t));
+    file_manifest.read(reinterpret_cast<char*>(&size_segments), sizeof(size_t));
+    segments.resize(size_segments);
+    file_manifest.read(reinterpret_cast<char*>(segments.data()), size_segments * sizeof(SegmentInfo));
+
+    size_t size_tombstones = 0;
+    file_manifest.read(reinterpret_cast<char*>(&size_tombstones), sizeof(size_t));
+    std::vector<size_t> file_ids(size_tombstones);
+    file_manifest.read(reinterpret_cast<char*>(file_ids.data()), size_tombstones * sizeof(size_t));
+    tombstones.insert(file_ids.begin(), file_ids.end());
+
+    if (!file_manifest) {
+        throw std::runtime_error("error read file " + path_manifest.string());
+    }
+
+    return true;
+}
+
+void SegmentedIndex::WriteManifest(const std::filesystem::path& path_segments,
+        const std::vector<SegmentInfo>& segments, uint64_t next_segment,
+        const std::unordered_set<size_t>& tombstones) {
+    std::filesystem::path path_manifest = path_segments / kFileNameManifest;
+    std::filesystem::path path_temporary = path_manifest;
+    path_temporary += ".tmp";
+
+    {
+        std::ofstream file_manifest(path_temporary, std::ios::binary);
+        if (!file_manifest.is_open()) {
+            throw std::runtime_error("error open file " + path_temporary.string());
+        }
+
+        size_t size_segments = segments.size();
+        file_manifest.write(kMagic, sizeof(kMagic));
+        file_manifest.write(reinterpret_cast<const char*>(&next_segment), sizeof(uint64_t));
+        file_manifest.write(reinterpret_cast<const char*>(&size_segments), sizeof(size_t));
+        file_manifest.write(reinterpret_cast<const char*>(segments.data()), size_segments * sizeof(SegmentInfo));
+
+        std::vector<size_t> file_ids(tombstones.begin(), tombstones.end());
+        size_t size_tombstones = file_ids.size();
+        file_manifest.write(reinterpret_cast<const char*>(&size_tombstones), sizeof(size_t));
+        file_manifest.write(reinterpret_cast<const char*>(file_ids.data()), size_tombstones * sizeof(size_t));
+    }
+
+    std::filesystem::rename(path_temporary, path_manifest);
+}
+
+void SegmentedIndex::RemoveSegments(const std::filesystem::path& path_segments) {
+    if (!std::filesystem::exists(path_segments)) {
+        return;
+    }
+
+    std::vector<SegmentInfo> segments;
+    uint64_t next_segment = 0;
+    std::unordered_set<size_t> tombstones;
+    if (!ReadManifest(path_segments, segments, next_segment, tombstones)) {
+        throw std::runtime_error("refusing to remove " + path_segments.string() + ": no " + kFileNameManifest);
+    }
+
+    std::filesystem::remove_all(path_segments);
+}
+
+SegmentedIndexer::SegmentedIndexer(const std::filesystem::path& path_segments, size_t memory_budget)
+    : IndexerBase<true>::IndexerBase()
+    , path_segments_(path_segments)
+    , memory_budget_(memory_budget)
+    , merge_pool_(1)
+{
+    std::filesystem::create_directories(path_segments_);
+    if (SegmentedIndex::ReadManifest(path_segments_, segments_, next_segment_, tombstones_)) {
+        ReadIdDirectoryFromBinFile(StatePath(kFileNameIdDirectory).c_str());
+        ReadDocumentLengthFromBinFile(StatePath(kFileNameDocumentLength).c_str());
+        ReadFileStateFromBinFile(StatePath(kFileNameFileState).c_str());
+    }
+
+    file_id = id_directory_.MaxId();
+    for (size_t index : tombstones_) {
+        file_id = std::max(file_id, index);
+    }
+}
+
+SegmentedIndexer::~SegmentedIndexer() {
+    Flush();
+    WaitMerges();
+    SaveIndexer();
+}
+
+std::string SegmentedIndexer::StatePath(const char* filename) const {
+    return (path_segments_ / filename).string();
+}
+
+void SegmentedIndexer::StartIndexer(const std::filesystem::path& directory_path) {
+    if (!std::filesystem::exists(directory_path) || !std::filesystem::is_directory(directory_path)) {
+        throw std::runtime_error("could not find the folder");
+    }
+
+    std::vector<std::filesystem::path> files;
+    CollectFiles(directory_path, files);
+    IndexFiles(files);
+}
+
+void SegmentedIndexer::UpdateIndexer(const std::filesystem::path& directory_path) {
+    WaitMerges();
+
+    std::vector<std::filesystem::path> changed_files = CollectChangedFiles(directory_path);
+    IndexFiles(changed_files);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    SegmentedIndex::WriteManifest(path_segments_, segments_, next_segment_, tombstones_);
+}
+
+void SegmentedIndexer::IndexFiles(const std::vector<std::filesystem::path>& files) {
+    for (const auto& file_path : files) {
+        size_t current_file_id = ++file_id;
+        FileState state = GetFileState(file_path);
+        size_t document_length = SaveWordsToTies(file_path, current_file_id, *word_repository_, &state.content_hash);
+        id_directory_.Insert(current_file_id, file_path.string());
+        AddDocumentLength(current_file_id, document_length);
+        file_state_[current_file_id] = state;
+        segment_file_ids_.push_back(current_file_id);
+
+        count_segment_words_ += document_length;
+        if (count_segment_words_ < next_check_words_) {
+            continue;
+        }
+
+        size_t memory_usage = word_repository_->MemoryUsage();
+        if (memory_usage >= memory_budget_) {
+            Flush();
+            continue;
+        }
+
+        size_t bytes_per_word = std::max<size_t>(1, memory_usage / std::max<size_t>(1, count_segment_words_));
+        next_check_words_ = count_segment_words_
+                          + std::max(kMinCheckWords, (memory_budget_ - memory_usage) / bytes_per_word);
+    }
+
+    Flush();
+}
+
+void SegmentedIndexer::Flush() {
+    if (segment_file_ids_.empty()) {
+        return;
+    }
+
+    IdDirectory id_directory;
+    std::unordered_map<size_t, size_t> document_length;
+    for (size_t index : segment_file_ids_) {
+        id_directory.Insert(index, id_directory_[index]);
+        document_length[index] = DocumentLengthFromUnMap(index);
+    }
+
+    uint64_t number;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        number = next_segment_++;
+    }
+
+    std::filesystem::path path_segment = SegmentedIndex::SegmentPath(path_segments_, number);
+    MappedIndex::WriteMappedIndex(*word_repository_, id_directory, document_length, path_segment.string());
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        segments_.push_back(SegmentedIndex::SegmentInfo{number, id_directory.size(),
+                                                        std::filesystem::file_size(path_segment)});
+        SegmentedIndex::WriteManifest(path_segments_, segments_, next_segment_, tombstones_);
+    }
+
+    word_repository_ = std::make_unique<Ties>();
+    segment_file_ids_.clear();
+    count_segment_words_ = 0;
+    next_check_words_ = 0;
+
+    ScheduleMerges();
+}
+
+void SegmentedIndexer::ScheduleMerges() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (std::vector<uint64_t> numbers = SelectMerge(); !numbers.empty(); numbers = SelectMerge()) {
+        merging_segments_.insert(numbers.begin(), numbers.end());
+        merge_pool_.Submit([this, numbers] {
+            MergeSegments(numbers);
+        });
+    }
+}
+
+std::vector<uint64_t> SegmentedIndexer::SelectMerge() const {
+    std::map<size_t, std::vector<const SegmentedIndex::SegmentInfo*>> tiers;
+    for (const SegmentedIndex::SegmentInfo& segment : segments_) {
+        if (merging_segments_.contains(segment.number)) {
+            continue;
+        }
+
+        size_t tier = 0;
+        for (uint64_t bound = kMinSegmentByte; segment.byte_size > bound; bound *= kMergeFactor) {
+            ++tier;
+        }
+        tiers[tier].push_back(&segment);
+    }
+
+    for (auto& [tier, tier_segments] : tiers) {
+        if (tier_segments.size() < kMergeFactor) {
+            continue;
+        }
+
+        std::sort(tier_segments.begin(), tier_segments.end(),
+            [](const SegmentedIndex::SegmentInfo* lhs, const SegmentedIndex::SegmentInfo* rhs) {
+                return lhs->byte_size < rhs->byte_size;
+            });
+
+        std::vector<uint64_t> numbers;
+        for (size_t i = 0; i < kMergeFactor; ++i) {
+            numbers.push_back(tier_segments[i]->number);
+        }
+        return numbers;
+    }
+
+    return {};
+}
+
+void SegmentedIndexer::MergeSegments(const std::vector<uint64_t>& numbers) {
+    std::unordered_set<size_t> deleted_file_ids;
+    uint64_t number;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        deleted_file_ids = tombstones_;
+        number = next_segment_++;
+    }
+
+    std::vector<std::unique_ptr<MappedIndex>> inputs;
+    std::vector<const MappedIndex*> segments;
+    for (uint64_t input_number : numbers) {
+        inputs.push_back(std::make_unique<MappedIndex>(
+            SegmentedIndex::SegmentPath(path_segments_, input_number).string()));
+        segments.push_back(inputs.back().get());
+    }
+
+    std::filesystem::path path_segment = SegmentedIndex::SegmentPath(path_segments_, number);
+    size_t count_file = MappedIndex::MergeMappedIndex(segments, path_segment.string(), deleted_file_ids);
+
+    std::vector<size_t> purged_file_ids;
+    for (size_t index : deleted_file_ids) {
+        for (const MappedIndex* segment : segments) {
+            if (segment->ContainsDocument(index)) {
+                purged_file_ids.push_back(index);
+                break;
+            }
+        }
+    }
+    inputs.clear();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::erase_if(segments_, [&numbers](const SegmentedIndex::SegmentInfo& segment) {
+            return std::find(numbers.begin(), numbers.end(), segment.number) != numbers.end();
+        });
+        segments_.push_back(SegmentedIndex::SegmentInfo{number, count_file, std::filesystem::file_size(path_segment)});
+        std::sort(segments_.begin(), segments_.end(),
+            [](const SegmentedIndex::SegmentInfo& lhs, const SegmentedIndex::SegmentInfo& rhs) {
+                return lhs.number < rhs.number;
+            });
+
+        for (size_t index : purged_file_ids) {
+            tombstones_.erase(index);
+        }
+        for (uint64_t input_number : numbers) {
+            merging_segments_.erase(input_number);
+        }
+        ++count_merges_;
+
+        SegmentedIndex::WriteManifest(path_segments_, segments_, next_segment_, tombstones_);
+    }
+
+    for (uint64_t input_number : numbers) {
+        std::filesystem::remove(SegmentedIndex::SegmentPath(path_segments_, input_number));
+    }
+
+    ScheduleMerges();
+}
+
+void SegmentedIndexer::WaitMerges() {
+    merge_pool_.Wait();
+}
+
+void SegmentedIndexer::SaveIndexer() {
+    WriteIdDirectoryToBinFile(StatePath(kFileNameIdDirectory).c_str());
+    WriteDocumentLengthToBinFile(StatePath(kFileNameDocumentLength).c_str());
+    WriteFileStateToBinFile(StatePath(kFileNameFileState).c_str());
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    SegmentedIndex::WriteManifest(path_segments_, segments_, next_segment_, tombstones_);
+}
+
+size_t SegmentedIndexer::CountDocuments() const {
+    return id_directory_.size();
+}
+
+size_t SegmentedIndexer::CountTombstones() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return tombstones_.size();
+}
+
+size_t SegmentedIndexer::CountSegments() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return segments_.size();
+}
+
+size_t SegmentedIndexer::CountMerges() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return count_merges_;
+}
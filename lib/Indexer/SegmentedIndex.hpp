@@ -0,0 +1,138 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "Indexer.hpp"
+#include "MappedIndex.hpp"
+#include "../ThreadPool/ThreadPool.hpp"
+
+class SegmentedIndex {
+public:
+    struct SegmentInfo {
+        uint64_t number;
+        uint64_t count_file;
+        uint64_t byte_size;
+    };
+private:
+    struct MergedPostings {
+        std::vector<uint64_t> file_ids;
+        std::vector<uint64_t> frequencies;
+        std::vector<uint32_t> segments;
+    };
+
+    class SegmentedIterator {
+    public:
+        SegmentedIterator() = default;
+        SegmentedIterator(const SegmentedIndex* index, std::vector<MappedIndex::iterator> iterators);
+
+        char operator*() const;
+
+        const uint64_t* GetStartArray(size_t index) const;
+        const uint64_t* GetEndArray(size_t index) const;
+        std::unordered_set<size_t> GetKeyArray() const;
+        const std::vector<uint64_t>& GetSortedKeys() const;
+        const std::vector<uint64_t>& GetSortedFrequencies() const;
+
+        bool empty(size_t index) const;
+        size_t size(size_t index) const;
+
+        friend bool operator==(const SegmentedIterator& lhs, const SegmentedIterator& rhs) {
+            return lhs.iterators_ == rhs.iterators_;
+        }
+
+        friend bool operator!=(const SegmentedIterator& lhs, const SegmentedIterator& rhs) {
+            return !(lhs == rhs);
+        }
+    private:
+        const MergedPostings& Merge() const;
+        const MappedIndex::iterator* FindSegment(size_t index) const;
+
+        const SegmentedIndex* index_ = nullptr;
+        std::vector<MappedIndex::iterator> iterators_;
+        mutable std::shared_ptr<MergedPostings> merged_;
+    };
+public:
+    using iterator = SegmentedIterator;
+
+    constexpr static const char* kDirectorySegments = "segments";
+    constexpr static const char* kFileNameManifest = "manifest.bin";
+    constexpr static const char kMagic[8] = "SSESEG1";
+
+    explicit SegmentedIndex(const std::filesystem::path& path_segments = kDirectorySegments);
+
+    iterator SearchWord(const std::string& word) const;
+    std::vector<std::string> ExpandWildcard(const std::string& pattern,
+                                            size_t max_expansions = Wildcard::kMaxExpansions) const;
+    std::vector<FuzzyTerm> ExpandFuzzy(const std::string& word, size_t max_distance,
+                                       size_t max_expansions = LevenshteinAutomaton::kMaxExpansions) const;
+    iterator end() const;
+
+    std::string_view StringIndex(size_t index) const;
+    size_t DocumentLength(size_t index) const;
+    double AverageDocumentLength() const;
+    size_t CountDocuments() const;
+    size_t CountSegments() const;
+
+    static std::filesystem::path SegmentPath(const std::filesystem::path& path_segments, uint64_t number);
+    static bool ReadManifest(const std::filesystem::path& path_segments, std::vector<SegmentInfo>& segments,
+                             uint64_t& next_segment, std::unordered_set<size_t>& tombstones);
+    static void WriteManifest(const std::filesystem::path& path_segments, const std::vector<SegmentInfo>& segments,
+                              uint64_t next_segment, const std::unordered_set<size_t>& tombstones);
+    static void RemoveSegments(const std::filesystem::path& path_segments);
+private:
+    const MappedIndex* FindSegment(size_t index) const;
+
+    std::vector<std::unique_ptr<MappedIndex>> segments_;
+    std::unordered_set<size_t> tombstones_;
+    size_t count_documents_ = 0;
+    uint64_t total_document_length_ = 0;
+};
+
+class SegmentedIndexer : public IndexerBase<true> {
+public:
+    constexpr static const size_t kDefaultMemoryBudget = 256 << 20;
+    constexpr static const size_t kMergeFactor = 4;
+    constexpr static const uint64_t kMinSegmentByte = 1 << 20;
+    constexpr static const size_t kMinCheckWords = 1 << 16;
+
+    explicit SegmentedIndexer(const std::filesystem::path& path_segments = SegmentedIndex::kDirectorySegments,
+        size_t memory_budget = kDefaultMemoryBudget);
+    ~SegmentedIndexer();
+
+    void StartIndexer(const std::filesystem::path& directory_path);
+    void UpdateIndexer(const std::filesystem::path& directory_path);
+    void Flush();
+    void WaitMerges();
+    void SaveIndexer();
+
+    size_t CountDocuments() const;
+    size_t CountTombstones() const;
+    size_t CountSegments() const;
+    size_t CountMerges() const;
+
+    size_t file_id = 0;
+private:
+    void IndexFiles(const std::vector<std::filesystem::path>& files);
+    void ScheduleMerges();
+    std::vector<uint64_t> SelectMerge() const;
+    void MergeSegments(const std::vector<uint64_t>& numbers);
+    std::string StatePath(const char* filename) const;
+
+    std::filesystem::path path_segments_;
+    size_t memory_budget_;
+    std::vector<size_t> segment_file_ids_;
+    size_t count_segment_words_ = 0;
+    size_t next_check_words_ = 0;
+
+    mutable std::mutex mutex_;
+    std::vector<SegmentedIndex::SegmentInfo> segments_;
+    std::unordered_set<uint64_t> merging_segments_;
+    uint64_t next_segment_ = 0;
+    size_t count_merges_ = 0;
+    ThreadPool merge_pool_;
+};
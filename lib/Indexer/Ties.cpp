@@ -1,99 +1,574 @@
 #include "Ties.hpp"
+#include "PostingCodec.hpp"
+#include "Wildcard.hpp"
+#include "../Trace/Trace.hpp"
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <queue>
 
 Ties::TiesNode::TiesNode()
-    : id_node(-3)
+    : children_begin(0)
+    , children_size(0)
+    , children_capacity(0)
+    , postings(kNullNode)
+    , symbol('\0')
 {}
 
-Ties::TiesNode::TiesNode(int id_node)
-    : id_node(id_node)
-{}
-
-Ties::TiesNode::TiesNode(int id_node, char symbol)
-    : id_node(id_node)
+Ties::TiesNode::TiesNode(char symbol)
+    : children_begin(0)
+    , children_size(0)
+    , children_capacity(0)
+    , postings(kNullNode)
     , symbol(symbol)
 {}
 
-Ties::WrapperSetStringWord::WrapperSetStringWord(std::unordered_set<size_t>::iterator iterator)
-    : current_value_(iterator)
+Ties::TiesArena::TiesArena()
+    : nodes(1)
 {}
 
-Ties::WrapperSetStringWord& Ties::WrapperSetStringWord::operator++() {
-    current_value_ = ++current_value_;
-    return *this;
+uint32_t Ties::TiesArena::FindChild(uint32_t node, char symbol) const {
+    const TiesNode& parent = nodes[node];
+    const char* begin = child_symbols.data() + parent.children_begin;
+    const void* found = std::memchr(begin, symbol, parent.children_size);
+
+    if (found == nullptr) {
+        return kNullNode;
+    }
+
+    return child_nodes[parent.children_begin + (static_cast<const char*>(found) - begin)];
+}
+
+void Ties::TiesArena::ReserveChildren(uint32_t node, size_t children_capacity) {
+    TiesNode& parent = nodes[node];
+    if (parent.children_capacity >= children_capacity) {
+        return;
+    }
+
+    uint32_t children_begin = static_cast<uint32_t>(child_symbols.size());
+    child_symbols.resize(child_symbols.size() + children_capacity);
+    child_nodes.resize(child_nodes.size() + children_capacity);
+
+    std::copy_n(child_symbols.begin() + parent.children_begin, parent.children_size,
+                child_symbols.begin() + children_begin);
+    std::copy_n(child_nodes.begin() + parent.children_begin, parent.children_size,
+                child_nodes.begin() + children_begin);
+
+    parent.children_begin = children_begin;
+    parent.children_capacity = static_cast<uint16_t>(children_capacity);
+}
+
+uint32_t Ties::TiesArena::GetOrAddChild(uint32_t node, char symbol) {
+    uint32_t child = FindChild(node, symbol);
+    if (child != kNullNode) {
+        return child;
+    }
+
+    if (nodes[node].children_size == nodes[node].children_capacity) {
+        ReserveChildren(node, std::max<size_t>(2, 2 * nodes[node].children_capacity));
+    }
+
+    child = static_cast<uint32_t>(nodes.size());
+    nodes.emplace_back(symbol);
+
+    TiesNode& parent = nodes[node];
+    auto symbols_begin = child_symbols.begin() + parent.children_begin;
+    auto symbols_end = symbols_begin + parent.children_size;
+    size_t position = std::lower_bound(symbols_begin, symbols_end, symbol) - symbols_begin;
+
+    auto nodes_begin = child_nodes.begin() + parent.children_begin;
+    std::copy_backward(symbols_begin + position, symbols_end, symbols_end + 1);
+    std::copy_backward(nodes_begin + position, nodes_begin + parent.children_size,
+                       nodes_begin + parent.children_size + 1);
+
+    *(symbols_begin + position) = symbol;
+    *(nodes_begin + position) = child;
+    ++parent.children_size;
+
+    return child;
+}
+
+Ties::Postings& Ties::TiesArena::GetOrAddPostings(uint32_t node) {
+    if (nodes[node].postings == kNullNode) {
+        nodes[node].postings = static_cast<uint32_t>(postings.size());
+        postings.emplace_back();
+    }
+
+    return postings[nodes[node].postings];
+}
+
+const Ties::Postings* Ties::TiesArena::GetPostings(uint32_t node) const {
+    if (nodes[node].postings == kNullNode) {
+        return nullptr;
+    }
+
+    return &postings[nodes[node].postings];
 }
 
-size_t Ties::WrapperSetStringWord::operator*() const {
-    return *current_value_;
+size_t Ties::Postings::Find(size_t file_id) const {
+    auto posting = std::lower_bound(file_ids.begin(), file_ids.end(), file_id);
+    if (posting == file_ids.end() || *posting != file_id) {
+        return file_ids.size();
+    }
+
+    return posting - file_ids.begin();
 }
 
-Ties::TiesIterator::TiesIterator(std::shared_ptr<TiesNode> current_node)
-    : current_node_(std::move(current_node))
-{}	
+void Ties::Postings::Add(size_t file_id, uint64_t position) {
+    if (file_ids.empty() || file_id > file_ids.back()) {
+        file_ids.push_back(file_id);
+        frequencies.push_back(1);
+        PostingCodec::EncodePositionDelta(0, position, lines);
+        lines_end.push_back(lines.size());
+        last_position = position;
+        return;
+    }
+
+    if (file_id == file_ids.back() && position >= last_position) {
+        if (position != last_position) {
+            ++frequencies.back();
+            PostingCodec::EncodePositionDelta(last_position, position, lines);
+            lines_end.back() = lines.size();
+            last_position = position;
+        }
+        return;
+    }
+
+    size_t posting = std::lower_bound(file_ids.begin(), file_ids.end(), file_id) - file_ids.begin();
+    std::vector<uint64_t> positions;
+    if (file_ids[posting] == file_id) {
+        GetPositions(posting, positions);
+        auto inserted = std::lower_bound(positions.begin(), positions.end(), position);
+        if (inserted != positions.end() && *inserted == position) {
+            return;
+        }
+        positions.insert(inserted, position);
+    } else {
+        file_ids.insert(file_ids.begin() + posting, file_id);
+        frequencies.insert(frequencies.begin() + posting, 0);
+        lines_end.insert(lines_end.begin() + posting, posting == 0 ? 0 : lines_end[posting - 1]);
+        positions.push_back(position);
+    }
+
+    ReplacePositions(posting, positions);
+}
+
+void Ties::Postings::ReplacePositions(size_t posting, const std::vector<uint64_t>& positions) {
+    std::vector<uint8_t> encoded;
+    uint64_t previous = 0;
+    for (uint64_t position : positions) {
+        PostingCodec::EncodePositionDelta(previous, position, encoded);
+        previous = position;
+    }
+
+    size_t lines_begin = LinesBegin(posting) - lines.data();
+    size_t old_size = lines_end[posting] - lines_begin;
+    if (encoded.size() > old_size) {
+        lines.insert(lines.begin() + lines_end[posting], encoded.size() - old_size, 0);
+    } else {
+        lines.erase(lines.begin() + lines_begin + encoded.size(), lines.begin() + lines_end[posting]);
+    }
+    std::copy(encoded.begin(), encoded.end(), lines.begin() + lines_begin);
+
+    for (size_t i = posting; i < lines_end.size(); ++i) {
+        lines_end[i] = lines_end[i] + encoded.size() - old_size;
+    }
+    frequencies[posting] = positions.size();
+    if (posting + 1 == size()) {
+        last_position = positions.back();
+    }
+}
+
+void Ties::Postings::Append(const Postings& other, size_t posting) {
+    const uint8_t* other_begin = other.LinesBegin(posting);
+    lines.insert(lines.end(), other_begin, other.lines.data() + other.lines_end[posting]);
+    file_ids.push_back(other.file_ids[posting]);
+    frequencies.push_back(other.frequencies[posting]);
+    lines_end.push_back(lines.size());
+}
+
+void Ties::Postings::Merge(Postings&& other) {
+    if (other.empty()) {
+        return;
+    }
+    if (empty()) {
+        *this = std::move(other);
+        return;
+    }
+
+    if (other.file_ids.front() > file_ids.back()) {
+        lines.reserve(lines.size() + other.lines.size());
+        for (size_t i = 0; i < other.size(); ++i) {
+            Append(other, i);
+        }
+        last_position = other.last_position;
+        return;
+    }
+
+    Postings merged;
+    merged.file_ids.reserve(size() + other.size());
+    merged.frequencies.reserve(size() + other.size());
+    merged.lines_end.reserve(size() + other.size());
+    merged.lines.reserve(lines.size() + other.lines.size());
+
+    std::vector<uint64_t> positions;
+    std::vector<uint64_t> other_positions;
+    size_t i = 0;
+    size_t j = 0;
+    while (i < size() || j < other.size()) {
+        if (j == other.size() || (i < size() && file_ids[i] < other.file_ids[j])) {
+            merged.Append(*this, i++);
+        } else if (i == size() || other.file_ids[j] < file_ids[i]) {
+            merged.Append(other, j++);
+        } else {
+            GetPositions(i, positions);
+            other.GetPositions(j, other_positions);
+            for (uint64_t position : other_positions) {
+                positions.push_back(position);
+            }
+            std::inplace_merge(positions.begin(), positions.end() - other_positions.size(), positions.end());
+            positions.erase(std::unique(positions.begin(), positions.end()), positions.end());
+
+            uint64_t previous = 0;
+            for (uint64_t position : positions) {
+                PostingCodec::EncodePositionDelta(previous, position, merged.lines);
+                previous = position;
+            }
+            merged.file_ids.push_back(file_ids[i]);
+            merged.frequencies.push_back(positions.size());
+            merged.lines_end.push_back(merged.lines.size());
+            ++i;
+            ++j;
+        }
+    }
+
+    *this = std::move(merged);
+    UpdateLastPosition();
+}
+
+size_t Ties::Postings::RemoveDocuments(const std::unordered_set<size_t>& indexes) {
+    size_t count_kept = 0;
+    size_t lines_size = 0;
+    for (size_t i = 0; i < file_ids.size(); ++i) {
+        if (indexes.contains(file_ids[i])) {
+            continue;
+        }
+
+        const uint8_t* lines_begin = LinesBegin(i);
+        const uint8_t* lines_end_pointer = lines.data() + lines_end[i];
+        std::copy(lines_begin, lines_end_pointer, lines.data() + lines_size);
+        lines_size += lines_end_pointer - lines_begin;
+
+        file_ids[count_kept] = file_ids[i];
+        frequencies[count_kept] = frequencies[i];
+        lines_end[count_kept] = lines_size;
+        ++count_kept;
+    }
+
+    size_t count_removed = file_ids.size() - count_kept;
+    if (count_removed != 0) {
+        file_ids.resize(count_kept);
+        frequencies.resize(count_kept);
+        lines_end.resize(count_kept);
+        lines.resize(lines_size);
+        UpdateLastPosition();
+    }
+
+    return count_removed;
+}
+
+void Ties::Postings::GetPositions(size_t posting, std::vector<uint64_t>& positions) const {
+    positions.clear();
+    for (PositionIterator it(LinesBegin(posting), frequencies[posting]); it != PositionIterator(); ++it) {
+        positions.push_back(*it);
+    }
+}
+
+void Ties::Postings::UpdateLastPosition() {
+    last_position = 0;
+    if (empty()) {
+        return;
+    }
+
+    for (PositionIterator it(LinesBegin(size() - 1), frequencies.back()); it != PositionIterator(); ++it) {
+        last_position = *it;
+    }
+}
+
+size_t Ties::Postings::MemoryUsage() const {
+    return (file_ids.capacity() + frequencies.capacity() + lines_end.capacity()) * sizeof(uint64_t)
+         + lines.capacity() * sizeof(uint8_t);
+}
+
+Ties::PositionIterator::PositionIterator(const uint8_t* input, size_t remaining)
+    : input_(input)
+    , remaining_(remaining)
+{
+    if (remaining_ != 0) {
+        current_value_ = PostingCodec::DecodePositionDelta(input_, 0);
+    }
+}
+
+Ties::PositionIterator& Ties::PositionIterator::operator++() {
+    if (--remaining_ != 0) {
+        current_value_ = PostingCodec::DecodePositionDelta(input_, current_value_);
+    }
+    return *this;
+}
+
+Ties::TiesIterator::TiesIterator(TiesArena* arena, uint32_t current_node)
+    : arena_(arena)
+    , current_node_(current_node)
+{}
 
 Ties::value_type Ties::TiesIterator::operator*() const {
-    return current_node_->symbol;
+    if (current_node_ == kNullNode) {
+        return '\0';
+    }
+
+    return arena_->nodes[current_node_].symbol;
+}
+
+const Ties::Postings& Ties::TiesIterator::GetPostings() const {
+    static const Postings kEmptyPostings;
+
+    if (current_node_ == kNullNode) {
+        return kEmptyPostings;
+    }
+
+    const Postings* postings = arena_->GetPostings(current_node_);
+    return postings == nullptr ? kEmptyPostings : *postings;
 }
 
-Ties::WrapperSetStringWord Ties::TiesIterator::GetStartArray(size_t index) const {
-    return WrapperSetStringWord(current_node_->string_word[index].begin());
+Ties::PositionIterator Ties::TiesIterator::GetStartArray(size_t index) const {
+    const Postings& postings = GetPostings();
+    size_t posting = postings.Find(index);
+    if (posting == postings.size()) {
+        return PositionIterator();
+    }
+
+    return PositionIterator(postings.LinesBegin(posting), postings.frequencies[posting]);
 }
 
-Ties::WrapperSetStringWord Ties::TiesIterator::GetEndArray(size_t index) const {
-    return WrapperSetStringWord(current_node_->string_word[index].end());
+Ties::PositionIterator Ties::TiesIterator::GetEndArray(size_t) const {
+    return PositionIterator();
 }
 
 void Ties::TiesIterator::insert(size_t index, size_t value) {
-    current_node_->string_word[index].insert(value);
+    arena_->GetOrAddPostings(current_node_).Add(index, value);
+}
+
+size_t Ties::TiesIterator::size(size_t index) const {
+    const Postings& postings = GetPostings();
+    size_t posting = postings.Find(index);
+    return posting == postings.size() ? 0 : postings.frequencies[posting];
 }
 
 Ties::Ties()
-    : head_tree_(std::make_shared<TiesNode>(-1))
-    , end_tree_(std::make_shared<TiesNode>(-2))
+    : arena_(std::make_unique<TiesArena>())
 {}
 
+Ties::Ties(const std::string& path_word_repository)
+    : arena_(std::make_unique<TiesArena>())
+{
+    ReadTiesFromFile(nullptr, path_word_repository);
+}
+
 Ties::Ties(std::unordered_map<size_t, std::unordered_set<char>> letters_by_level,
         const std::string& path_word_repository)
-    : end_tree_(std::make_shared<TiesNode>(-2))
+    : arena_(std::make_unique<TiesArena>())
 {
-    ReadTiesFromFile(letters_by_level, path_word_repository);
+    ReadTiesFromFile(&letters_by_level, path_word_repository);
 }
 
-void Ties::push(const std::string& word) {
-    std::shared_ptr<TiesNode> current_node_tree = head_tree_;
+void Ties::push(std::string_view word) {
+    InsertNode(word);
+}
+
+uint32_t Ties::InsertNode(std::string_view word) {
+    uint32_t current_node_tree = kHeadNode;
 
     for (size_t i = 0; i < word.size(); ++i) {
-        char current_symbol = word[i];
+        current_node_tree = arena_->GetOrAddChild(current_node_tree, word[i]);
+    }
 
-        if (current_node_tree->children[current_symbol] == nullptr) {
-            current_node_tree->children[current_symbol] = std::make_shared<TiesNode>(++count_node_, current_symbol);
-        }
+    return current_node_tree;
+}
+
+Ties::iterator Ties::insert(std::string_view word, size_t index, size_t value) {
+    uint32_t node = InsertNode(word);
+    arena_->GetOrAddPostings(node).Add(index, value);
+
+    return iterator(arena_.get(), node);
+}
 
-        current_node_tree = current_node_tree->children[current_symbol];
+Ties::TermCache::TermCache(Ties& word_repository)
+    : word_repository_(word_repository)
+    , entries_(kCacheSize)
+{}
+
+void Ties::TermCache::insert(std::string_view word, size_t index, size_t value) {
+    if (word.size() > kMaxLenghtWord) {
+        word_repository_.insert(word, index, value);
+        return;
     }
+
+    TermCacheEntry& entry = entries_[std::hash<std::string_view>()(word) % kCacheSize];
+    if (entry.node == kNullNode || entry.word_size != word.size()
+            || std::memcmp(entry.word, word.data(), word.size()) != 0) {
+        entry.node = word_repository_.InsertNode(word);
+        entry.word_size = static_cast<uint32_t>(word.size());
+        entry.postings = &word_repository_.arena_->GetOrAddPostings(entry.node);
+        std::memcpy(entry.word, word.data(), word.size());
+    }
+
+    entry.postings->Add(index, value);
 }
 
-Ties::iterator Ties::search(const std::string& word) const {
-    std::shared_ptr<TiesNode> current_node_tree = head_tree_;
+void Ties::merge(Ties&& other) {
+    MergeNode(*other.arena_, kHeadNode, kHeadNode);
+}
+
+size_t Ties::RemoveDocuments(const std::unordered_set<size_t>& indexes) {
+    size_t count_removed = 0;
+    if (indexes.empty()) {
+        return count_removed;
+    }
+
+    for (Postings& postings : arena_->postings) {
+        count_removed += postings.RemoveDocuments(indexes);
+    }
+
+    return count_removed;
+}
+
+void Ties::MergeNode(TiesArena& other, uint32_t other_node, uint32_t node) {
+    if (other.nodes[other_node].postings != kNullNode) {
+        arena_->GetOrAddPostings(node).Merge(std::move(other.postings[other.nodes[other_node].postings]));
+    }
+
+    const TiesNode& other_parent = other.nodes[other_node];
+    for (uint32_t i = 0; i < other_parent.children_size; ++i) {
+        uint32_t other_child = other.child_nodes[other_parent.children_begin + i];
+        uint32_t child = arena_->GetOrAddChild(node, other.nodes[other_child].symbol);
+        MergeNode(other, other_child, child);
+    }
+}
+
+Ties::iterator Ties::search(std::string_view word) const {
+    uint32_t current_node_tree = kHeadNode;
 
     for (size_t i = 0; i < word.size(); ++i) {
-        current_node_tree = current_node_tree->children[word[i]];
-        if (current_node_tree == nullptr) {
-            return iterator(end_tree_);
+        current_node_tree = arena_->FindChild(current_node_tree, word[i]);
+        if (current_node_tree == kNullNode) {
+            return end();
+        }
+    }
+
+    return iterator(arena_.get(), current_node_tree);
+}
+
+std::vector<std::string> Ties::ExpandWildcard(const std::string& pattern, size_t max_expansions) const {
+    std::string_view prefix = Wildcard::LiteralPrefix(pattern);
+    uint32_t prefix_node = kHeadNode;
+    for (char symbol : prefix) {
+        prefix_node = arena_->FindChild(prefix_node, symbol);
+        if (prefix_node == kNullNode) {
+            return {};
         }
     }
 
-    return iterator(current_node_tree);
+    std::vector<std::string> terms;
+    std::string term(prefix);
+    std::vector<std::pair<uint32_t, size_t>> stack = {{prefix_node, prefix.size()}};
+    while (!stack.empty()) {
+        auto [node, depth] = stack.back();
+        stack.pop_back();
+
+        if (depth > prefix.size()) {
+            term.resize(depth - 1);
+            term.push_back(arena_->nodes[node].symbol);
+        }
+
+        const Postings* postings = arena_->GetPostings(node);
+        if (postings != nullptr && !postings->empty() && Wildcard::Match(pattern, term)) {
+            terms.push_back(term);
+            Wildcard::CheckExpansions(terms.size(), pattern, max_expansions);
+        }
+
+        const TiesNode& tree_node = arena_->nodes[node];
+        for (uint32_t i = 0; i < tree_node.children_size; ++i) {
+            stack.emplace_back(arena_->child_nodes[tree_node.children_begin + i], depth + 1);
+        }
+    }
+    std::sort(terms.begin(), terms.end());
+
+    return terms;
+}
+
+std::vector<FuzzyTerm> Ties::ExpandFuzzy(const std::string& word, size_t max_distance, size_t max_expansions) const {
+    LevenshteinAutomaton automaton(word, max_distance);
+    std::vector<LevenshteinAutomaton::State> states = {automaton.Start()};
+    std::vector<FuzzyTerm> terms;
+    std::string term;
+
+    std::vector<std::pair<uint32_t, size_t>> stack = {{kHeadNode, 0}};
+    while (!stack.empty()) {
+        auto [node, depth] = stack.back();
+        stack.pop_back();
+
+        if (depth > 0) {
+            term.resize(depth - 1);
+            term.push_back(arena_->nodes[node].symbol);
+            if (states.size() <= depth) {
+                states.resize(depth + 1);
+            }
+
+            automaton.Step(states[depth - 1], term.back(), states[depth]);
+            if (!automaton.CanMatch(states[depth])) {
+                continue;
+            }
+
+            const Postings* postings = arena_->GetPostings(node);
+            if (postings != nullptr && !postings->empty() && automaton.IsMatch(states[depth])) {
+                terms.push_back(FuzzyTerm{term, automaton.Distance(states[depth])});
+            }
+        }
+
+        const TiesNode& tree_node = arena_->nodes[node];
+        for (uint32_t i = 0; i < tree_node.children_size; ++i) {
+            stack.emplace_back(arena_->child_nodes[tree_node.children_begin + i], depth + 1);
+        }
+    }
+    LevenshteinAutomaton::SelectClosest(terms, max_expansions);
+
+    return terms;
 }
 
 Ties::iterator Ties::begin() const {
-    return iterator(head_tree_);
+    return iterator(arena_.get(), kHeadNode);
 }
 
 Ties::iterator Ties::end() const {
-    return iterator(end_tree_);
+    return iterator(arena_.get(), kNullNode);
+}
+
+size_t Ties::CountNode() const {
+    return arena_->nodes.size();
+}
+
+size_t Ties::MemoryUsage() const {
+    size_t memory_usage = arena_->nodes.capacity() * sizeof(TiesNode)
+                        + arena_->child_symbols.capacity() * sizeof(char)
+                        + arena_->child_nodes.capacity() * sizeof(uint32_t)
+                        + arena_->postings.size() * sizeof(Postings);
+
+    for (const Postings& postings : arena_->postings) {
+        memory_usage += postings.MemoryUsage();
+    }
+
+    return memory_usage;
 }
 
 void Ties::SaveTies(const std::string& filename_ties) {
@@ -102,46 +577,54 @@ void Ties::SaveTies(const std::string& filename_ties) {
         std::cerr << "Error open file " << filename_ties << '\n';
         return;
     }
-    
-    std::queue<std::shared_ptr<TiesNode>> queue_node;
-    queue_node.push(head_tree_);
-    
+
+    file_trie.write(kMagic, sizeof(kMagic));
+
+    std::queue<uint32_t> queue_node;
+    queue_node.push(kHeadNode);
+    std::vector<uint8_t> buffer;
+
     while (!queue_node.empty()) {
-        std::shared_ptr<TiesNode> current_node = queue_node.front();
+        uint32_t current_node = queue_node.front();
         queue_node.pop();
-    	    
-        SaveNode(current_node, file_trie);
 
-        for (const auto& child : current_node->children) {
-            if (child.second == nullptr) {
-                std::cout << "nullptr: " << child.first << '\n';
-                continue;
-            }
-            queue_node.push(child.second);
-        }
+        SaveNode(current_node, file_trie, buffer);
 
+        const TiesNode& node = arena_->nodes[current_node];
+        for (uint32_t i = 0; i < node.children_size; ++i) {
+            queue_node.push(arena_->child_nodes[node.children_begin + i]);
+        }
     }
 }
 
-void Ties::SaveNode(const std::shared_ptr<TiesNode>& save_node, std::ofstream& file_trie) {
-    size_t size_node = 0;
-    for (const auto& node_set : save_node->string_word) {
-        size_node += node_set.second.size() * sizeof(size_t) + 2 * sizeof(size_t);
+void Ties::EncodePostings(const Postings& postings, std::vector<uint8_t>& output) {
+    std::vector<uint64_t> lines_size(postings.size());
+    for (size_t i = 0; i < postings.size(); ++i) {
+        lines_size[i] = postings.lines_end[i] - (postings.LinesBegin(i) - postings.lines.data());
     }
-    
-    TiesHeader header_node(save_node->symbol, save_node->children.size(),
-                            save_node->string_word.size(), size_node);
 
-    file_trie.write(reinterpret_cast<char*>(&header_node), sizeof(TiesHeader));
+    PostingCodec::EncodeVarint(postings.size(), output);
+    PostingCodec::EncodeList(postings.file_ids, true, output);
+    PostingCodec::EncodeList(postings.frequencies, false, output);
+    PostingCodec::EncodeList(lines_size, false, output);
+    output.insert(output.end(), postings.lines.begin(), postings.lines.end());
+}
+
+void Ties::SaveNode(uint32_t save_node, std::ofstream& file_trie, std::vector<uint8_t>& buffer) {
+    buffer.clear();
 
-    for (const auto& node_set : save_node->string_word) {
-        size_t size_node_set = node_set.second.size();
-        file_trie.write(reinterpret_cast<char*>(&size_node_set), sizeof(size_node_set));
-        file_trie.write(reinterpret_cast<const char*>(&node_set.first), sizeof(node_set.first));
-        for (const auto element_set : node_set.second) {
-            file_trie.write(reinterpret_cast<const char*>(&element_set), sizeof(element_set));
-        }
+    const Postings* postings = arena_->GetPostings(save_node);
+    if (postings != nullptr && !postings->empty()) {
+        EncodePostings(*postings, buffer);
     }
+
+    std::vector<uint8_t> header_node;
+    header_node.push_back(static_cast<uint8_t>(arena_->nodes[save_node].symbol));
+    PostingCodec::EncodeVarint(arena_->nodes[save_node].children_size, header_node);
+    PostingCodec::EncodeVarint(buffer.size(), header_node);
+
+    file_trie.write(reinterpret_cast<const char*>(header_node.data()), header_node.size());
+    file_trie.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
 }
 
 Ties::TiesHeader::TiesHeader(char symbol, size_t children_size, size_t string_word_lenght
@@ -152,83 +635,161 @@ Ties::TiesHeader::TiesHeader(char symbol, size_t children_size, size_t string_wo
     , word_string_size(word_string_size)
 {}
 
-void Ties::ReadTiesFromFile(std::unordered_map<size_t, std::unordered_set<char>> letters_by_level,
+void Ties::ReadTiesFromFile(std::unordered_map<size_t, std::unordered_set<char>>* letters_by_level,
         const std::string& path_word_repository) {
+    Trace::ScopedTimer timer(Trace::Phase::kReadTies);
 
     std::ifstream file_trie(path_word_repository, std::ios::binary);
     if (!file_trie.is_open()) {
         std::cerr << "Error open file " << path_word_repository << '\n';
+        return;
+    }
+
+    char magic[sizeof(kMagic)] = {};
+    file_trie.read(magic, sizeof(magic));
+    is_legacy_format_ = !std::equal(magic, magic + sizeof(magic), kMagic);
+    if (is_legacy_format_ && std::equal(magic, magic + sizeof(magic) - 2, kMagic)) {
+        throw std::runtime_error("outdated trie format " + path_word_repository + ", rebuild the index");
+    }
+    if (is_legacy_format_) {
+        file_trie.seekg(0, std::ios::beg);
     }
 
     std::queue<InfoNodeHeader> queue_node;
-    
-    TiesHeader current_header = ReadHeaderNode(file_trie);
-    head_tree_ = std::make_shared<TiesNode>(-1);
 
-    InfoNodeHeader head_header_tree = InfoNodeHeader{-1, true, current_header, head_tree_};
-    queue_node.push(head_header_tree);
+    TiesHeader current_header = ReadHeaderNode(file_trie);
+    if (!is_legacy_format_) {
+        file_trie.seekg(static_cast<std::streamoff>(current_header.word_string_size), std::ios::cur);
+    }
+    arena_->ReserveChildren(kHeadNode, current_header.children_size);
+    queue_node.push(InfoNodeHeader{-1, kHeadNode, current_header});
 
-    while(!queue_node.empty()) {
+    std::vector<uint8_t> buffer;
+    while (!queue_node.empty()) {
         InfoNodeHeader info_current_node = queue_node.front();
         queue_node.pop();
 
         for (size_t i = 0; i < info_current_node.header_info.children_size; ++i) {
             TiesHeader childred_current_node = ReadHeaderNode(file_trie);
-            InfoNodeHeader info_childred;
-        
-            if (!info_current_node.is_contains_set || 
-            !letters_by_level[info_current_node.depth + 1].contains(childred_current_node.symbol)) {
-                file_trie.seekg(file_trie.tellg() + static_cast<std::streamoff>(childred_current_node.word_string_size)
-                , std::ios::beg);
-
-                info_childred = {info_current_node.depth + 1, false, childred_current_node};
-                queue_node.push(info_childred);
+
+            if (info_current_node.node == kNullNode || (letters_by_level != nullptr &&
+            !(*letters_by_level)[info_current_node.depth + 1].contains(childred_current_node.symbol))) {
+                file_trie.seekg(static_cast<std::streamoff>(childred_current_node.word_string_size), std::ios::cur);
+
+                queue_node.push(InfoNodeHeader{info_current_node.depth + 1, kNullNode, childred_current_node});
             } else {
-                info_current_node.node->children[childred_current_node.symbol] = 
-                std::make_shared<TiesNode>(count_node_++, childred_current_node.symbol);
+                uint32_t child = arena_->GetOrAddChild(info_current_node.node, childred_current_node.symbol);
+                arena_->ReserveChildren(child, childred_current_node.children_size);
 
-                ReadWordsNode(file_trie, info_current_node.node->children[childred_current_node.symbol]
-                    , childred_current_node.string_word_lenght);
+                ReadWordsNode(file_trie, child, childred_current_node, buffer);
 
-                info_childred = {info_current_node.depth + 1, true, childred_current_node, 
-                                info_current_node.node->children[childred_current_node.symbol]};
-                queue_node.push(info_childred);
+                queue_node.push(InfoNodeHeader{info_current_node.depth + 1, child, childred_current_node});
             }
         }
-
     }
 }
 
 Ties::TiesHeader Ties::ReadHeaderNode(std::ifstream& file_trie) {
     TiesHeader header_node;
 
-    file_trie.read(reinterpret_cast<char*>(&header_node), sizeof(TiesHeader));
+    if (is_legacy_format_) {
+        file_trie.read(reinterpret_cast<char*>(&header_node), sizeof(TiesHeader));
+        return header_node;
+    }
+
+    header_node.symbol = static_cast<char>(file_trie.get());
+    header_node.children_size = ReadVarint(file_trie);
+    header_node.string_word_lenght = 0;
+    header_node.word_string_size = ReadVarint(file_trie);
 
     return header_node;
 }
 
-void Ties::ReadWordsNode(std::ifstream& file_trie, std::shared_ptr<TiesNode> current_node, size_t lenght_word_string) {
-    for (size_t i = 0; i < lenght_word_string; ++i) {
+size_t Ties::ReadVarint(std::ifstream& file_trie) {
+    size_t value = 0;
+    for (size_t shift = 0; ; shift += 7) {
+        int byte = file_trie.get();
+        if (byte == std::char_traits<char>::eof()) {
+            return value;
+        }
+        value |= static_cast<size_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+}
+
+void Ties::ReadWordsNode(std::ifstream& file_trie, uint32_t current_node, const TiesHeader& header_node,
+        std::vector<uint8_t>& buffer) {
+    if (is_legacy_format_) {
+        ReadLegacyWordsNode(file_trie, current_node, header_node.string_word_lenght);
+        return;
+    }
+
+    if (header_node.word_string_size == 0) {
+        return;
+    }
+
+    buffer.resize(header_node.word_string_size);
+    file_trie.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+
+    Postings& postings = arena_->GetOrAddPostings(current_node);
+    const uint8_t* input = buffer.data();
+
+    size_t count_file = PostingCodec::DecodeVarint(input);
+    input = PostingCodec::DecodeList(input, count_file, true, postings.file_ids);
+    input = PostingCodec::DecodeList(input, count_file, false, postings.frequencies);
+    input = PostingCodec::DecodeList(input, count_file, false, postings.lines_end);
+
+    for (size_t i = 1; i < count_file; ++i) {
+        postings.lines_end[i] += postings.lines_end[i - 1];
+    }
+    size_t lines_size = count_file == 0 ? 0 : postings.lines_end.back();
+    if (lines_size > static_cast<size_t>(buffer.data() + buffer.size() - input)) {
+        throw std::runtime_error("invalid trie node");
+    }
+
+    postings.lines.assign(input, input + lines_size);
+    postings.UpdateLastPosition();
+}
+
+void Ties::ReadLegacyWordsNode(std::ifstream& file_trie, uint32_t current_node, size_t lenght_word_string) {
+    if (lenght_word_string == 0) {
+        return;
+    }
+
+    std::vector<std::pair<size_t, std::vector<uint64_t>>> node_sets(lenght_word_string);
+    for (auto& [index_node_set, lines] : node_sets) {
         size_t size_node_set = 0;
-        size_t index_node_set = 0;
         file_trie.read(reinterpret_cast<char*>(&size_node_set), sizeof(size_t));
         file_trie.read(reinterpret_cast<char*>(&index_node_set), sizeof(size_t));
-        for (size_t j = 0; j < size_node_set; ++j) {
-            size_t current_element_set;
-            file_trie.read(reinterpret_cast<char*>(&current_element_set), sizeof(size_t));
-            current_node->string_word[index_node_set].insert(current_element_set);
+        lines.resize(size_node_set);
+        file_trie.read(reinterpret_cast<char*>(lines.data()), static_cast<std::streamsize>(size_node_set * sizeof(size_t)));
+        std::sort(lines.begin(), lines.end());
+    }
+    std::sort(node_sets.begin(), node_sets.end());
+
+    Postings& postings = arena_->GetOrAddPostings(current_node);
+    for (const auto& [index_node_set, lines] : node_sets) {
+        for (uint64_t line : lines) {
+            postings.Add(index_node_set, PostingCodec::PackPosition(line, 0));
         }
     }
 }
 
 std::unordered_set<size_t> Ties::TiesIterator::GetKeyArray() const {
-    std::unordered_set<size_t> index_array;
-    for (const auto& [key, value] : current_node_->string_word) {
-        index_array.insert(key);
-    }
-    return index_array;
+    const std::vector<uint64_t>& file_ids = GetPostings().file_ids;
+    return std::unordered_set<size_t>(file_ids.begin(), file_ids.end());
+}
+
+const std::vector<uint64_t>& Ties::TiesIterator::GetSortedKeys() const {
+    return GetPostings().file_ids;
+}
+
+const std::vector<uint64_t>& Ties::TiesIterator::GetSortedFrequencies() const {
+    return GetPostings().frequencies;
 }
 
 bool Ties::TiesIterator::empty(size_t index) const {
-    return current_node_->string_word[index].size() == 0;
-}
\ No newline at end of file
+    return size(index) == 0;
+}
@@ -1,25 +1,111 @@
 #pragma once
 
+#include <deque>
+#include <iterator>
 #include <unordered_map>
 #include <unordered_set>
 #include <memory>
 #include <filesystem>
 #include <fstream>
+#include <string>
 #include <vector>
+#include <string_view>
+#include <cstdint>
+
+#include "LevenshteinAutomaton.hpp"
 
 class Ties {
 public:
-    using value_type = char;	
+    using value_type = char;
+
+    struct Postings {
+        std::vector<uint64_t> file_ids;
+        std::vector<uint64_t> frequencies;
+        std::vector<uint64_t> lines_end;
+        std::vector<uint8_t> lines;
+        uint64_t last_position = 0;
+
+        bool empty() const {
+            return file_ids.empty();
+        }
+
+        size_t size() const {
+            return file_ids.size();
+        }
+
+        const uint8_t* LinesBegin(size_t posting) const {
+            return lines.data() + (posting == 0 ? 0 : lines_end[posting - 1]);
+        }
+
+        size_t Find(size_t file_id) const;
+        void Add(size_t file_id, uint64_t position);
+        void Merge(Postings&& other);
+        size_t RemoveDocuments(const std::unordered_set<size_t>& indexes);
+        void GetPositions(size_t posting, std::vector<uint64_t>& positions) const;
+        void UpdateLastPosition();
+        size_t MemoryUsage() const;
+    private:
+        void Append(const Postings& other, size_t posting);
+        void ReplacePositions(size_t posting, const std::vector<uint64_t>& positions);
+    };
+
+    class PositionIterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = uint64_t;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const uint64_t*;
+        using reference = uint64_t;
+
+        PositionIterator() = default;
+        PositionIterator(const uint8_t* input, size_t remaining);
+
+        PositionIterator& operator++();
+
+        uint64_t operator*() const {
+            return current_value_;
+        }
+
+        friend bool operator==(const PositionIterator& lhs, const PositionIterator& rhs) {
+            return lhs.remaining_ == rhs.remaining_;
+        }
+
+        friend bool operator!=(const PositionIterator& lhs, const PositionIterator& rhs) {
+            return !(lhs == rhs);
+        }
+    private:
+        const uint8_t* input_ = nullptr;
+        size_t remaining_ = 0;
+        uint64_t current_value_ = 0;
+    };
 private:
+    constexpr static const uint32_t kHeadNode = 0;
+    constexpr static const uint32_t kNullNode = UINT32_MAX;
+
     struct TiesNode {
+        uint32_t children_begin;
+        uint16_t children_size;
+        uint16_t children_capacity;
+        uint32_t postings;
         char symbol;
-        int id_node;
-        std::unordered_map<char, std::shared_ptr<TiesNode>> children;
-        std::unordered_map<size_t, std::unordered_set<size_t>> string_word;
 
         TiesNode();
-        explicit TiesNode(int id_node);
-        explicit TiesNode(int id_node, char symbol);
+        explicit TiesNode(char symbol);
+    };
+
+    struct TiesArena {
+        std::vector<TiesNode> nodes;
+        std::vector<char> child_symbols;
+        std::vector<uint32_t> child_nodes;
+        std::deque<Postings> postings;
+
+        TiesArena();
+
+        uint32_t FindChild(uint32_t node, char symbol) const;
+        uint32_t GetOrAddChild(uint32_t node, char symbol);
+        void ReserveChildren(uint32_t node, size_t children_capacity);
+        Postings& GetOrAddPostings(uint32_t node);
+        const Postings* GetPostings(uint32_t node) const;
     };
 
     struct TiesHeader {
@@ -32,80 +118,107 @@ private:
         TiesHeader(char symbol, size_t children_size, size_t string_word_lenght, size_t word_string_size);
     };
 
-    class WrapperSetStringWord {
-    public:
-        explicit WrapperSetStringWord(std::unordered_set<size_t>::iterator iterator);
-        
-        WrapperSetStringWord& operator++();
-        size_t operator*() const;
-
-        friend bool operator==(const WrapperSetStringWord& lhs, const WrapperSetStringWord& rhs) {
-            return lhs.current_value_ == rhs.current_value_;
-        }
-
-        friend bool operator!=(const WrapperSetStringWord& lhs, const WrapperSetStringWord& rhs) {
-            return !(lhs == rhs);
-        }
-    private:
-        std::unordered_set<size_t>::iterator current_value_;
-    };
-
     class TiesIterator {
     public:
         TiesIterator() = default;
-        explicit TiesIterator(std::shared_ptr<TiesNode> current_node);
+        TiesIterator(TiesArena* arena, uint32_t current_node);
 
         value_type operator*() const;
 
-        WrapperSetStringWord GetStartArray(size_t index) const;
-        WrapperSetStringWord GetEndArray(size_t index) const;
+        PositionIterator GetStartArray(size_t index) const;
+        PositionIterator GetEndArray(size_t index) const;
         std::unordered_set<size_t> GetKeyArray() const;
+        const std::vector<uint64_t>& GetSortedKeys() const;
+        const std::vector<uint64_t>& GetSortedFrequencies() const;
 
         void insert(size_t index, size_t value);
         bool empty(size_t index) const;
-
-        size_t size(size_t index) const {
-            return current_node_->string_word[index].size();
-        }
+        size_t size(size_t index) const;
 
         friend bool operator==(const TiesIterator& lhs, const TiesIterator& rhs) {
-            return lhs.current_node_->id_node == rhs.current_node_->id_node;
+            return lhs.current_node_ == rhs.current_node_;
         }
 
         friend bool operator!=(const TiesIterator& lhs, const TiesIterator& rhs) {
             return !(lhs == rhs);
         }
     private:
-        std::shared_ptr<TiesNode> current_node_;
+        const Postings& GetPostings() const;
+
+        TiesArena* arena_ = nullptr;
+        uint32_t current_node_ = kNullNode;
     };
 
     struct InfoNodeHeader {
         int depth;
-        bool is_contains_set;
+        uint32_t node;
         TiesHeader header_info;
-        std::shared_ptr<TiesNode> node;
     };
 public:
     using iterator = TiesIterator;
 
+    class TermCache {
+    public:
+        constexpr static const size_t kCacheSize = 512;
+        constexpr static const size_t kMaxLenghtWord = 32;
+
+        explicit TermCache(Ties& word_repository);
+
+        void insert(std::string_view word, size_t index, size_t value);
+    private:
+        struct TermCacheEntry {
+            uint32_t node = kNullNode;
+            uint32_t word_size = 0;
+            Postings* postings = nullptr;
+            char word[kMaxLenghtWord];
+        };
+
+        Ties& word_repository_;
+        std::vector<TermCacheEntry> entries_;
+    };
+
+    constexpr static const char kMagic[8] = "SSETRI4";
+
     Ties();
+    explicit Ties(const std::string& path_word_repository);
     explicit Ties(std::unordered_map<size_t, std::unordered_set<char>> letters_by_level,
         const std::string& path_word_repository);
 
-    void push(const std::string& word);
-    iterator search(const std::string& word) const;
+    void push(std::string_view word);
+    void merge(Ties&& other);
+    size_t RemoveDocuments(const std::unordered_set<size_t>& indexes);
+    iterator insert(std::string_view word, size_t index, size_t value);
+    iterator search(std::string_view word) const;
+    std::vector<std::string> ExpandWildcard(const std::string& pattern, size_t max_expansions) const;
+    std::vector<FuzzyTerm> ExpandFuzzy(const std::string& word, size_t max_distance, size_t max_expansions) const;
     iterator begin() const;
     iterator end() const;
 
+    bool HasPositions() const {
+        return !is_legacy_format_;
+    }
+
+    size_t CountNode() const;
+    size_t MemoryUsage() const;
+
     void SaveTies(const std::string& filename_ties);
 private:
-    size_t count_node_;
-    std::shared_ptr<TiesNode> head_tree_;
-    std::shared_ptr<TiesNode> end_tree_;
+    friend class MappedIndex;
 
-    void ReadTiesFromFile(std::unordered_map<size_t, std::unordered_set<char>> letters_by_level,
+    std::unique_ptr<TiesArena> arena_;
+
+    uint32_t InsertNode(std::string_view word);
+    void ReadTiesFromFile(std::unordered_map<size_t, std::unordered_set<char>>* letters_by_level,
         const std::string& path_word_repository);
+    void MergeNode(TiesArena& other, uint32_t other_node, uint32_t node);
     TiesHeader ReadHeaderNode(std::ifstream& file_trie);
-    void SaveNode(const std::shared_ptr<TiesNode>& save_node, std::ofstream& file_trie);
-    void ReadWordsNode(std::ifstream& file_trie, std::shared_ptr<TiesNode> current_node, size_t lenght_word_string);
-};
\ No newline at end of file
+    void SaveNode(uint32_t save_node, std::ofstream& file_trie, std::vector<uint8_t>& buffer);
+    void ReadWordsNode(std::ifstream& file_trie, uint32_t current_node, const TiesHeader& header_node,
+        std::vector<uint8_t>& buffer);
+    void ReadLegacyWordsNode(std::ifstream& file_trie, uint32_t current_node, size_t lenght_word_string);
+
+    static void EncodePostings(const Postings& postings, std::vector<uint8_t>& output);
+    static size_t ReadVarint(std::ifstream& file_trie);
+
+    bool is_legacy_format_ = false;
+};
@@ -0,0 +1,202 @@
+#include "Tokenizer.hpp"
+
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+constexpr uint8_t kSpace = 1;
+constexpr uint8_t kNewline = 2;
+
+constexpr std::array<uint8_t, 256> CreateClassTable() {
+    std::array<uint8_t, 256> table = {};
+    for (char symbol : {' ', '\t', '\n', '\v', '\f', '\r'}) {
+        table[static_cast<uint8_t>(symbol)] = kSpace;
+    }
+    table[static_cast<uint8_t>('\n')] |= kNewline;
+
+    return table;
+}
+
+constexpr std::array<char, 256> CreateLowerTable() {
+    std::array<char, 256> table = {};
+    for (size_t i = 0; i < table.size(); ++i) {
+        table[i] = static_cast<char>(i >= 'A' && i <= 'Z' ? i - 'A' + 'a' : i);
+    }
+
+    return table;
+}
+
+constexpr std::array<uint8_t, 256> kClassTable = CreateClassTable();
+constexpr std::array<char, 256> kLowerTable = CreateLowerTable();
+
+uint8_t ClassOf(char symbol) {
+    return kClassTable[static_cast<uint8_t>(symbol)];
+}
+
+#if defined(__SSE2__)
+struct ChunkClass {
+    uint32_t space;
+    uint32_t newline;
+};
+
+ChunkClass ClassifyChunk(const char* data) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    __m128i is_control_space = _mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8('\t' - 1)),
+                                             _mm_cmplt_epi8(chunk, _mm_set1_epi8('\r' + 1)));
+    __m128i is_space = _mm_or_si128(is_control_space, _mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')));
+
+    return ChunkClass{
+        static_cast<uint32_t>(_mm_movemask_epi8(is_space)),
+        static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n'))))
+    };
+}
+
+void ToLowerChunk(char* data) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    __m128i is_upper = _mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8('A' - 1)),
+                                     _mm_cmplt_epi8(chunk, _mm_set1_epi8('Z' + 1)));
+    chunk = _mm_add_epi8(chunk, _mm_and_si128(is_upper, _mm_set1_epi8('a' - 'A')));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(data), chunk);
+}
+#endif
+
+}
+
+Tokenizer::Tokenizer(const std::filesystem::path& file_path)
+    : file_(file_path, std::ios::binary)
+    , buffer_(kBufferSize)
+    , data_(buffer_.data())
+{
+    if (!file_.is_open()) {
+        throw std::runtime_error("error open file");
+    }
+}
+
+Tokenizer::Tokenizer(char* data, size_t size)
+    : data_(data)
+    , size_(size)
+    , content_hash_(HashBytes(kHashSeed, data, size))
+    , is_end_(true)
+{}
+
+void Tokenizer::ToLower(char* data, size_t size) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 16 <= size; i += 16) {
+        ToLowerChunk(data + i);
+    }
+#endif
+    for (; i < size; ++i) {
+        data[i] = kLowerTable[static_cast<uint8_t>(data[i])];
+    }
+}
+
+uint64_t Tokenizer::HashBytes(uint64_t hash, const char* data, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ static_cast<uint8_t>(data[i])) * 1099511628211ull;
+    }
+
+    return hash;
+}
+
+size_t Tokenizer::SkipSpaces(size_t position) {
+#if defined(__SSE2__)
+    for (; position + 16 <= size_; position += 16) {
+        ChunkClass chunk = ClassifyChunk(data_ + position);
+        uint32_t word_mask = ~chunk.space & 0xFFFF;
+        if (word_mask != 0) {
+            uint32_t offset = __builtin_ctz(word_mask);
+            line_number_ += __builtin_popcount(chunk.newline & ((1u << offset) - 1));
+            return position + offset;
+        }
+        line_number_ += __builtin_popcount(chunk.newline);
+    }
+#endif
+    for (; position < size_; ++position) {
+        uint8_t symbol_class = ClassOf(data_[position]);
+        if (!(symbol_class & kSpace)) {
+            break;
+        }
+        line_number_ += (symbol_class & kNewline) != 0;
+    }
+
+    return position;
+}
+
+size_t Tokenizer::FindWordEnd(size_t position) {
+#if defined(__SSE2__)
+    for (; position + 16 <= size_; position += 16) {
+        ToLowerChunk(data_ + position);
+        uint32_t space_mask = ClassifyChunk(data_ + position).space;
+        if (space_mask != 0) {
+            return position + __builtin_ctz(space_mask);
+        }
+    }
+#endif
+    for (; position < size_ && !(ClassOf(data_[position]) & kSpace); ++position) {
+        data_[position] = kLowerTable[static_cast<uint8_t>(data_[position])];
+    }
+
+    return position;
+}
+
+bool Tokenizer::Fill(size_t keep_from) {
+    if (is_end_) {
+        return false;
+    }
+
+    size_t count_keep = size_ - keep_from;
+    std::memmove(buffer_.data(), buffer_.data() + keep_from, count_keep);
+    position_ -= keep_from;
+    size_ = count_keep;
+
+    if (size_ == buffer_.size()) {
+        buffer_.resize(buffer_.size() * 2);
+        data_ = buffer_.data();
+    }
+
+    file_.read(buffer_.data() + size_, static_cast<std::streamsize>(buffer_.size() - size_));
+    size_t count_read = static_cast<size_t>(file_.gcount());
+    content_hash_ = HashBytes(content_hash_, buffer_.data() + size_, count_read);
+    size_ += count_read;
+    is_end_ = count_read == 0;
+
+    return count_read != 0;
+}
+
+bool Tokenizer::Next(std::string_view& word) {
+    while (true) {
+        position_ = SkipSpaces(position_);
+        if (position_ == size_) {
+            if (!Fill(size_)) {
+                return false;
+            }
+            continue;
+        }
+
+        size_t word_begin = position_;
+        position_ = FindWordEnd(position_);
+        while (position_ == size_ && !is_end_) {
+            Fill(word_begin);
+            word_begin = 0;
+            position_ = FindWordEnd(position_);
+        }
+
+        word = std::string_view(data_ + word_begin, position_ - word_begin);
+        return true;
+    }
+}
+
+size_t Tokenizer::LineNumber() const {
+    return line_number_;
+}
+
+uint64_t Tokenizer::ContentHash() const {
+    return content_hash_;
+}
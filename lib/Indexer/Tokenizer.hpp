@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+#include <vector>
+
+class Tokenizer {
+public:
+    constexpr static const size_t kBufferSize = 1 << 16;
+    constexpr static const uint64_t kHashSeed = 14695981039346656037ull;
+
+    explicit Tokenizer(const std::filesystem::path& file_path);
+    Tokenizer(char* data, size_t size);
+
+    bool Next(std::string_view& word);
+    size_t LineNumber() const;
+    uint64_t ContentHash() const;
+
+    static void ToLower(char* data, size_t size);
+    static uint64_t HashBytes(uint64_t hash, const char* data, size_t size);
+private:
+    size_t SkipSpaces(size_t position);
+    size_t FindWordEnd(size_t position);
+    bool Fill(size_t keep_from);
+
+    std::ifstream file_;
+    std::vector<char> buffer_;
+    char* data_ = nullptr;
+    size_t position_ = 0;
+    size_t size_ = 0;
+    size_t line_number_ = 1;
+    uint64_t content_hash_ = kHashSeed;
+    bool is_end_ = false;
+};
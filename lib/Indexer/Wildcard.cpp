@@ -0,0 +1,56 @@
+#include "Wildcard.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+bool Wildcard::IsWildcard(std::string_view word) {
+    return word.find(kWildcard) != std::string_view::npos;
+}
+
+bool Wildcard::Match(std::string_view pattern, std::string_view term) {
+    size_t i = 0;
+    size_t j = 0;
+    size_t star = std::string_view::npos;
+    size_t star_term = 0;
+
+    while (j < term.size()) {
+        if (i < pattern.size() && pattern[i] == kWildcard) {
+            star = i++;
+            star_term = j;
+        } else if (i < pattern.size() && pattern[i] == term[j]) {
+            ++i;
+            ++j;
+        } else if (star != std::string_view::npos) {
+            i = star + 1;
+            j = ++star_term;
+        } else {
+            return false;
+        }
+    }
+
+    while (i < pattern.size() && pattern[i] == kWildcard) {
+        ++i;
+    }
+
+    return i == pattern.size();
+}
+
+std::string_view Wildcard::LiteralPrefix(std::string_view pattern) {
+    return pattern.substr(0, std::min(pattern.find(kWildcard), pattern.size()));
+}
+
+std::string_view Wildcard::LiteralSuffix(std::string_view pattern) {
+    size_t last_wildcard = pattern.rfind(kWildcard);
+    if (last_wildcard == std::string_view::npos) {
+        return pattern;
+    }
+
+    return pattern.substr(last_wildcard + 1);
+}
+
+void Wildcard::CheckExpansions(size_t count_terms, const std::string& pattern, size_t max_expansions) {
+    if (count_terms > max_expansions) {
+        throw std::invalid_argument("wildcard " + pattern + " matches more than " +
+                                    std::to_string(max_expansions) + " terms");
+    }
+}
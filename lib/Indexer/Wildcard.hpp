@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+struct Wildcard {
+    constexpr static const char kWildcard = '*';
+    constexpr static const size_t kMaxExpansions = 1024;
+    constexpr static const size_t kMaxTermLength = 32;
+
+    static bool IsWildcard(std::string_view word);
+    static bool Match(std::string_view pattern, std::string_view term);
+    static std::string_view LiteralPrefix(std::string_view pattern);
+    static std::string_view LiteralSuffix(std::string_view pattern);
+    static void CheckExpansions(size_t count_terms, const std::string& pattern, size_t max_expansions);
+};
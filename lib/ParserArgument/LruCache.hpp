@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+template<typename Value>
+class LruCache {
+public:
+    constexpr static const size_t kDefaultByteSize = 64 << 20;
+    constexpr static const size_t kEntryOverhead = 64;
+
+    struct Stats {
+        size_t count_hits = 0;
+        size_t count_misses = 0;
+        size_t count_evictions = 0;
+        size_t count_invalidations = 0;
+    };
+
+    explicit LruCache(size_t max_byte_size = kDefaultByteSize)
+        : max_byte_size_(max_byte_size)
+    {}
+
+    const Value* Find(const std::string& key) {
+        auto iterator = index_.find(key);
+        if (iterator == index_.end()) {
+            ++stats_.count_misses;
+            return nullptr;
+        }
+
+        ++stats_.count_hits;
+        entries_.splice(entries_.begin(), entries_, iterator->second);
+        return &iterator->second->value;
+    }
+
+    void Insert(const std::string& key, Value value, size_t value_byte_size) {
+        size_t byte_size = key.size() + value_byte_size + kEntryOverhead;
+        if (byte_size > max_byte_size_) {
+            return;
+        }
+
+        auto iterator = index_.find(key);
+        if (iterator != index_.end()) {
+            byte_size_ -= iterator->second->byte_size;
+            entries_.erase(iterator->second);
+            index_.erase(iterator);
+        }
+
+        entries_.push_front(Entry{key, std::move(value), byte_size});
+        index_.emplace(key, entries_.begin());
+        byte_size_ += byte_size;
+
+        while (byte_size_ > max_byte_size_) {
+            byte_size_ -= entries_.back().byte_size;
+            index_.erase(entries_.back().key);
+            entries_.pop_back();
+            ++stats_.count_evictions;
+        }
+    }
+
+    void Clear() {
+        entries_.clear();
+        index_.clear();
+        byte_size_ = 0;
+        ++stats_.count_invalidations;
+    }
+
+    size_t size() const {
+        return entries_.size();
+    }
+
+    size_t ByteSize() const {
+        return byte_size_;
+    }
+
+    const Stats& GetStats() const {
+        return stats_;
+    }
+private:
+    struct Entry {
+        std::string key;
+        Value value;
+        size_t byte_size;
+    };
+
+    size_t max_byte_size_;
+    size_t byte_size_ = 0;
+    std::list<Entry> entries_;
+    std::unordered_map<std::string, typename std::list<Entry>::iterator> index_;
+    Stats stats_;
+};
@@ -1,6 +1,13 @@
 #include "ParserArgument.hpp"
+#include "SortedOperations.hpp"
+#include "../Indexer/Wildcard.hpp"
 
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <deque>
 #include <iostream>
+#include <stdexcept>
 
 std::unordered_map<size_t, std::unordered_set<char>>
 ParserArgument::WordLeveling(const std::vector<std::string>& words){
@@ -15,8 +22,66 @@ ParserArgument::WordLeveling(const std::vector<std::string>& words){
     return word_level;
 }
 
+std::unordered_map<size_t, std::unordered_set<char>>
+ParserArgument::WildcardLeveling(const std::vector<std::string>& words) {
+    std::unordered_map<size_t, std::unordered_set<char>> word_level;
+
+    for (const std::string& word : words) {
+        size_t literal_size = std::min(word.find(Wildcard::kWildcard), word.size());
+        for (size_t j = 0; j < literal_size; ++j) {
+            word_level[j].insert(word[j]);
+        }
+
+        if (literal_size == word.size()) {
+            continue;
+        }
+        for (size_t j = literal_size; j < Wildcard::kMaxTermLength; ++j) {
+            for (int symbol = CHAR_MIN; symbol <= CHAR_MAX; ++symbol) {
+                word_level[j].insert(static_cast<char>(symbol));
+            }
+        }
+    }
+
+    return word_level;
+}
+
 bool ParserArgument::IsOperation(const std::string& word) {
-    return word == kOperationAND || word == kOperationOR;
+    return word == kOperationAND || word == kOperationOR || IsPositionalOperation(word);
+}
+
+bool ParserArgument::IsPositionalOperation(const std::string& word) {
+    size_t prefix_size = std::char_traits<char>::length(kOperationNEAR);
+    return word == kOperationNEXT || (word.rfind(kOperationNEAR, 0) == 0
+        && (word.size() == prefix_size || word[prefix_size] == '/'));
+}
+
+size_t ParserArgument::NearDistance(const std::string& word) {
+    if (word == kOperationNEXT) {
+        return 1;
+    }
+
+    size_t prefix_size = std::char_traits<char>::length(kOperationNEAR);
+    if (word.size() == prefix_size) {
+        return kDefaultNearDistance;
+    }
+
+    std::string distance = word.substr(prefix_size + 1);
+    if (distance.empty() || !std::all_of(distance.begin(), distance.end(), ::isdigit) || std::stoul(distance) == 0) {
+        throw std::invalid_argument("Invalid expression: bad distance in " + word);
+    }
+
+    return std::stoul(distance);
+}
+
+size_t ParserArgument::Precedence(const std::string& word) {
+    if (word == kOperationOR) {
+        return 1;
+    }
+    if (word == kOperationAND) {
+        return 2;
+    }
+
+    return 3;
 }
 
 void ParserArgument::CreateStackRequest(const std::vector<std::string>& request) {
@@ -25,6 +90,9 @@ void ParserArgument::CreateStackRequest(const std::vector<std::string>& request)
 
     for (const std::string& word : request) {
         if (!IsOperation(word) && word != "(" && word != ")") {
+            if (!current_number.empty()) {
+                throw std::invalid_argument("Invalid expression: missing operator");
+            }
             current_number = word;
             continue;
         }
@@ -49,7 +117,8 @@ void ParserArgument::CreateStackRequest(const std::vector<std::string>& request)
             }
             stack_operators.pop_back();
         } else {
-            while (!stack_operators.empty() && stack_operators.back() != "(" && (word == "OR" || stack_operators.back() == "AND")) {
+            while (!stack_operators.empty() && stack_operators.back() != "("
+                    && Precedence(stack_operators.back()) >= Precedence(word)) {
                 postfix_.push_back(stack_operators.back());
                 stack_operators.pop_back();
             }
@@ -76,30 +145,331 @@ const std::vector<std::string>& ParserArgument::GetPostfix() const {
     return postfix_;
 }
 
-std::unordered_set<size_t> ParserArgument::ExpressionCalculation(
-std::unordered_map<std::string, std::unordered_set<size_t>>& file_words_and_indexes) {
-    std::vector<std::unordered_set<size_t>> result_expression_calculation;
-    std::vector<std::string> word_stack;
+namespace {
+
+std::string NormalizeOperation(const std::string& lhs, const std::string& rhs, const std::string& token) {
+    bool is_commutative = token == ParserArgument::kOperationAND || token == ParserArgument::kOperationOR;
+    if (is_commutative && rhs < lhs) {
+        return rhs + ' ' + lhs + ' ' + token;
+    }
+
+    return lhs + ' ' + rhs + ' ' + token;
+}
+
+}
+
+std::string ParserArgument::GetNormalizedPostfix() const {
+    CheckPostfix();
+
+    std::vector<std::string> operands;
+    for (const std::string& token : postfix_) {
+        if (!IsOperation(token) && token != "(" && token != ")") {
+            operands.push_back(token);
+            continue;
+        }
+
+        std::string rhs = std::move(operands.back());
+        operands.pop_back();
+        operands.back() = NormalizeOperation(operands.back(), rhs, token);
+    }
+
+    return operands.back();
+}
+
+void ParserArgument::CheckPostfix() const {
+    size_t count_operand = 0;
+
+    for (const std::string& token : postfix_) {
+        if (!IsOperation(token) && token != "(" && token != ")") {
+            ++count_operand;
+        } else if (count_operand < 2) {
+            throw std::invalid_argument("Invalid expression: missing operand");
+        } else {
+            --count_operand;
+        }
+    }
+
+    if (count_operand != 1) {
+        throw std::invalid_argument("Invalid expression: missing operator");
+    }
+}
+
+bool ParserArgument::IsDisjunction() const {
+    return std::all_of(postfix_.begin(), postfix_.end(), [](const std::string& token) {
+        return !IsOperation(token) || token == kOperationOR;
+    });
+}
+
+namespace {
+
+class SortedEvaluator {
+public:
+    using List = std::vector<size_t>;
+
+    struct Operand {
+        std::vector<const List*> terms;
+        List* owned = nullptr;
+    };
+
+    Operand Leaf(const List* list) {
+        return Operand{{list}, nullptr};
+    }
+
+    void And(Operand& lhs, Operand& rhs) {
+        rhs.terms.insert(rhs.terms.end(), lhs.terms.begin(), lhs.terms.end());
+        rhs.owned = nullptr;
+    }
+
+    void Or(Operand& lhs, Operand& rhs) {
+        if (rhs.owned == nullptr && lhs.owned != nullptr) {
+            std::swap(lhs, rhs);
+        }
+
+        List* result = Materialize(rhs);
+        SortedOperations::UnionInPlace(*View(lhs), *result);
+        rhs = Operand{{result}, result};
+    }
+
+    List Result(Operand& operand) {
+        if (operand.owned != nullptr) {
+            return std::move(*operand.owned);
+        }
+        return *View(operand);
+    }
+
+    const List* View(Operand& operand) {
+        if (operand.terms.size() == 1) {
+            return operand.terms.front();
+        }
+        return Materialize(operand);
+    }
+private:
+    List* Materialize(Operand& operand) {
+        if (operand.owned != nullptr) {
+            return operand.owned;
+        }
+
+        std::vector<const List*>& terms = operand.terms;
+        std::sort(terms.begin(), terms.end(), [](const List* lhs, const List* rhs) {
+            return lhs->size() < rhs->size();
+        });
+
+        List& result = storage_.emplace_back();
+        if (terms.size() == 1) {
+            result = *terms.front();
+        } else {
+            SortedOperations::Intersect(*terms[0], *terms[1], result);
+            List buffer;
+            for (size_t i = 2; i < terms.size() && !result.empty(); ++i) {
+                SortedOperations::Intersect(result, *terms[i], buffer);
+                result.swap(buffer);
+            }
+        }
+
+        operand = Operand{{&result}, &result};
+        return &result;
+    }
+
+    std::deque<List> storage_;
+};
+
+class PositionalEvaluator {
+public:
+    using List = std::vector<size_t>;
+    using Offsets = std::vector<uint64_t>;
+
+    struct Operand {
+        const std::string* word = nullptr;
+        const List* file_ids = nullptr;
+        const std::vector<Offsets>* offsets = nullptr;
+    };
+
+    explicit PositionalEvaluator(const ParserArgument::PositionsLookup& positions_lookup)
+        : positions_lookup_(positions_lookup)
+    {}
+
+    Operand Leaf(const std::string& word, const List* file_ids) {
+        return Operand{&word, file_ids, nullptr};
+    }
+
+    Operand Match(const Operand& lhs, const Operand& rhs, size_t distance, bool is_ordered) {
+        if (!positions_lookup_) {
+            throw std::invalid_argument("Invalid expression: index has no positions");
+        }
+        if (lhs.file_ids == nullptr || rhs.file_ids == nullptr) {
+            throw std::invalid_argument("Invalid expression: NEAR and phrase operands must be words or phrases");
+        }
+
+        List candidates;
+        SortedOperations::Intersect(*lhs.file_ids, *rhs.file_ids, candidates);
+
+        List& file_ids = file_ids_.emplace_back();
+        std::vector<Offsets>& offsets = offsets_.emplace_back();
+        Offsets matched;
+        for (size_t file_id : candidates) {
+            const Offsets& lhs_offsets = GetOffsets(lhs, file_id, lhs_buffer_);
+            const Offsets& rhs_offsets = GetOffsets(rhs, file_id, rhs_buffer_);
+            ParserArgument::MatchPositions(lhs_offsets, rhs_offsets, distance, is_ordered, matched);
+            if (!matched.empty()) {
+                file_ids.push_back(file_id);
+                offsets.push_back(std::move(matched));
+                matched.clear();
+            }
+        }
+
+        return Operand{nullptr, &file_ids, &offsets};
+    }
+private:
+    const Offsets& GetOffsets(const Operand& operand, size_t file_id, Offsets& buffer) {
+        if (operand.word == nullptr) {
+            auto position = std::lower_bound(operand.file_ids->begin(), operand.file_ids->end(), file_id);
+            return (*operand.offsets)[position - operand.file_ids->begin()];
+        }
+
+        positions_lookup_(*operand.word, file_id, buffer);
+        return buffer;
+    }
+
+    const ParserArgument::PositionsLookup& positions_lookup_;
+    std::deque<List> file_ids_;
+    std::deque<std::vector<Offsets>> offsets_;
+    Offsets lhs_buffer_;
+    Offsets rhs_buffer_;
+};
+
+}
+
+void ParserArgument::MatchPositions(const std::vector<uint64_t>& lhs, const std::vector<uint64_t>& rhs,
+        size_t distance, bool is_ordered, std::vector<uint64_t>& result) {
+    size_t i = 0;
+    for (uint64_t position : rhs) {
+        while (i < lhs.size() && lhs[i] + distance < position) {
+            ++i;
+        }
+        if (i == lhs.size()) {
+            break;
+        }
+
+        if (is_ordered) {
+            if (lhs[i] < position) {
+                result.push_back(position);
+            }
+        } else if (lhs[i] <= position + distance
+                && (lhs[i] != position || (i + 1 < lhs.size() && lhs[i + 1] <= position + distance))) {
+            result.push_back(position);
+        }
+    }
+}
+
+std::vector<size_t> ParserArgument::ExpressionCalculation(
+std::unordered_map<std::string, std::vector<size_t>>& file_words_and_indexes,
+const PositionsLookup& positions_lookup, SubexpressionCache* subexpression_cache) {
+    static const std::vector<size_t> kEmptyList;
+
+    struct SubexpressionKey {
+        std::string key;
+        bool is_pending = false;
+    };
+
+    CheckPostfix();
+
+    SortedEvaluator evaluator;
+    PositionalEvaluator positional_evaluator(positions_lookup);
+    std::vector<SortedEvaluator::Operand> result_expression_calculation;
+    std::vector<PositionalEvaluator::Operand> positional_operands;
+    std::vector<SubexpressionKey> subexpression_keys;
+    std::vector<std::shared_ptr<const std::vector<size_t>>> cached_lists;
+
+    auto store = [&](SubexpressionKey& subexpression_key, SortedEvaluator::Operand& operand) {
+        if (subexpression_key.is_pending) {
+            const std::vector<size_t>* file_ids = evaluator.View(operand);
+            subexpression_cache->Insert(subexpression_key.key, std::make_shared<const std::vector<size_t>>(*file_ids),
+                                        file_ids->size() * sizeof(size_t));
+            subexpression_key.is_pending = false;
+        }
+    };
 
     for (const std::string& token : postfix_) {
         if (!IsOperation(token) && token != "(" && token != ")") {
-            if (file_words_and_indexes.contains(token)) {
-                result_expression_calculation.push_back(file_words_and_indexes[token]);
+            auto it = file_words_and_indexes.find(token);
+            const std::vector<size_t>* file_ids = it == file_words_and_indexes.end() ? &kEmptyList : &it->second;
+            result_expression_calculation.push_back(evaluator.Leaf(file_ids));
+            positional_operands.push_back(positional_evaluator.Leaf(token, file_ids));
+            if (subexpression_cache != nullptr) {
+                subexpression_keys.push_back(SubexpressionKey{token});
             }
+            continue;
+        }
+
+        SubexpressionKey lhs_key;
+        SubexpressionKey rhs_key;
+        if (subexpression_cache != nullptr) {
+            lhs_key = std::move(subexpression_keys.back());
+            subexpression_keys.pop_back();
+            rhs_key = std::move(subexpression_keys.back());
+            subexpression_keys.back() = SubexpressionKey{NormalizeOperation(rhs_key.key, lhs_key.key, token),
+                                                         !IsPositionalOperation(token)};
+        }
+
+        if (IsPositionalOperation(token)) {
+            PositionalEvaluator::Operand lhs = positional_operands[positional_operands.size() - 2];
+            PositionalEvaluator::Operand rhs = positional_operands.back();
+            positional_operands.pop_back();
+            result_expression_calculation.pop_back();
+
+            positional_operands.back() = positional_evaluator.Match(lhs, rhs, NearDistance(token),
+                                                                    token == kOperationNEXT);
+            result_expression_calculation.back() = evaluator.Leaf(positional_operands.back().file_ids);
         } else {
-            std::unordered_set<size_t> lhs = result_expression_calculation.back();
+            SortedEvaluator::Operand lhs = std::move(result_expression_calculation.back());
             result_expression_calculation.pop_back();
-            std::unordered_set<size_t>& rhs = result_expression_calculation.back();
+            SortedEvaluator::Operand& rhs = result_expression_calculation.back();
+            positional_operands.pop_back();
+            positional_operands.back() = PositionalEvaluator::Operand{};
+
+            if (subexpression_cache != nullptr) {
+                auto cached_list = subexpression_cache->Find(subexpression_keys.back().key);
+                if (cached_list != nullptr) {
+                    cached_lists.push_back(*cached_list);
+                    rhs = evaluator.Leaf(cached_lists.back().get());
+                    subexpression_keys.back().is_pending = false;
+                    continue;
+                }
+            }
 
             if (token == kOperationAND) {
-                OperatorAND(lhs, rhs);
+                evaluator.And(lhs, rhs);
             } else if (token == kOperationOR) {
-                OperatorOR(lhs, rhs);
+                if (subexpression_cache != nullptr) {
+                    store(lhs_key, lhs);
+                    store(rhs_key, rhs);
+                }
+                evaluator.Or(lhs, rhs);
+                if (subexpression_cache != nullptr) {
+                    store(subexpression_keys.back(), rhs);
+                }
             }
         }
     }
 
-    return result_expression_calculation.back();
+    if (subexpression_cache != nullptr) {
+        store(subexpression_keys.back(), result_expression_calculation.back());
+    }
+
+    return evaluator.Result(result_expression_calculation.back());
+}
+
+std::unordered_set<size_t> ParserArgument::ExpressionCalculation(
+std::unordered_map<std::string, std::unordered_set<size_t>>& file_words_and_indexes) {
+    std::unordered_map<std::string, std::vector<size_t>> sorted_words_and_indexes;
+    for (const auto& [word, indexes] : file_words_and_indexes) {
+        std::vector<size_t>& sorted_indexes = sorted_words_and_indexes[word];
+        sorted_indexes.assign(indexes.begin(), indexes.end());
+        std::sort(sorted_indexes.begin(), sorted_indexes.end());
+    }
+
+    std::vector<size_t> result = ExpressionCalculation(sorted_words_and_indexes);
+    return std::unordered_set<size_t>(result.begin(), result.end());
 }
 
 void ParserArgument::OperatorAND(
@@ -120,6 +490,16 @@ const std::unordered_set<size_t>& lhs, std::unordered_set<size_t>& rhs) {
     }
 }
 
+void ParserArgument::OperatorAND(const std::vector<size_t>& lhs, std::vector<size_t>& rhs) {
+    std::vector<size_t> result;
+    SortedOperations::Intersect(lhs, rhs, result);
+    rhs.swap(result);
+}
+
+void ParserArgument::OperatorOR(const std::vector<size_t>& lhs, std::vector<size_t>& rhs) {
+    SortedOperations::UnionInPlace(lhs, rhs);
+}
+
 std::vector<std::string> ParserArgument::GetWordsFromExpression(const std::vector<std::string>& expression) {
     std::vector<std::string> result_expression;
 
@@ -6,25 +6,53 @@
 #include <string>
 #include <stack>
 #include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "LruCache.hpp"
 
 class ParserArgument {
 public:
     constexpr static const char* kOperationAND = "AND";
     constexpr static const char* kOperationOR = "OR";
+    constexpr static const char* kOperationNEXT = "NEXT";
+    constexpr static const char* kOperationNEAR = "NEAR";
+    constexpr static const size_t kDefaultNearDistance = 10;
+
+    using PositionsLookup = std::function<void(const std::string& word, size_t file_id,
+                                               std::vector<uint64_t>& offsets)>;
+    using SubexpressionCache = LruCache<std::shared_ptr<const std::vector<size_t>>>;
 
     static std::unordered_map<size_t, std::unordered_set<char>>
     WordLeveling(const std::vector<std::string>& words);
+    static std::unordered_map<size_t, std::unordered_set<char>>
+    WildcardLeveling(const std::vector<std::string>& words);
 
     static std::vector<std::string> GetWordsFromExpression(const std::vector<std::string>& expression);
 
     void CreateStackRequest(const std::vector<std::string>& request);
     static bool IsOperation(const std::string& word);
+    static bool IsPositionalOperation(const std::string& word);
+    static size_t NearDistance(const std::string& word);
+    static size_t Precedence(const std::string& word);
     const std::vector<std::string>& GetPostfix() const;
+    std::string GetNormalizedPostfix() const;
+    void CheckPostfix() const;
+    bool IsDisjunction() const;
     std::unordered_set<size_t> ExpressionCalculation(std::unordered_map<std::string, std::unordered_set<size_t>>&
                                             file_words_and_indexes);
+    std::vector<size_t> ExpressionCalculation(std::unordered_map<std::string, std::vector<size_t>>&
+                                            file_words_and_indexes,
+                                            const PositionsLookup& positions_lookup = nullptr,
+                                            SubexpressionCache* subexpression_cache = nullptr);
 
     void OperatorAND(const std::unordered_set<size_t>& lhs, std::unordered_set<size_t>& rhs);
     void OperatorOR(const std::unordered_set<size_t>& lhs, std::unordered_set<size_t>& rhs);
+    void OperatorAND(const std::vector<size_t>& lhs, std::vector<size_t>& rhs);
+    void OperatorOR(const std::vector<size_t>& lhs, std::vector<size_t>& rhs);
+
+    static void MatchPositions(const std::vector<uint64_t>& lhs, const std::vector<uint64_t>& rhs,
+                               size_t distance, bool is_ordered, std::vector<uint64_t>& result);
 
     void SetPostfix(std::vector<std::string> postfix) {
         std::swap(postfix_, postfix);
@@ -0,0 +1,454 @@
+#include "QueryPlan.hpp"
+#include "SortedOperations.hpp"
+#include "../ThreadPool/ThreadPool.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+QueryPlan::QueryPlan(const ParserArgument& parser_argument,
+                     std::unordered_map<std::string, std::vector<size_t>>& file_words_and_indexes,
+                     const ParserArgument::PositionsLookup& positions_lookup,
+                     ParserArgument::SubexpressionCache* subexpression_cache)
+    : subexpression_cache_(subexpression_cache)
+{
+    parser_argument.CheckPostfix();
+
+    std::vector<Node> operands;
+    for (const std::string& token : parser_argument.GetPostfix()) {
+        if (!ParserArgument::IsOperation(token) && token != "(" && token != ")") {
+            Node& node = operands.emplace_back();
+            node.type = NodeType::kList;
+            node.key = token;
+            if (auto it = file_words_and_indexes.find(token); it != file_words_and_indexes.end()) {
+                node.list = it->second;
+            }
+            continue;
+        }
+
+        Node rhs = std::move(operands.back());
+        operands.pop_back();
+        operands.back() = Combine(std::move(operands.back()), std::move(rhs), token);
+    }
+    root_ = std::move(operands.back());
+
+    ComputeKeys(root_);
+    if (subexpression_cache_ != nullptr) {
+        LookupCache(root_);
+    }
+    MaterializePositional(root_, file_words_and_indexes, positions_lookup);
+    Optimize(root_);
+}
+
+QueryPlan::Node QueryPlan::Combine(Node lhs, Node rhs, const std::string& token) {
+    Node node;
+    if (ParserArgument::IsPositionalOperation(token)) {
+        for (const Node* operand : {&lhs, &rhs}) {
+            if (operand->type != NodeType::kList && operand->type != NodeType::kPositional) {
+                throw std::invalid_argument("Invalid expression: NEAR and phrase operands must be words or phrases");
+            }
+        }
+
+        node.type = NodeType::kPositional;
+        node.key = lhs.key + ' ' + rhs.key + ' ' + token;
+        return node;
+    }
+
+    node.type = token == ParserArgument::kOperationAND ? NodeType::kAnd : NodeType::kOr;
+    for (Node* operand : {&lhs, &rhs}) {
+        if (operand->type == node.type) {
+            std::move(operand->children.begin(), operand->children.end(), std::back_inserter(node.children));
+        } else {
+            node.children.push_back(std::move(*operand));
+        }
+    }
+
+    return node;
+}
+
+void QueryPlan::ComputeKeys(Node& node) {
+    if (node.type != NodeType::kAnd && node.type != NodeType::kOr) {
+        return;
+    }
+
+    std::vector<const std::string*> keys;
+    for (Node& child : node.children) {
+        ComputeKeys(child);
+        keys.push_back(&child.key);
+    }
+    std::sort(keys.begin(), keys.end(), [](const std::string* lhs, const std::string* rhs) {
+        return *lhs < *rhs;
+    });
+
+    const char* operation = node.type == NodeType::kAnd ? ParserArgument::kOperationAND : ParserArgument::kOperationOR;
+    node.key = *keys.front();
+    for (size_t i = 1; i < keys.size(); ++i) {
+        node.key += ' ' + *keys[i] + ' ' + operation;
+    }
+}
+
+void QueryPlan::LookupCache(Node& node) {
+    if (node.type != NodeType::kAnd && node.type != NodeType::kOr) {
+        return;
+    }
+
+    if (auto cached_list = subexpression_cache_->Find(node.key); cached_list != nullptr) {
+        cached_lists_.push_back(*cached_list);
+        node.type = NodeType::kList;
+        node.list = *cached_lists_.back();
+        node.children.clear();
+        return;
+    }
+
+    for (Node& child : node.children) {
+        LookupCache(child);
+    }
+}
+
+void QueryPlan::MaterializePositional(Node& node,
+        std::unordered_map<std::string, std::vector<size_t>>& file_words_and_indexes,
+        const ParserArgument::PositionsLookup& positions_lookup) {
+    if (node.type != NodeType::kPositional) {
+        for (Node& child : node.children) {
+            MaterializePositional(child, file_words_and_indexes, positions_lookup);
+        }
+        return;
+    }
+
+    std::vector<std::string> postfix;
+    for (size_t begin = 0; begin < node.key.size();) {
+        size_t end = std::min(node.key.find(' ', begin), node.key.size());
+        postfix.push_back(node.key.substr(begin, end - begin));
+        begin = end + 1;
+    }
+
+    ParserArgument parser_argument;
+    parser_argument.SetPostfix(std::move(postfix));
+    node.type = NodeType::kList;
+    node.list = materialized_lists_.emplace_back(parser_argument.ExpressionCalculation(file_words_and_indexes,
+                                                                                      positions_lookup));
+}
+
+void QueryPlan::Optimize(Node& node) {
+    if (node.type == NodeType::kList) {
+        node.estimate = node.list.size();
+        return;
+    }
+    if (node.type != NodeType::kAnd && node.type != NodeType::kOr) {
+        node.estimate = 0;
+        return;
+    }
+
+    for (Node& child : node.children) {
+        Optimize(child);
+    }
+
+    if (node.type == NodeType::kAnd) {
+        if (std::any_of(node.children.begin(), node.children.end(), [](const Node& child) {
+                return child.estimate == 0;
+            })) {
+            node.type = NodeType::kEmpty;
+            node.children.clear();
+            node.estimate = 0;
+            return;
+        }
+
+        std::stable_sort(node.children.begin(), node.children.end(), [](const Node& lhs, const Node& rhs) {
+            return lhs.estimate < rhs.estimate;
+        });
+        node.estimate = node.children.front().estimate;
+        return;
+    }
+
+    std::erase_if(node.children, [](const Node& child) {
+        return child.estimate == 0;
+    });
+    if (node.children.empty()) {
+        node.type = NodeType::kEmpty;
+        node.estimate = 0;
+        return;
+    }
+    if (node.children.size() == 1) {
+        Node child = std::move(node.children.front());
+        node = std::move(child);
+        return;
+    }
+
+    node.estimate = 0;
+    for (const Node& child : node.children) {
+        node.estimate += child.estimate;
+    }
+}
+
+void QueryPlan::MaterializeDense(Node& node, bool is_exhaustive,
+        std::deque<std::vector<size_t>>& materialized_lists) {
+    if (node.type == NodeType::kOr) {
+        if (is_exhaustive) {
+            Materialize(node, materialized_lists);
+            return;
+        }
+
+        for (Node& child : node.children) {
+            MaterializeDense(child, false, materialized_lists);
+        }
+    } else if (node.type == NodeType::kAnd) {
+        size_t lead_estimate = node.children.front().estimate;
+        for (Node& child : node.children) {
+            MaterializeDense(child, child.estimate <= kMaterializeRatio * lead_estimate, materialized_lists);
+        }
+
+        std::stable_sort(node.children.begin(), node.children.end(), [](const Node& lhs, const Node& rhs) {
+            return lhs.estimate < rhs.estimate;
+        });
+    }
+}
+
+void QueryPlan::Materialize(Node& node, std::deque<std::vector<size_t>>& materialized_lists) {
+    if (node.type != NodeType::kAnd && node.type != NodeType::kOr) {
+        return;
+    }
+
+    std::vector<size_t>& list = materialized_lists.emplace_back();
+    if (node.type == NodeType::kOr) {
+        std::vector<std::span<const size_t>> lists;
+        for (Node& child : node.children) {
+            Materialize(child, materialized_lists);
+            lists.push_back(child.list);
+        }
+        SortedOperations::Union(std::move(lists), list);
+    } else {
+        MaterializeDense(node, true, materialized_lists);
+        if (std::all_of(node.children.begin(), node.children.end(), [](const Node& child) {
+                return child.type == NodeType::kList;
+            })) {
+            SortedOperations::Intersect(node.children[0].list, node.children[1].list, list);
+            std::vector<size_t> buffer;
+            for (size_t i = 2; i < node.children.size() && !list.empty(); ++i) {
+                SortedOperations::Intersect(list, node.children[i].list, buffer);
+                list.swap(buffer);
+            }
+        } else {
+            list.reserve(node.estimate);
+            Start(node);
+            for (size_t doc = Doc(node); doc != kEnd; doc = Doc(node)) {
+                list.push_back(doc);
+                Next(node);
+            }
+        }
+    }
+
+    node.type = NodeType::kList;
+    node.list = list;
+    node.estimate = list.size();
+    node.children.clear();
+}
+
+QueryPlan::Node QueryPlan::Slice(const Node& node, size_t begin, size_t end) {
+    Node slice;
+    slice.type = node.type;
+    slice.key = node.key;
+    if (node.type == NodeType::kList) {
+        auto first = std::lower_bound(node.list.begin(), node.list.end(), begin);
+        auto last = std::lower_bound(first, node.list.end(), end);
+        slice.list = std::span<const size_t>(first, last);
+    }
+    for (const Node& child : node.children) {
+        slice.children.push_back(Slice(child, begin, end));
+    }
+
+    return slice;
+}
+
+std::vector<size_t> QueryPlan::PartitionBounds(const Node& node, size_t count_ranges) {
+    std::span<const size_t> longest_list;
+    std::vector<const Node*> stack = {&node};
+    while (!stack.empty()) {
+        const Node* current = stack.back();
+        stack.pop_back();
+        if (current->list.size() > longest_list.size()) {
+            longest_list = current->list;
+        }
+        for (const Node& child : current->children) {
+            stack.push_back(&child);
+        }
+    }
+
+    std::vector<size_t> bounds = {0};
+    for (size_t i = 1; i < count_ranges; ++i) {
+        size_t bound = longest_list[i * longest_list.size() / count_ranges];
+        if (bound > bounds.back()) {
+            bounds.push_back(bound);
+        }
+    }
+    bounds.push_back(kEnd);
+
+    return bounds;
+}
+
+std::vector<size_t> QueryPlan::Execute(ThreadPool* thread_pool) {
+    bool is_cacheable = root_.type == NodeType::kAnd || root_.type == NodeType::kOr;
+    std::vector<size_t> result;
+    if (thread_pool != nullptr && thread_pool->Size() > 1 && is_cacheable && root_.estimate >= kMinParallelEstimate) {
+        std::vector<size_t> bounds = PartitionBounds(root_, thread_pool->Size());
+        std::vector<std::vector<size_t>> range_results(bounds.size() - 1);
+        thread_pool->ParallelFor(range_results.size(), [this, &bounds, &range_results](size_t range) {
+            Node node = Slice(root_, bounds[range], bounds[range + 1]);
+            Optimize(node);
+            std::deque<std::vector<size_t>> materialized_lists;
+            Materialize(node, materialized_lists);
+            range_results[range].assign(node.list.begin(), node.list.end());
+        });
+
+        size_t count_documents = 0;
+        for (const std::vector<size_t>& range_result : range_results) {
+            count_documents += range_result.size();
+        }
+        result.reserve(count_documents);
+        for (const std::vector<size_t>& range_result : range_results) {
+            result.insert(result.end(), range_result.begin(), range_result.end());
+        }
+    } else {
+        Materialize(root_, materialized_lists_);
+        result.assign(root_.list.begin(), root_.list.end());
+    }
+
+    if (subexpression_cache_ != nullptr && is_cacheable) {
+        subexpression_cache_->Insert(root_.key, std::make_shared<const std::vector<size_t>>(result),
+                                     result.size() * sizeof(size_t));
+    }
+
+    return result;
+}
+
+std::string QueryPlan::Explain() const {
+    std::string result;
+    Explain(root_, result);
+
+    return result;
+}
+
+const QueryPlan::Node& QueryPlan::Root() const {
+    return root_;
+}
+
+size_t QueryPlan::Doc(const Node& node) {
+    switch (node.type) {
+        case NodeType::kList:
+            return node.position < node.list.size() ? node.list[node.position] : kEnd;
+        case NodeType::kAnd:
+        case NodeType::kOr:
+            return node.doc;
+        default:
+            return kEnd;
+    }
+}
+
+void QueryPlan::Start(Node& node) {
+    node.position = 0;
+    for (Node& child : node.children) {
+        Start(child);
+    }
+
+    if (node.type == NodeType::kAnd) {
+        AlignAnd(node);
+    } else if (node.type == NodeType::kOr) {
+        UpdateOr(node);
+    }
+}
+
+void QueryPlan::Next(Node& node) {
+    if (node.type == NodeType::kList) {
+        ++node.position;
+    } else if (node.type == NodeType::kAnd) {
+        Next(node.children.front());
+        AlignAnd(node);
+    } else if (node.type == NodeType::kOr) {
+        for (Node& child : node.children) {
+            if (Doc(child) == node.doc) {
+                Next(child);
+            }
+        }
+        UpdateOr(node);
+    }
+}
+
+void QueryPlan::Advance(Node& node, size_t target) {
+    if (Doc(node) >= target) {
+        return;
+    }
+
+    if (node.type == NodeType::kList) {
+        size_t begin = node.position;
+        size_t step = 1;
+        while (begin + step < node.list.size() && node.list[begin + step] < target) {
+            begin += step;
+            step *= 2;
+        }
+
+        size_t end = std::min(begin + step + 1, node.list.size());
+        node.position = std::lower_bound(node.list.begin() + begin, node.list.begin() + end, target)
+                        - node.list.begin();
+    } else if (node.type == NodeType::kAnd) {
+        Advance(node.children.front(), target);
+        AlignAnd(node);
+    } else if (node.type == NodeType::kOr) {
+        for (Node& child : node.children) {
+            Advance(child, target);
+        }
+        UpdateOr(node);
+    }
+}
+
+void QueryPlan::AlignAnd(Node& node) {
+    size_t doc = Doc(node.children.front());
+    while (doc != kEnd) {
+        bool is_aligned = true;
+        for (size_t i = 1; i < node.children.size(); ++i) {
+            Advance(node.children[i], doc);
+            if (size_t child_doc = Doc(node.children[i]); child_doc != doc) {
+                doc = child_doc;
+                is_aligned = false;
+                break;
+            }
+        }
+
+        if (is_aligned || doc == kEnd) {
+            break;
+        }
+        Advance(node.children.front(), doc);
+        doc = Doc(node.children.front());
+    }
+
+    node.doc = doc;
+}
+
+void QueryPlan::UpdateOr(Node& node) {
+    node.doc = kEnd;
+    for (const Node& child : node.children) {
+        node.doc = std::min(node.doc, Doc(child));
+    }
+}
+
+void QueryPlan::Explain(const Node& node, std::string& result) {
+    switch (node.type) {
+        case NodeType::kEmpty:
+            result += "EMPTY";
+            return;
+        case NodeType::kList:
+        case NodeType::kPositional:
+            result += node.key + '[' + std::to_string(node.estimate) + ']';
+            return;
+        default:
+            break;
+    }
+
+    result += node.type == NodeType::kAnd ? ParserArgument::kOperationAND : ParserArgument::kOperationOR;
+    result += '(';
+    for (size_t i = 0; i < node.children.size(); ++i) {
+        if (i != 0) {
+            result += ", ";
+        }
+        Explain(node.children[i], result);
+    }
+    result += ')';
+}
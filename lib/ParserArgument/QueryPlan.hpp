@@ -0,0 +1,74 @@
+#pragma once
+
+#include <deque>
+#include <limits>
+#include <memory>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ParserArgument.hpp"
+
+class ThreadPool;
+
+class QueryPlan {
+public:
+    constexpr static const size_t kEnd = std::numeric_limits<size_t>::max();
+    constexpr static const size_t kMaterializeRatio = 16;
+    constexpr static const size_t kMinParallelEstimate = 1 << 16;
+
+    enum class NodeType {
+        kEmpty,
+        kList,
+        kPositional,
+        kAnd,
+        kOr
+    };
+
+    struct Node {
+        NodeType type = NodeType::kEmpty;
+        std::string key;
+        std::span<const size_t> list;
+        size_t position = 0;
+        size_t doc = 0;
+        size_t estimate = 0;
+        std::vector<Node> children;
+    };
+
+    QueryPlan(const ParserArgument& parser_argument,
+              std::unordered_map<std::string, std::vector<size_t>>& file_words_and_indexes,
+              const ParserArgument::PositionsLookup& positions_lookup = nullptr,
+              ParserArgument::SubexpressionCache* subexpression_cache = nullptr);
+
+    std::vector<size_t> Execute(ThreadPool* thread_pool = nullptr);
+    std::string Explain() const;
+    const Node& Root() const;
+private:
+    static Node Combine(Node lhs, Node rhs, const std::string& token);
+    static void ComputeKeys(Node& node);
+    static void Optimize(Node& node);
+
+    static Node Slice(const Node& node, size_t begin, size_t end);
+    static std::vector<size_t> PartitionBounds(const Node& node, size_t count_ranges);
+    static void MaterializeDense(Node& node, bool is_exhaustive, std::deque<std::vector<size_t>>& materialized_lists);
+    static void Materialize(Node& node, std::deque<std::vector<size_t>>& materialized_lists);
+
+    void LookupCache(Node& node);
+    void MaterializePositional(Node& node,
+                               std::unordered_map<std::string, std::vector<size_t>>& file_words_and_indexes,
+                               const ParserArgument::PositionsLookup& positions_lookup);
+
+    static size_t Doc(const Node& node);
+    static void Start(Node& node);
+    static void Next(Node& node);
+    static void Advance(Node& node, size_t target);
+    static void AlignAnd(Node& node);
+    static void UpdateOr(Node& node);
+    static void Explain(const Node& node, std::string& result);
+
+    Node root_;
+    ParserArgument::SubexpressionCache* subexpression_cache_;
+    std::deque<std::vector<size_t>> materialized_lists_;
+    std::vector<std::shared_ptr<const std::vector<size_t>>> cached_lists_;
+};
@@ -0,0 +1,215 @@
+#include "SortedOperations.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SEARCH_ENGINE_HAS_AVX2_KERNEL 1
+#endif
+
+namespace {
+
+size_t IntersectMergeTail(const size_t* lhs, size_t lhs_size, const size_t* rhs, size_t rhs_size,
+        size_t* result) {
+    size_t i = 0;
+    size_t j = 0;
+    size_t count = 0;
+
+    while (i < lhs_size && j < rhs_size) {
+        if (lhs[i] < rhs[j]) {
+            ++i;
+        } else if (rhs[j] < lhs[i]) {
+            ++j;
+        } else {
+            result[count++] = lhs[i];
+            ++i;
+            ++j;
+        }
+    }
+
+    return count;
+}
+
+#ifdef SEARCH_ENGINE_HAS_AVX2_KERNEL
+__attribute__((target("avx2")))
+size_t IntersectAvx2(const size_t* lhs, size_t lhs_size, const size_t* rhs, size_t rhs_size, size_t* result) {
+    static_assert(sizeof(size_t) == sizeof(long long));
+
+    size_t i = 0;
+    size_t j = 0;
+    size_t count = 0;
+
+    while (i + 4 <= lhs_size && j + 4 <= rhs_size) {
+        __m256i lhs_block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lhs + i));
+        __m256i rhs_block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rhs + j));
+
+        __m256i equal = _mm256_cmpeq_epi64(lhs_block, rhs_block);
+        equal = _mm256_or_si256(equal, _mm256_cmpeq_epi64(lhs_block,
+            _mm256_permute4x64_epi64(rhs_block, _MM_SHUFFLE(0, 3, 2, 1))));
+        equal = _mm256_or_si256(equal, _mm256_cmpeq_epi64(lhs_block,
+            _mm256_permute4x64_epi64(rhs_block, _MM_SHUFFLE(1, 0, 3, 2))));
+        equal = _mm256_or_si256(equal, _mm256_cmpeq_epi64(lhs_block,
+            _mm256_permute4x64_epi64(rhs_block, _MM_SHUFFLE(2, 1, 0, 3))));
+
+        int mask = _mm256_movemask_pd(_mm256_castsi256_pd(equal));
+        while (mask != 0) {
+            result[count++] = lhs[i + __builtin_ctz(mask)];
+            mask &= mask - 1;
+        }
+
+        size_t lhs_max = lhs[i + 3];
+        size_t rhs_max = rhs[j + 3];
+        if (lhs_max <= rhs_max) {
+            i += 4;
+        }
+        if (rhs_max <= lhs_max) {
+            j += 4;
+        }
+    }
+
+    return count + IntersectMergeTail(lhs + i, lhs_size - i, rhs + j, rhs_size - j, result + count);
+}
+#endif
+
+}
+
+bool SortedOperations::IsSimdAvailable() {
+#ifdef SEARCH_ENGINE_HAS_AVX2_KERNEL
+    static const bool is_available = __builtin_cpu_supports("avx2");
+    return is_available;
+#else
+    return false;
+#endif
+}
+
+void SortedOperations::IntersectMerge(std::span<const size_t> lhs, std::span<const size_t> rhs,
+        std::vector<size_t>& result) {
+    result.resize(std::min(lhs.size(), rhs.size()));
+    result.resize(IntersectMergeTail(lhs.data(), lhs.size(), rhs.data(), rhs.size(), result.data()));
+}
+
+void SortedOperations::IntersectGalloping(std::span<const size_t> small, std::span<const size_t> large,
+        std::vector<size_t>& result) {
+    result.clear();
+    auto position = large.begin();
+
+    for (size_t value : small) {
+        size_t step = 1;
+        auto bound = position;
+        while (bound != large.end() && *bound < value) {
+            position = bound;
+            if (static_cast<size_t>(large.end() - bound) <= step) {
+                bound = large.end();
+                break;
+            }
+            bound += step;
+            step *= 2;
+        }
+
+        position = std::lower_bound(position, bound, value);
+        if (position == large.end()) {
+            break;
+        }
+        if (*position == value) {
+            result.push_back(value);
+            ++position;
+        }
+    }
+}
+
+void SortedOperations::IntersectSimd(std::span<const size_t> lhs, std::span<const size_t> rhs,
+        std::vector<size_t>& result) {
+#ifdef SEARCH_ENGINE_HAS_AVX2_KERNEL
+    if (IsSimdAvailable()) {
+        result.resize(std::min(lhs.size(), rhs.size()));
+        result.resize(IntersectAvx2(lhs.data(), lhs.size(), rhs.data(), rhs.size(), result.data()));
+        return;
+    }
+#endif
+    IntersectMerge(lhs, rhs, result);
+}
+
+void SortedOperations::Intersect(std::span<const size_t> lhs, std::span<const size_t> rhs,
+        std::vector<size_t>& result) {
+    std::span<const size_t> small = lhs.size() <= rhs.size() ? lhs : rhs;
+    std::span<const size_t> large = lhs.size() <= rhs.size() ? rhs : lhs;
+
+    if (small.empty()) {
+        result.clear();
+    } else if (large.size() / small.size() >= kGallopingRatio) {
+        IntersectGalloping(small, large, result);
+    } else {
+        IntersectSimd(small, large, result);
+    }
+}
+
+void SortedOperations::UnionInPlace(const std::vector<size_t>& lhs, std::vector<size_t>& rhs) {
+    size_t middle = rhs.size();
+    rhs.insert(rhs.end(), lhs.begin(), lhs.end());
+    std::inplace_merge(rhs.begin(), rhs.begin() + middle, rhs.end());
+    rhs.erase(std::unique(rhs.begin(), rhs.end()), rhs.end());
+}
+
+void SortedOperations::Union(std::vector<std::span<const size_t>> lists, std::vector<size_t>& result) {
+    if (lists.size() > kMaxPairwiseUnion) {
+        UnionMany(lists, result);
+        return;
+    }
+
+    std::sort(lists.begin(), lists.end(), [](std::span<const size_t> lhs, std::span<const size_t> rhs) {
+        return lhs.size() < rhs.size();
+    });
+
+    result.clear();
+    std::vector<size_t> buffer;
+    for (std::span<const size_t> list : lists) {
+        buffer.resize(result.size() + list.size());
+        buffer.resize(std::set_union(result.begin(), result.end(), list.begin(), list.end(), buffer.begin())
+                      - buffer.begin());
+        result.swap(buffer);
+    }
+}
+
+void SortedOperations::UnionMany(const std::vector<std::span<const size_t>>& lists, std::vector<size_t>& result,
+        const std::vector<std::span<const size_t>>* weights, std::vector<size_t>* result_weights) {
+    using HeapEntry = std::pair<size_t, size_t>;
+    std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry>> heap;
+    std::vector<size_t> positions(lists.size(), 0);
+
+    size_t total_size = 0;
+    for (size_t i = 0; i < lists.size(); ++i) {
+        total_size += lists[i].size();
+        if (!lists[i].empty()) {
+            heap.emplace(lists[i].front(), i);
+        }
+    }
+
+    result.clear();
+    result.reserve(total_size);
+    if (result_weights != nullptr) {
+        result_weights->clear();
+        result_weights->reserve(total_size);
+    }
+
+    while (!heap.empty()) {
+        auto [value, list] = heap.top();
+        heap.pop();
+
+        size_t weight = weights != nullptr ? (*weights)[list][positions[list]] : 0;
+        if (result.empty() || result.back() != value) {
+            result.push_back(value);
+            if (result_weights != nullptr) {
+                result_weights->push_back(weight);
+            }
+        } else if (result_weights != nullptr) {
+            result_weights->back() += weight;
+        }
+
+        if (++positions[list] < lists[list].size()) {
+            heap.emplace(lists[list][positions[list]], list);
+        }
+    }
+}
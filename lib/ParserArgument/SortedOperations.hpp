@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+struct SortedOperations {
+    constexpr static const size_t kGallopingRatio = 32;
+
+    constexpr static const size_t kMaxPairwiseUnion = 8;
+
+    static void Intersect(std::span<const size_t> lhs, std::span<const size_t> rhs, std::vector<size_t>& result);
+    static void IntersectMerge(std::span<const size_t> lhs, std::span<const size_t> rhs,
+                               std::vector<size_t>& result);
+    static void IntersectGalloping(std::span<const size_t> small, std::span<const size_t> large,
+                                   std::vector<size_t>& result);
+    static void IntersectSimd(std::span<const size_t> lhs, std::span<const size_t> rhs,
+                              std::vector<size_t>& result);
+
+    static void UnionInPlace(const std::vector<size_t>& lhs, std::vector<size_t>& rhs);
+    static void Union(std::vector<std::span<const size_t>> lists, std::vector<size_t>& result);
+    static void UnionMany(const std::vector<std::span<const size_t>>& lists, std::vector<size_t>& result,
+                          const std::vector<std::span<const size_t>>* weights = nullptr,
+                          std::vector<size_t>* result_weights = nullptr);
+
+    static bool IsSimdAvailable();
+};
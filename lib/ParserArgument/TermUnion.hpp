@@ -0,0 +1,110 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "SortedOperations.hpp"
+
+template<typename Iterator>
+class TermUnion {
+public:
+    TermUnion() = default;
+
+    explicit TermUnion(std::vector<Iterator> terms, std::vector<double> weights = {})
+        : terms_(std::move(terms))
+        , weights_(std::move(weights))
+    {}
+
+    bool empty() const {
+        return terms_.empty();
+    }
+
+    bool IsExpanded() const {
+        return terms_.size() > 1;
+    }
+
+    bool IsWeighted() const {
+        return !weights_.empty();
+    }
+
+    size_t CountTerms() const {
+        return terms_.size();
+    }
+
+    const Iterator& Term(size_t index) const {
+        return terms_[index];
+    }
+
+    double Weight(size_t index) const {
+        return weights_.empty() ? 1.0 : weights_[index];
+    }
+
+    void GetPostings(std::vector<size_t>& file_ids, std::vector<size_t>* frequencies) const {
+        if (terms_.size() == 1) {
+            const auto& sorted_keys = terms_.front().GetSortedKeys();
+            file_ids.assign(sorted_keys.begin(), sorted_keys.end());
+            if (frequencies != nullptr) {
+                const auto& sorted_frequencies = terms_.front().GetSortedFrequencies();
+                frequencies->assign(sorted_frequencies.begin(), sorted_frequencies.end());
+            }
+            return;
+        }
+
+        std::vector<std::vector<size_t>> owned_lists;
+        owned_lists.reserve(terms_.size() * 2);
+        std::vector<std::span<const size_t>> keys;
+        std::vector<std::span<const size_t>> weights;
+        for (const Iterator& term : terms_) {
+            keys.push_back(Span(term.GetSortedKeys(), owned_lists));
+            if (frequencies != nullptr) {
+                weights.push_back(Span(term.GetSortedFrequencies(), owned_lists));
+            }
+        }
+
+        SortedOperations::UnionMany(keys, file_ids, frequencies != nullptr ? &weights : nullptr, frequencies);
+    }
+
+    void GetPositions(size_t index, std::vector<uint64_t>& positions) const {
+        positions.clear();
+        for (const Iterator& term : terms_) {
+            if (term.size(index) == 0) {
+                continue;
+            }
+
+            for (auto it = term.GetStartArray(index); it != term.GetEndArray(index); ++it) {
+                positions.push_back(*it);
+            }
+        }
+
+        if (IsExpanded()) {
+            std::sort(positions.begin(), positions.end());
+        }
+    }
+
+    size_t size(size_t index) const {
+        size_t count = 0;
+        for (const Iterator& term : terms_) {
+            count += term.size(index);
+        }
+
+        return count;
+    }
+
+    double MaxScore() const requires requires(const Iterator& term) { term.MaxScore(); } {
+        return terms_.empty() ? 0.0 : terms_.front().MaxScore();
+    }
+private:
+    static std::span<const size_t> Span(const std::vector<size_t>& list, std::vector<std::vector<size_t>>&) {
+        return list;
+    }
+
+    static std::span<const size_t> Span(std::vector<size_t>&& list, std::vector<std::vector<size_t>>& owned_lists) {
+        owned_lists.push_back(std::move(list));
+        return owned_lists.back();
+    }
+
+    std::vector<Iterator> terms_;
+    std::vector<double> weights_;
+};
@@ -1,10 +1,61 @@
 #include "Searcher.hpp"
+#include "../ParserArgument/ParserArgument.hpp"
 
 #include <memory>
 #include <cmath>
 #include <sstream>
+#include <stdexcept>
 #include <fstream>
 #include <algorithm>
+#include <limits>
+#include <queue>
+#include <string_view>
+#include <unordered_set>
+
+#include "../ThreadPool/ThreadPool.hpp"
+
+namespace {
+
+size_t GallopTo(std::span<const size_t> list, size_t position, size_t value) {
+    size_t step = 1;
+    size_t bound = position;
+    while (bound < list.size() && list[bound] < value) {
+        position = bound + 1;
+        bound += step;
+        step *= 2;
+    }
+
+    bound = std::min(bound, list.size());
+    return std::lower_bound(list.begin() + position, list.begin() + bound, value) - list.begin();
+}
+
+struct TermCursor {
+    const TermPostings* term;
+    size_t term_index;
+    size_t position;
+    size_t end;
+    double upper_bound;
+
+    size_t FileId() const {
+        return term->file_ids[position];
+    }
+
+    bool IsEnd() const {
+        return position >= end;
+    }
+
+    void Seek(size_t file_id) {
+        position = GallopTo(term->file_ids, position, file_id);
+    }
+};
+
+struct BetterResult {
+    bool operator()(const std::pair<size_t, double>& lhs, const std::pair<size_t, double>& rhs) const {
+        return lhs.second > rhs.second || (lhs.second == rhs.second && lhs.first < rhs.first);
+    }
+};
+
+}
 
 Searcher::Searcher(const std::vector<std::string>& request)
     : request_(std::move(request))
@@ -17,6 +68,24 @@ Searcher::Searcher(const std::vector<std::string>& request)
     count_documents_ = request.size();
 }
 
+Searcher::Searcher(const std::vector<std::string>& request,
+        std::unordered_map<std::string, size_t> count_word_in_file,
+        double average_length_of_documents,
+        size_t count_documents)
+    : request_(request)
+    , count_word_in_file(std::move(count_word_in_file))
+    , average_length_of_documents_(average_length_of_documents)
+    , count_documents_(count_documents)
+{
+    if (average_length_of_documents_ == 0) {
+        average_length_of_documents_ = 1;
+    }
+}
+
+Searcher::Searcher(double average_length_of_documents, size_t count_documents)
+    : Searcher({}, {}, average_length_of_documents, count_documents)
+{}
+
 double BM25::calculationIDF(size_t number_of_documents, size_t document_frequency) {
     return std::log((number_of_documents - document_frequency + 0.5) / (document_frequency + 0.5));
 }
@@ -35,6 +104,35 @@ std::vector<std::string> Searcher::TokenizeExpression(const std::string& express
     std::vector<std::string> tokens;
     std::stringstream ss(expression);
     std::string token;
+    bool is_phrase = false;
+    bool is_phrase_empty = true;
+
+    auto push_word = [&tokens, &is_phrase, &is_phrase_empty](std::string word) {
+        if (!is_phrase && !word.empty() && word.front() == '"') {
+            word.erase(word.begin());
+            tokens.push_back("(");
+            is_phrase = true;
+            is_phrase_empty = true;
+        }
+
+        bool is_phrase_end = is_phrase && !word.empty() && word.back() == '"';
+        if (is_phrase_end) {
+            word.pop_back();
+        }
+
+        if (!word.empty()) {
+            if (is_phrase && !is_phrase_empty) {
+                tokens.push_back(ParserArgument::kOperationNEXT);
+            }
+            tokens.push_back(word);
+            is_phrase_empty = false;
+        }
+
+        if (is_phrase_end) {
+            tokens.push_back(")");
+            is_phrase = false;
+        }
+    };
         
     while (ss >> token) {
         if (token[0] == '(') {
@@ -42,7 +140,7 @@ std::vector<std::string> Searcher::TokenizeExpression(const std::string& express
                 token.erase(token.begin());
                 tokens.push_back("(");
             }
-            tokens.push_back(token);
+            push_word(token);
         } else if (token[token.size() - 1] == ')') {
             size_t count = 0;
             while (token.size() != 0 && token[token.size() - 1] == ')') {
@@ -50,16 +148,20 @@ std::vector<std::string> Searcher::TokenizeExpression(const std::string& express
                 ++count;
             }
 
-            tokens.push_back(token);
+            push_word(token);
             
             for (size_t i = 0; i < count; ++i) {
                 tokens.push_back(")");
             }
         } else {
-            tokens.push_back(token);
+            push_word(token);
         }
         
     }
+
+    if (is_phrase) {
+        throw std::invalid_argument("Invalid expression: unterminated phrase");
+    }
         
     return tokens;
 }
@@ -80,42 +182,246 @@ size_t Searcher::GetWordCount(const std::string& filename) {
     return wordCount;
 }
 
-std::vector<std::pair<std::string, double>> Searcher::GetBM25(
-    const std::unordered_map<std::string, std::unordered_map<std::string, size_t>>& data_word) {
-    std::unordered_map<std::string, double> bm25_file;
+double BM25::FuzzyWeight(size_t edit_distance) {
+    return std::pow(kFuzzyPenalty, static_cast<double>(edit_distance));
+}
 
-    for (const auto& name_word : data_word) {
-        size_t document_frequency = 0;
-        std::unordered_map<std::string, size_t> word_frequency_in_document;
+std::vector<std::pair<std::string, double>> Searcher::GetBM25(
+    const std::unordered_map<std::string, std::unordered_map<std::string, size_t>>& data_word,
+    const std::unordered_map<std::string, double>& word_weights,
+    ThreadPool* thread_pool) {
+    if (data_word.empty()) {
+        return {};
+    }
 
-        for (const auto& name_file : name_word.second) {
-            if (std::find(request_.begin(), request_.end(), name_file.first) != request_.end()) {
-                document_frequency += name_file.second;
-                word_frequency_in_document[name_file.first] = name_file.second;
-            }
+    std::vector<const std::string*> documents;
+    std::unordered_set<std::string_view> seen_documents;
+    for (const std::string& document : request_) {
+        if (seen_documents.insert(document).second) {
+            documents.push_back(&document);
         }
+    }
 
-        for (const auto& word : request_) {
-            size_t word_freq_in_doc = word_frequency_in_document.count(word) ? word_frequency_in_document[word] : 0;
-            bm25_file[word] += BM25::calculation(
-                count_documents_,
-                document_frequency,
-                word_freq_in_doc,
-                count_word_in_file[word],
-                average_length_of_documents_
-            );
-        }
+    std::vector<size_t> document_lengths;
+    for (const std::string* document : documents) {
+        auto document_length = count_word_in_file.find(*document);
+        document_lengths.push_back(document_length == count_word_in_file.end() ? 0 : document_length->second);
     }
 
+    std::vector<double> scores(documents.size(), 0);
+    size_t count_ranges = documents.size() * data_word.size() >= kMinParallelScores && thread_pool != nullptr
+                          ? std::min(thread_pool->Size(), documents.size()) : 1;
+    ParallelFor(thread_pool, count_ranges, [&](size_t range) {
+        size_t begin = range * documents.size() / count_ranges;
+        size_t end = (range + 1) * documents.size() / count_ranges;
+        for (const auto& [word, postings] : data_word) {
+            auto word_weight = word_weights.find(word);
+            double weight = word_weight == word_weights.end() ? 1.0 : word_weight->second;
+            for (size_t i = begin; i < end; ++i) {
+                auto posting = postings.find(*documents[i]);
+                scores[i] += weight * BM25::calculation(
+                    count_documents_,
+                    postings.size(),
+                    posting == postings.end() ? 0 : posting->second,
+                    document_lengths[i],
+                    average_length_of_documents_
+                );
+            }
+        }
+    });
+
     std::vector<std::pair<std::string, double>> result;
-    for (const auto& u : bm25_file) {
-        result.emplace_back(u.first, u.second);
+    result.reserve(documents.size());
+    for (size_t i = 0; i < documents.size(); ++i) {
+        result.emplace_back(*documents[i], scores[i]);
     }
 
     std::sort(result.begin(), result.end(),
     [](const std::pair<std::string, double>& lhs, const std::pair<std::string, double>& rhs) {
-        return lhs.second > rhs.second;
+        return lhs.second > rhs.second || (lhs.second == rhs.second && lhs.first < rhs.first);
     });
 
     return result;
 }
+
+double Searcher::GetMaxScore(std::span<const size_t> file_ids, std::span<const size_t> frequencies,
+        const std::function<size_t(size_t)>& document_length) const {
+    double max_score = -std::numeric_limits<double>::infinity();
+    for (size_t i = 0; i < file_ids.size(); ++i) {
+        max_score = std::max(max_score, BM25::calculation(
+            count_documents_,
+            file_ids.size(),
+            frequencies[i],
+            document_length(file_ids[i]),
+            average_length_of_documents_
+        ));
+    }
+
+    return max_score;
+}
+
+std::vector<std::pair<size_t, double>> Searcher::GetTopBM25(const std::vector<TermPostings>& terms,
+        const std::function<size_t(size_t)>& document_length,
+        size_t count_top,
+        const std::vector<size_t>* filter,
+        ThreadPool* thread_pool) {
+    std::span<const size_t> longest_file_ids;
+    size_t count_postings = 0;
+    for (const TermPostings& term : terms) {
+        count_postings += term.file_ids.size();
+        if (term.file_ids.size() > longest_file_ids.size()) {
+            longest_file_ids = term.file_ids;
+        }
+    }
+
+    if (thread_pool == nullptr || thread_pool->Size() <= 1 || count_postings < kMinParallelPostings) {
+        return GetTopBM25InRange(terms, document_length, count_top, filter, 0, std::numeric_limits<size_t>::max(),
+                                 count_scored_documents_);
+    }
+
+    std::vector<size_t> bounds = {0};
+    for (size_t i = 1; i < thread_pool->Size(); ++i) {
+        size_t bound = longest_file_ids[i * longest_file_ids.size() / thread_pool->Size()];
+        if (bound > bounds.back()) {
+            bounds.push_back(bound);
+        }
+    }
+    bounds.push_back(std::numeric_limits<size_t>::max());
+
+    std::vector<std::vector<std::pair<size_t, double>>> range_results(bounds.size() - 1);
+    std::vector<size_t> range_count_scored(range_results.size(), 0);
+    thread_pool->ParallelFor(range_results.size(), [&](size_t range) {
+        range_results[range] = GetTopBM25InRange(terms, document_length, count_top, filter, bounds[range],
+                                                 bounds[range + 1], range_count_scored[range]);
+    });
+
+    std::vector<std::pair<size_t, double>> result;
+    for (size_t range = 0; range < range_results.size(); ++range) {
+        result.insert(result.end(), range_results[range].begin(), range_results[range].end());
+        count_scored_documents_ += range_count_scored[range];
+    }
+    std::sort(result.begin(), result.end(), BetterResult());
+    result.resize(std::min(result.size(), count_top));
+
+    return result;
+}
+
+std::vector<std::pair<size_t, double>> Searcher::GetTopBM25InRange(const std::vector<TermPostings>& terms,
+        const std::function<size_t(size_t)>& document_length,
+        size_t count_top,
+        const std::vector<size_t>* filter,
+        size_t begin_file_id,
+        size_t end_file_id,
+        size_t& count_scored_documents) const {
+    std::vector<TermCursor> cursors;
+    for (size_t i = 0; i < terms.size(); ++i) {
+        size_t begin = std::lower_bound(terms[i].file_ids.begin(), terms[i].file_ids.end(), begin_file_id)
+                       - terms[i].file_ids.begin();
+        size_t end = std::lower_bound(terms[i].file_ids.begin() + begin, terms[i].file_ids.end(), end_file_id)
+                     - terms[i].file_ids.begin();
+        if (begin != end) {
+            double upper_bound = std::max(0.0, terms[i].weight * terms[i].max_score);
+            cursors.push_back(TermCursor{&terms[i], i, begin, end, upper_bound + upper_bound * kUpperBoundSlack});
+        }
+    }
+
+    std::priority_queue<std::pair<size_t, double>, std::vector<std::pair<size_t, double>>, BetterResult> top;
+    std::vector<std::pair<size_t, double>> contributions;
+    size_t filter_position = 0;
+
+    while (count_top != 0) {
+        cursors.erase(std::remove_if(cursors.begin(), cursors.end(), [](const TermCursor& cursor) {
+            return cursor.IsEnd();
+        }), cursors.end());
+        if (cursors.empty()) {
+            break;
+        }
+
+        std::sort(cursors.begin(), cursors.end(), [](const TermCursor& lhs, const TermCursor& rhs) {
+            return lhs.FileId() < rhs.FileId();
+        });
+
+        double threshold = top.size() < count_top ? -std::numeric_limits<double>::infinity() : top.top().second;
+        double bound = 0;
+        size_t pivot = cursors.size();
+        for (size_t i = 0; i < cursors.size(); ++i) {
+            bound += cursors[i].upper_bound;
+            if (bound > threshold) {
+                pivot = i;
+                break;
+            }
+        }
+        if (pivot == cursors.size()) {
+            break;
+        }
+
+        size_t pivot_file_id = cursors[pivot].FileId();
+        if (filter != nullptr) {
+            filter_position = GallopTo(*filter, filter_position, pivot_file_id);
+            if (filter_position == filter->size()) {
+                break;
+            }
+
+            size_t allowed_file_id = (*filter)[filter_position];
+            if (allowed_file_id != pivot_file_id) {
+                for (TermCursor& cursor : cursors) {
+                    if (cursor.FileId() < allowed_file_id) {
+                        cursor.Seek(allowed_file_id);
+                    }
+                }
+                continue;
+            }
+        }
+
+        if (cursors.front().FileId() != pivot_file_id) {
+            for (size_t i = 0; i < pivot; ++i) {
+                cursors[i].Seek(pivot_file_id);
+            }
+            continue;
+        }
+
+        size_t length = document_length(pivot_file_id);
+        contributions.clear();
+        for (TermCursor& cursor : cursors) {
+            if (cursor.FileId() != pivot_file_id) {
+                break;
+            }
+            contributions.emplace_back(cursor.term_index, cursor.term->weight * BM25::calculation(
+                count_documents_,
+                cursor.term->file_ids.size(),
+                cursor.term->frequencies[cursor.position],
+                length,
+                average_length_of_documents_
+            ));
+            ++cursor.position;
+        }
+
+        std::sort(contributions.begin(), contributions.end());
+        double score = 0;
+        for (const auto& contribution : contributions) {
+            score += contribution.second;
+        }
+        ++count_scored_documents;
+
+        if (top.size() < count_top) {
+            top.emplace(pivot_file_id, score);
+        } else if (score > top.top().second) {
+            top.pop();
+            top.emplace(pivot_file_id, score);
+        }
+    }
+
+    std::vector<std::pair<size_t, double>> result;
+    result.reserve(top.size());
+    while (!top.empty()) {
+        result.push_back(top.top());
+        top.pop();
+    }
+    std::reverse(result.begin(), result.end());
+
+    return result;
+}
+
+size_t Searcher::CountScoredDocuments() const {
+    return count_scored_documents_;
+}
@@ -3,10 +3,16 @@
 #include <vector>
 #include <string>
 #include <unordered_map>
+#include <functional>
+#include <span>
+#include <limits>
+
+class ThreadPool;
 
 struct BM25 {
     constexpr static const double k1 = 2.0;
     constexpr static const double b = 0.75; 
+    constexpr static const double kFuzzyPenalty = 0.5;
 
     static double calculationIDF(size_t number_of_documents, size_t document_frequency);
     static double calculationTF(size_t word_frequency_in_document, 
@@ -17,23 +23,60 @@ struct BM25 {
                             size_t word_frequency_in_document, 
                             size_t document_length,
                             double average_length_of_documents);                           
+    static double FuzzyWeight(size_t edit_distance);
+};
+
+struct TermPostings {
+    std::span<const size_t> file_ids;
+    std::span<const size_t> frequencies;
+    double max_score;
+    double weight = 1.0;
 };
 
 class Searcher {
 public:
+    constexpr static const double kUpperBoundSlack = 1e-9;
+    constexpr static const size_t kMinParallelPostings = 1 << 16;
+    constexpr static const size_t kMinParallelScores = 1 << 14;
+
     explicit Searcher(const std::vector<std::string>& request);
+    Searcher(double average_length_of_documents, size_t count_documents);
+    Searcher(const std::vector<std::string>& request,
+             std::unordered_map<std::string, size_t> count_word_in_file,
+             double average_length_of_documents,
+             size_t count_documents);
 
     std::vector<std::pair<std::string, double>> GetBM25(
-        const std::unordered_map<std::string, std::unordered_map<std::string, size_t>>& data_word
+        const std::unordered_map<std::string, std::unordered_map<std::string, size_t>>& data_word,
+        const std::unordered_map<std::string, double>& word_weights = {},
+        ThreadPool* thread_pool = nullptr
     );
 
+    double GetMaxScore(std::span<const size_t> file_ids, std::span<const size_t> frequencies,
+                       const std::function<size_t(size_t)>& document_length) const;
+    std::vector<std::pair<size_t, double>> GetTopBM25(const std::vector<TermPostings>& terms,
+                                                      const std::function<size_t(size_t)>& document_length,
+                                                      size_t count_top,
+                                                      const std::vector<size_t>* filter = nullptr,
+                                                      ThreadPool* thread_pool = nullptr);
+    size_t CountScoredDocuments() const;
+
     static std::vector<std::string> TokenizeExpression(const std::string& expression);
 
     static size_t GetWordCount(const std::string& filename);
 
 private:
+    std::vector<std::pair<size_t, double>> GetTopBM25InRange(const std::vector<TermPostings>& terms,
+                                                             const std::function<size_t(size_t)>& document_length,
+                                                             size_t count_top,
+                                                             const std::vector<size_t>* filter,
+                                                             size_t begin_file_id,
+                                                             size_t end_file_id,
+                                                             size_t& count_scored_documents) const;
+
     std::vector<std::string> request_;
     std::unordered_map<std::string, size_t> count_word_in_file;
     double average_length_of_documents_;
     size_t count_documents_;
+    size_t count_scored_documents_ = 0;
 };
\ No newline at end of file
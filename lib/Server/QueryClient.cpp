@@ -0,0 +1,76 @@
+#include "QueryClient.hpp"
+#include "QueryServer.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+QueryClient::QueryClient(const std::string& socket_path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        throw std::invalid_argument("socket path is too long: " + socket_path);
+    }
+    std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+    fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd_ == -1) {
+        throw std::runtime_error(std::string("socket: ") + std::strerror(errno));
+    }
+    if (connect(fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == -1) {
+        int error = errno;
+        close(fd_);
+        throw std::runtime_error("connect " + socket_path + ": " + std::strerror(error));
+    }
+}
+
+QueryClient::~QueryClient() {
+    close(fd_);
+}
+
+void QueryClient::Send(const std::string& request) {
+    std::string line = request + '\n';
+    size_t offset = 0;
+    while (offset < line.size()) {
+        ssize_t count_written = send(fd_, line.data() + offset, line.size() - offset, MSG_NOSIGNAL);
+        if (count_written == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(std::string("send: ") + std::strerror(errno));
+        }
+        offset += count_written;
+    }
+}
+
+std::string QueryClient::ReadResponse() {
+    const std::string response_end = QueryServer::kResponseEnd;
+    while (true) {
+        size_t line_begin = scanned_;
+        for (size_t line_end = buffer_.find('\n', line_begin); line_end != std::string::npos;
+             line_end = buffer_.find('\n', line_begin)) {
+            if (buffer_.compare(line_begin, line_end + 1 - line_begin, response_end) == 0) {
+                std::string response = buffer_.substr(0, line_end + 1);
+                buffer_.erase(0, line_end + 1);
+                scanned_ = 0;
+                return response;
+            }
+            line_begin = line_end + 1;
+        }
+        scanned_ = line_begin;
+
+        char buffer[kReadBufferSize];
+        ssize_t count_read = recv(fd_, buffer, sizeof(buffer), 0);
+        if (count_read == -1 && errno == EINTR) {
+            continue;
+        }
+        if (count_read <= 0) {
+            throw std::runtime_error("connection closed before the end of the response");
+        }
+        buffer_.append(buffer, count_read);
+    }
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+
+class QueryClient {
+public:
+    constexpr static const size_t kReadBufferSize = 1 << 16;
+
+    explicit QueryClient(const std::string& socket_path);
+    ~QueryClient();
+
+    QueryClient(const QueryClient&) = delete;
+    QueryClient& operator=(const QueryClient&) = delete;
+
+    void Send(const std::string& request);
+    std::string ReadResponse();
+private:
+    int fd_ = -1;
+    std::string buffer_;
+    size_t scanned_ = 0;
+};
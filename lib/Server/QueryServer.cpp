@@ -0,0 +1,272 @@
+#include "QueryServer.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+void ThrowSystemError(const std::string& what) {
+    throw std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+void SetNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+        ThrowSystemError("fcntl");
+    }
+}
+
+}
+
+QueryServer::QueryServer(const std::string& socket_path, size_t count_workers, Handler handler)
+    : socket_path_(socket_path)
+    , handler_(std::move(handler))
+    , thread_pool_(count_workers)
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socket_path_.size() >= sizeof(address.sun_path)) {
+        throw std::invalid_argument("socket path is too long: " + socket_path_);
+    }
+    std::memcpy(address.sun_path, socket_path_.c_str(), socket_path_.size() + 1);
+
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd_ == -1) {
+        ThrowSystemError("socket");
+    }
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd_ == -1) {
+        close(listen_fd_);
+        ThrowSystemError("eventfd");
+    }
+
+    unlink(socket_path_.c_str());
+    if (bind(listen_fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == -1
+        || listen(listen_fd_, kBacklog) == -1) {
+        int error = errno;
+        close(listen_fd_);
+        close(wake_fd_);
+        errno = error;
+        ThrowSystemError("bind " + socket_path_);
+    }
+    SetNonBlocking(listen_fd_);
+}
+
+QueryServer::~QueryServer() {
+    thread_pool_.Wait();
+    for (auto& [fd, connection] : connections_) {
+        close(fd);
+    }
+    close(listen_fd_);
+    close(wake_fd_);
+    unlink(socket_path_.c_str());
+}
+
+void QueryServer::Run() {
+    std::vector<pollfd> poll_fds;
+    std::vector<int> closed_fds;
+
+    while (!is_stopped_.load(std::memory_order_acquire)) {
+        poll_fds.clear();
+        poll_fds.push_back(pollfd{listen_fd_, static_cast<short>(is_accept_paused_ ? 0 : POLLIN), 0});
+        poll_fds.push_back(pollfd{wake_fd_, POLLIN, 0});
+        for (auto& [fd, connection] : connections_) {
+            short events = 0;
+            if (!connection.is_input_closed) {
+                if (connection.responses.size() < kMaxPendingRequests) {
+                    events |= POLLIN;
+                } else {
+                    ++stats_.count_read_pauses;
+                }
+            }
+            if (connection.output_offset < connection.output.size()) {
+                events |= POLLOUT;
+            }
+            poll_fds.push_back(pollfd{fd, events, 0});
+        }
+
+        int count_ready = poll(poll_fds.data(), poll_fds.size(), is_accept_paused_ ? kAcceptRetryMilliseconds : -1);
+        if (count_ready == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ThrowSystemError("poll");
+        }
+
+        if (poll_fds[1].revents & POLLIN) {
+            DrainWake();
+        }
+
+        closed_fds.clear();
+        for (size_t i = 2; i < poll_fds.size(); ++i) {
+            Connection& connection = connections_.at(poll_fds[i].fd);
+            bool is_open = true;
+            if (poll_fds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+                is_open = Read(connection) && !(poll_fds[i].revents & (POLLHUP | POLLERR));
+            }
+            if (is_open) {
+                is_open = Flush(connection);
+            }
+            if (is_open && connection.is_input_closed && connection.responses.empty()
+                && connection.output_offset == connection.output.size()) {
+                is_open = false;
+            }
+            if (!is_open) {
+                closed_fds.push_back(connection.fd);
+            }
+        }
+        for (int fd : closed_fds) {
+            close(fd);
+            connections_.erase(fd);
+        }
+        if (count_ready == 0 || !closed_fds.empty()) {
+            is_accept_paused_ = false;
+        }
+
+        if (poll_fds[0].revents & POLLIN) {
+            Accept();
+        }
+    }
+}
+
+void QueryServer::Stop() {
+    is_stopped_.store(true, std::memory_order_release);
+    Wake();
+}
+
+const QueryServer::Stats& QueryServer::GetStats() const {
+    return stats_;
+}
+
+size_t QueryServer::CountWorkers() const {
+    return thread_pool_.Size();
+}
+
+void QueryServer::Accept() {
+    while (true) {
+        int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd == -1) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return;
+            }
+            if (errno == EMFILE || errno == ENFILE) {
+                is_accept_paused_ = true;
+                ++stats_.count_accept_pauses;
+                return;
+            }
+            ThrowSystemError("accept");
+        }
+
+        connections_.try_emplace(fd, fd);
+        ++stats_.count_connections;
+    }
+}
+
+bool QueryServer::Read(Connection& connection) {
+    char buffer[kReadBufferSize];
+    while (connection.responses.size() < kMaxPendingRequests) {
+        ssize_t count_read = recv(connection.fd, buffer, sizeof(buffer), 0);
+        if (count_read == 0) {
+            connection.is_input_closed = true;
+            break;
+        }
+        if (count_read == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+
+        size_t line_begin = 0;
+        size_t search_from = connection.input.size();
+        connection.input.append(buffer, count_read);
+        for (size_t line_end = connection.input.find('\n', search_from); line_end != std::string::npos;
+             line_end = connection.input.find('\n', line_begin)) {
+            size_t line_size = line_end - line_begin;
+            if (line_size != 0 && connection.input[line_end - 1] == '\r') {
+                --line_size;
+            }
+            Dispatch(connection, connection.input.substr(line_begin, line_size));
+            line_begin = line_end + 1;
+        }
+        connection.input.erase(0, line_begin);
+
+        if (connection.input.size() > kMaxRequestSize) {
+            return false;
+        }
+    }
+
+    if (connection.is_input_closed && !connection.input.empty()) {
+        Dispatch(connection, std::move(connection.input));
+        connection.input.clear();
+    }
+
+    return true;
+}
+
+void QueryServer::Dispatch(Connection& connection, std::string request) {
+    auto response = std::make_shared<Response>();
+    connection.responses.push_back(response);
+    ++stats_.count_requests;
+
+    thread_pool_.Submit([this, response, request = std::move(request)]() {
+        std::ostringstream text;
+        try {
+            handler_(request, text);
+        } catch (const std::exception& error) {
+            text << "error: " << error.what() << '\n' << kResponseEnd;
+        }
+
+        response->text = std::move(text).str();
+        response->is_ready.store(true, std::memory_order_release);
+        Wake();
+    });
+}
+
+bool QueryServer::Flush(Connection& connection) {
+    while (!connection.responses.empty() && connection.responses.front()->is_ready.load(std::memory_order_acquire)) {
+        connection.output += connection.responses.front()->text;
+        connection.responses.pop_front();
+    }
+
+    while (connection.output_offset < connection.output.size()) {
+        ssize_t count_written = send(connection.fd, connection.output.data() + connection.output_offset,
+                                     connection.output.size() - connection.output_offset, MSG_NOSIGNAL);
+        if (count_written == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        connection.output_offset += count_written;
+    }
+    connection.output.clear();
+    connection.output_offset = 0;
+
+    return true;
+}
+
+void QueryServer::Wake() {
+    uint64_t value = 1;
+    while (write(wake_fd_, &value, sizeof(value)) == -1 && errno == EINTR) {
+    }
+}
+
+void QueryServer::DrainWake() {
+    uint64_t value;
+    while (read(wake_fd_, &value, sizeof(value)) == -1 && errno == EINTR) {
+    }
+}
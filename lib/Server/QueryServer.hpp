@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+
+#include "../ThreadPool/ThreadPool.hpp"
+
+class QueryServer {
+public:
+    constexpr static const size_t kReadBufferSize = 1 << 16;
+    constexpr static const size_t kMaxPendingRequests = 256;
+    constexpr static const size_t kMaxRequestSize = 1 << 20;
+    constexpr static const int kBacklog = 128;
+    constexpr static const int kAcceptRetryMilliseconds = 100;
+    constexpr static const char* kResponseEnd = "end\n";
+
+    struct Stats {
+        size_t count_connections = 0;
+        size_t count_requests = 0;
+        size_t count_read_pauses = 0;
+        size_t count_accept_pauses = 0;
+    };
+
+    using Handler = std::function<void(const std::string& request, std::ostream& response)>;
+
+    QueryServer(const std::string& socket_path, size_t count_workers, Handler handler);
+    ~QueryServer();
+
+    QueryServer(const QueryServer&) = delete;
+    QueryServer& operator=(const QueryServer&) = delete;
+
+    void Run();
+    void Stop();
+
+    const Stats& GetStats() const;
+    size_t CountWorkers() const;
+private:
+    struct Response {
+        std::string text;
+        std::atomic<bool> is_ready = false;
+    };
+
+    struct Connection {
+        explicit Connection(int fd)
+            : fd(fd)
+        {}
+
+        int fd;
+        std::string input;
+        std::string output;
+        size_t output_offset = 0;
+        std::deque<std::shared_ptr<Response>> responses;
+        bool is_input_closed = false;
+    };
+
+    void Accept();
+    bool Read(Connection& connection);
+    void Dispatch(Connection& connection, std::string request);
+    bool Flush(Connection& connection);
+    void Wake();
+    void DrainWake();
+
+    std::string socket_path_;
+    Handler handler_;
+    int listen_fd_ = -1;
+    int wake_fd_ = -1;
+    std::atomic<bool> is_stopped_ = false;
+    bool is_accept_paused_ = false;
+    std::unordered_map<int, Connection> connections_;
+    Stats stats_;
+    ThreadPool thread_pool_;
+};
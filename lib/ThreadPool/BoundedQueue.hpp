@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+template<typename T>
+class BoundedQueue {
+public:
+    constexpr static const uint64_t kClosedBit = uint64_t(1) << 63;
+    constexpr static const size_t kCacheLineSize = 64;
+
+    explicit BoundedQueue(size_t capacity)
+        : slots_(std::bit_ceil(capacity))
+        , mask_(slots_.size() - 1)
+    {
+        if (capacity == 0) {
+            throw std::invalid_argument("bounded queue needs at least one slot");
+        }
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    bool Push(T&& value) {
+        uint64_t tail = tail_.load(std::memory_order_relaxed);
+        uint64_t head = head_.load(std::memory_order_acquire);
+        if (tail - (head & ~kClosedBit) == slots_.size() && !(head & kClosedBit)) {
+            ++count_push_stalls_;
+            while (tail - (head & ~kClosedBit) == slots_.size() && !(head & kClosedBit)) {
+                head_.wait(head, std::memory_order_acquire);
+                head = head_.load(std::memory_order_acquire);
+            }
+        }
+        if (head & kClosedBit) {
+            return false;
+        }
+
+        slots_[tail & mask_] = std::move(value);
+        tail_.store(tail + 1, std::memory_order_release);
+        tail_.notify_one();
+        return true;
+    }
+
+    bool Pop(T& value) {
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        uint64_t tail = tail_.load(std::memory_order_acquire);
+        if (head == (tail & ~kClosedBit) && !(tail & kClosedBit)) {
+            ++count_pop_stalls_;
+            while (head == (tail & ~kClosedBit) && !(tail & kClosedBit)) {
+                tail_.wait(tail, std::memory_order_acquire);
+                tail = tail_.load(std::memory_order_acquire);
+            }
+        }
+        if (head == (tail & ~kClosedBit)) {
+            return false;
+        }
+
+        value = std::move(slots_[head & mask_]);
+        head_.store(head + 1, std::memory_order_release);
+        head_.notify_one();
+        return true;
+    }
+
+    void Close() {
+        tail_.fetch_or(kClosedBit, std::memory_order_release);
+        tail_.notify_one();
+    }
+
+    void Cancel() {
+        head_.fetch_or(kClosedBit, std::memory_order_release);
+        head_.notify_one();
+    }
+
+    size_t Capacity() const {
+        return slots_.size();
+    }
+
+    size_t CountPushStalls() const {
+        return count_push_stalls_;
+    }
+
+    size_t CountPopStalls() const {
+        return count_pop_stalls_;
+    }
+private:
+    alignas(kCacheLineSize) std::atomic<uint64_t> head_ = 0;
+    size_t count_pop_stalls_ = 0;
+    alignas(kCacheLineSize) std::atomic<uint64_t> tail_ = 0;
+    size_t count_push_stalls_ = 0;
+    alignas(kCacheLineSize) std::vector<T> slots_;
+    size_t mask_;
+};
@@ -0,0 +1,177 @@
+#include "ThreadPool.hpp"
+
+#include <latch>
+
+namespace {
+
+thread_local size_t current_worker = ThreadPool::kNotWorker;
+thread_local const ThreadPool* current_pool = nullptr;
+
+}
+
+ThreadPool::ThreadPool(size_t count_threads) {
+    if (count_threads == 0) {
+        throw std::invalid_argument("thread pool needs at least one thread");
+    }
+
+    for (size_t i = 0; i < count_threads; ++i) {
+        queues_.push_back(std::make_unique<WorkerQueue>());
+    }
+
+    for (size_t i = 0; i < count_threads; ++i) {
+        workers_.emplace_back(&ThreadPool::WorkerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    task_available_.notify_all();
+
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+    size_t queue = current_pool == this ? current_worker : kNotWorker;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (queue == kNotWorker) {
+            queue = next_queue_;
+            next_queue_ = (next_queue_ + 1) % queues_.size();
+        }
+        ++count_queued_;
+        ++count_pending_;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queues_[queue]->mutex);
+        queues_[queue]->tasks.push_back(std::move(task));
+    }
+
+    task_available_.notify_one();
+}
+
+void ThreadPool::Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    all_done_.wait(lock, [this] { return count_pending_ == 0; });
+
+    if (exception_) {
+        std::exception_ptr exception = nullptr;
+        std::swap(exception, exception_);
+        std::rethrow_exception(exception);
+    }
+}
+
+void ThreadPool::ParallelFor(size_t count_tasks, const std::function<void(size_t)>& task) {
+    if (count_tasks == 0) {
+        return;
+    }
+
+    std::latch done(count_tasks - 1);
+    std::vector<std::exception_ptr> exceptions(count_tasks);
+    for (size_t i = 1; i < count_tasks; ++i) {
+        Submit([&task, &done, &exceptions, i] {
+            try {
+                task(i);
+            } catch (...) {
+                exceptions[i] = std::current_exception();
+            }
+            done.count_down();
+        });
+    }
+
+    try {
+        task(0);
+    } catch (...) {
+        exceptions[0] = std::current_exception();
+    }
+    done.wait();
+
+    for (const std::exception_ptr& exception : exceptions) {
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+    }
+}
+
+size_t ThreadPool::Size() const {
+    return workers_.size();
+}
+
+size_t ThreadPool::CurrentWorker() {
+    return current_worker;
+}
+
+bool ThreadPool::PopTask(size_t worker, std::function<void()>& task) {
+    {
+        std::lock_guard<std::mutex> lock(queues_[worker]->mutex);
+        if (!queues_[worker]->tasks.empty()) {
+            task = std::move(queues_[worker]->tasks.front());
+            queues_[worker]->tasks.pop_front();
+            return true;
+        }
+    }
+
+    for (size_t i = 1; i < queues_.size(); ++i) {
+        WorkerQueue& victim = *queues_[(worker + i) % queues_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::WorkerLoop(size_t worker) {
+    current_worker = worker;
+    current_pool = this;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            task_available_.wait(lock, [this] { return stop_ || count_queued_ != 0; });
+            if (count_queued_ == 0) {
+                return;
+            }
+            --count_queued_;
+        }
+
+        std::function<void()> task;
+        while (!PopTask(worker, task)) {
+            std::this_thread::yield();
+        }
+
+        try {
+            task();
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!exception_) {
+                exception_ = std::current_exception();
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--count_pending_ == 0) {
+            all_done_.notify_all();
+        }
+    }
+}
+
+void ParallelFor(ThreadPool* thread_pool, size_t count_tasks, const std::function<void(size_t)>& task) {
+    if (thread_pool != nullptr && count_tasks > 1) {
+        thread_pool->ParallelFor(count_tasks, task);
+        return;
+    }
+
+    for (size_t i = 0; i < count_tasks; ++i) {
+        task(i);
+    }
+}
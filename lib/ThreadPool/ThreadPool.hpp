@@ -0,0 +1,52 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+    constexpr static const size_t kNotWorker = static_cast<size_t>(-1);
+
+    explicit ThreadPool(size_t count_threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void Submit(std::function<void()> task);
+    void Wait();
+
+    void ParallelFor(size_t count_tasks, const std::function<void(size_t)>& task);
+
+    size_t Size() const;
+    static size_t CurrentWorker();
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    bool PopTask(size_t worker, std::function<void()>& task);
+    void WorkerLoop(size_t worker);
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues_;
+    std::vector<std::thread> workers_;
+
+    std::mutex mutex_;
+    std::condition_variable task_available_;
+    std::condition_variable all_done_;
+    size_t count_queued_ = 0;
+    size_t count_pending_ = 0;
+    size_t next_queue_ = 0;
+    bool stop_ = false;
+    std::exception_ptr exception_;
+};
+
+void ParallelFor(ThreadPool* thread_pool, size_t count_tasks, const std::function<void(size_t)>& task);
@@ -0,0 +1,188 @@
+#include "Trace.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace {
+
+constexpr size_t kCountPhases = static_cast<size_t>(Trace::Phase::kCount);
+constexpr size_t kCountCounters = static_cast<size_t>(Trace::Counter::kCount);
+
+struct QueryTrace {
+    std::array<uint64_t, kCountPhases> nanoseconds = {};
+    std::array<uint64_t, kCountCounters> counters = {};
+};
+
+std::array<Trace::Histogram, kCountPhases> histograms;
+std::array<std::atomic<uint64_t>, kCountCounters> total_counters = {};
+thread_local QueryTrace query_trace;
+
+double Milliseconds(uint64_t nanoseconds) {
+    return static_cast<double>(nanoseconds) / 1e6;
+}
+
+}
+
+uint64_t Trace::Histogram::Percentile(double fraction) const {
+    uint64_t count_values = count.load(std::memory_order_relaxed);
+    if (count_values == 0) {
+        return 0;
+    }
+
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(fraction * count_values)));
+    uint64_t count_seen = 0;
+    for (size_t i = 0; i < kCountBuckets; ++i) {
+        count_seen += buckets[i].load(std::memory_order_relaxed);
+        if (count_seen >= rank) {
+            uint64_t upper_bound = i + 1 < kCountBuckets ? (uint64_t(1) << i) : UINT64_MAX;
+            return std::min(upper_bound, max_nanoseconds.load(std::memory_order_relaxed));
+        }
+    }
+
+    return max_nanoseconds.load(std::memory_order_relaxed);
+}
+
+void Trace::Record(Phase phase, uint64_t nanoseconds) {
+    size_t index = static_cast<size_t>(phase);
+    query_trace.nanoseconds[index] += nanoseconds;
+
+    Histogram& histogram = histograms[index];
+    histogram.count.fetch_add(1, std::memory_order_relaxed);
+    histogram.total_nanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+    histogram.buckets[std::min<size_t>(std::bit_width(nanoseconds), kCountBuckets - 1)]
+        .fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t max_nanoseconds = histogram.max_nanoseconds.load(std::memory_order_relaxed);
+    while (max_nanoseconds < nanoseconds
+           && !histogram.max_nanoseconds.compare_exchange_weak(max_nanoseconds, nanoseconds,
+                                                               std::memory_order_relaxed)) {
+    }
+}
+
+void Trace::AddCounter(Counter counter, uint64_t value) {
+    size_t index = static_cast<size_t>(counter);
+    query_trace.counters[index] += value;
+    total_counters[index].fetch_add(value, std::memory_order_relaxed);
+}
+
+void Trace::BeginQuery() {
+    query_trace = QueryTrace();
+}
+
+uint64_t Trace::QueryNanoseconds(Phase phase) {
+    return query_trace.nanoseconds[static_cast<size_t>(phase)];
+}
+
+uint64_t Trace::QueryCounter(Counter counter) {
+    return query_trace.counters[static_cast<size_t>(counter)];
+}
+
+void Trace::PrintQuery(std::ostream& out) {
+    out << "trace:";
+    const char* separator = " ";
+    for (size_t i = 0; i < kCountPhases; ++i) {
+        if (query_trace.nanoseconds[i] != 0) {
+            out << separator << PhaseName(static_cast<Phase>(i)) << ' ' << Milliseconds(query_trace.nanoseconds[i])
+                << " ms";
+            separator = ", ";
+        }
+    }
+    for (size_t i = 0; i < kCountCounters; ++i) {
+        if (query_trace.counters[i] != 0) {
+            out << separator << CounterName(static_cast<Counter>(i)) << ' ' << query_trace.counters[i];
+            separator = ", ";
+        }
+    }
+    out << '\n';
+}
+
+const Trace::Histogram& Trace::GetHistogram(Phase phase) {
+    return histograms[static_cast<size_t>(phase)];
+}
+
+uint64_t Trace::TotalCounter(Counter counter) {
+    return total_counters[static_cast<size_t>(counter)].load(std::memory_order_relaxed);
+}
+
+void Trace::PrintStats(std::ostream& out) {
+    for (size_t i = 0; i < kCountPhases; ++i) {
+        const Histogram& histogram = histograms[i];
+        uint64_t count = histogram.count.load(std::memory_order_relaxed);
+        if (count == 0) {
+            continue;
+        }
+
+        uint64_t total_nanoseconds = histogram.total_nanoseconds.load(std::memory_order_relaxed);
+        out << "stats " << PhaseName(static_cast<Phase>(i)) << ": " << count << " calls, total "
+            << Milliseconds(total_nanoseconds) << " ms, mean " << Milliseconds(total_nanoseconds / count)
+            << " ms, p50 " << Milliseconds(histogram.Percentile(0.5)) << " ms, p90 "
+            << Milliseconds(histogram.Percentile(0.9)) << " ms, p99 " << Milliseconds(histogram.Percentile(0.99))
+            << " ms, max " << Milliseconds(histogram.max_nanoseconds.load(std::memory_order_relaxed)) << " ms\n";
+    }
+
+    out << "stats counters:";
+    const char* separator = " ";
+    for (size_t i = 0; i < kCountCounters; ++i) {
+        out << separator << CounterName(static_cast<Counter>(i)) << ' ' << TotalCounter(static_cast<Counter>(i));
+        separator = ", ";
+    }
+    out << '\n';
+}
+
+void Trace::Reset() {
+    for (Histogram& histogram : histograms) {
+        histogram.count = 0;
+        histogram.total_nanoseconds = 0;
+        histogram.max_nanoseconds = 0;
+        for (std::atomic<uint64_t>& bucket : histogram.buckets) {
+            bucket = 0;
+        }
+    }
+    for (std::atomic<uint64_t>& counter : total_counters) {
+        counter = 0;
+    }
+    BeginQuery();
+}
+
+const char* Trace::PhaseName(Phase phase) {
+    switch (phase) {
+        case Phase::kReadTies:
+            return "read ties";
+        case Phase::kReadIdDirectory:
+            return "read id directory";
+        case Phase::kReadDocumentLength:
+            return "read document length";
+        case Phase::kLoadMappedIndex:
+            return "load mapped index";
+        case Phase::kTermLookup:
+            return "term lookup";
+        case Phase::kPostings:
+            return "postings fetch";
+        case Phase::kBooleanEvaluation:
+            return "boolean evaluation";
+        case Phase::kScoring:
+            return "scoring";
+        case Phase::kPrinting:
+            return "printing";
+        case Phase::kQuery:
+            return "query";
+        default:
+            return "unknown";
+    }
+}
+
+const char* Trace::CounterName(Counter counter) {
+    switch (counter) {
+        case Counter::kTerms:
+            return "terms";
+        case Counter::kPostings:
+            return "postings";
+        case Counter::kMatched:
+            return "matched";
+        case Counter::kScored:
+            return "scored";
+        default:
+            return "unknown";
+    }
+}
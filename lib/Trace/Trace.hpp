@@ -0,0 +1,106 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+class Trace {
+public:
+    constexpr static const size_t kCountBuckets = 64;
+
+    enum class Phase {
+        kReadTies,
+        kReadIdDirectory,
+        kReadDocumentLength,
+        kLoadMappedIndex,
+        kTermLookup,
+        kPostings,
+        kBooleanEvaluation,
+        kScoring,
+        kPrinting,
+        kQuery,
+        kCount
+    };
+
+    enum class Counter {
+        kTerms,
+        kPostings,
+        kMatched,
+        kScored,
+        kCount
+    };
+
+    struct Histogram {
+        std::atomic<uint64_t> count = 0;
+        std::atomic<uint64_t> total_nanoseconds = 0;
+        std::atomic<uint64_t> max_nanoseconds = 0;
+        std::array<std::atomic<uint64_t>, kCountBuckets> buckets = {};
+
+        uint64_t Percentile(double fraction) const;
+    };
+
+    class ScopedTimer {
+    public:
+        explicit ScopedTimer(Phase phase)
+            : phase_(phase)
+            , is_running_(IsEnabled())
+        {
+            if (is_running_) {
+                start_ = std::chrono::steady_clock::now();
+            }
+        }
+
+        ~ScopedTimer() {
+            Stop();
+        }
+
+        void Stop() {
+            if (is_running_) {
+                is_running_ = false;
+                Record(phase_, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start_).count()));
+            }
+        }
+
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+    private:
+        Phase phase_;
+        bool is_running_;
+        std::chrono::steady_clock::time_point start_;
+    };
+
+    static void Enable(bool is_enabled) {
+        is_enabled_.store(is_enabled, std::memory_order_relaxed);
+    }
+
+    static bool IsEnabled() {
+        return is_enabled_.load(std::memory_order_relaxed);
+    }
+
+    static void Add(Counter counter, uint64_t value) {
+        if (IsEnabled()) {
+            AddCounter(counter, value);
+        }
+    }
+
+    static void Record(Phase phase, uint64_t nanoseconds);
+    static void BeginQuery();
+    static uint64_t QueryNanoseconds(Phase phase);
+    static uint64_t QueryCounter(Counter counter);
+    static void PrintQuery(std::ostream& out);
+
+    static const Histogram& GetHistogram(Phase phase);
+    static uint64_t TotalCounter(Counter counter);
+    static void PrintStats(std::ostream& out);
+    static void Reset();
+
+    static const char* PhaseName(Phase phase);
+    static const char* CounterName(Counter counter);
+private:
+    static void AddCounter(Counter counter, uint64_t value);
+
+    inline static std::atomic<bool> is_enabled_ = false;
+};
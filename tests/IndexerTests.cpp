@@ -1,8 +1,20 @@
 #include <gtest/gtest.h>
 #include <algorithm>
+#include <map>
+#include <random>
+#include <set>
+#include <sstream>
 
+#include "Indexer/ExternalIndexer.hpp"
+#include "Indexer/IdDirectory.hpp"
 #include "Indexer/Indexer.hpp"
+#include "Indexer/MappedIndex.hpp"
+#include "Indexer/PostingCodec.hpp"
+#include "Indexer/SegmentedIndex.hpp"
+#include "Indexer/Tokenizer.hpp"
 #include "ParserArgument/ParserArgument.hpp"
+#include "ParserArgument/TermUnion.hpp"
+#include "Searcher/Searcher.hpp"
 
 const std::vector<std::string> array_words = {
     "apple", "banana", "car", "dog", "elephant", "flower", "grass", "house", "ice", "jacket",
@@ -229,6 +241,412 @@ TEST(IndexerTest, StartIndexer_InvalidDirectory) {
     EXPECT_THROW(indexer.StartIndexer(invalid_dir), std::runtime_error);
 }
 
+std::set<size_t> CollectLines(const Ties::iterator& iterator_word, size_t index) {
+    std::set<size_t> lines;
+    for (auto it = iterator_word.GetStartArray(index); it != iterator_word.GetEndArray(index); ++it) {
+        lines.insert(*it);
+    }
+    return lines;
+}
+
+TEST(IndexerTest, StartIndexer_ParallelMatchesSerial) {
+    std::filesystem::path test_dir = "test_parallel_dir";
+    std::filesystem::create_directories(test_dir / "nested");
+
+    std::vector<std::string> words_in_files;
+    for (size_t i = 0; i < 16; ++i) {
+        std::string content;
+        for (size_t line = 0; line < 8; ++line) {
+            for (size_t j = 0; j < 4; ++j) {
+                const std::string& word = array_words[(i * 7 + line * 3 + j) % array_words.size()];
+                content += word + " ";
+                words_in_files.push_back(word);
+            }
+            content += "\n";
+        }
+        std::filesystem::path folder = (i % 2 == 0) ? test_dir : test_dir / "nested";
+        CreateTestFile(folder / ("file" + std::to_string(i) + ".cpp"), content);
+    }
+
+    Indexer<true> serial_indexer;
+    serial_indexer.StartIndexer(test_dir);
+
+    Indexer<true> parallel_indexer;
+    parallel_indexer.StartIndexer(test_dir, 4);
+
+    EXPECT_EQ(serial_indexer.file_id, parallel_indexer.file_id);
+    for (size_t i = 1; i <= serial_indexer.file_id; ++i) {
+        EXPECT_EQ(serial_indexer.StringIndex(i), parallel_indexer.StringIndex(i));
+    }
+
+    for (const std::string& word : words_in_files) {
+        auto serial_word = serial_indexer.SearchWord(word);
+        auto parallel_word = parallel_indexer.SearchWord(word);
+        ASSERT_NE(parallel_word, parallel_indexer.end());
+
+        std::unordered_set<size_t> serial_keys = serial_word.GetKeyArray();
+        EXPECT_EQ(serial_keys, parallel_word.GetKeyArray());
+        for (size_t index : serial_keys) {
+            EXPECT_EQ(CollectLines(serial_word, index), CollectLines(parallel_word, index));
+        }
+    }
+
+    std::filesystem::remove_all(test_dir);
+}
+
+TEST(IndexerTest, StartIndexer_PipelineMatchesSerial) {
+    std::filesystem::path test_dir = "test_pipeline_dir";
+    std::filesystem::create_directories(test_dir / "nested");
+
+    std::vector<std::filesystem::path> files;
+    for (size_t i = 0; i < 200; ++i) {
+        std::string content;
+        for (size_t line = 0; line < 6; ++line) {
+            for (size_t j = 0; j < 5; ++j) {
+                content += array_words[(i * 11 + line * 5 + j) % array_words.size()] + (j % 2 == 0 ? " " : "\t");
+            }
+            content += "\n";
+        }
+        std::filesystem::path folder = (i % 3 == 0) ? test_dir / "nested" : test_dir;
+        files.push_back(folder / ("file" + std::to_string(i) + ".cpp"));
+        CreateTestFile(files.back(), content);
+    }
+    CreateTestFile(test_dir / "empty.cpp", "");
+
+    Indexer<true> pipeline_indexer;
+    pipeline_indexer.StartIndexer(test_dir);
+
+    Indexer<true> serial_indexer;
+    for (size_t i = 1; i <= pipeline_indexer.file_id; ++i) {
+        serial_indexer.SaveWordsFromFile(pipeline_indexer.StringIndex(i), i);
+    }
+
+    const IndexPipeline::Stats& stats = pipeline_indexer.PipelineStats();
+    EXPECT_EQ(pipeline_indexer.CountDocuments(), files.size() + 1);
+    EXPECT_EQ(stats.enumerator.count_items, files.size() + 1);
+    EXPECT_EQ(stats.inserter.count_items, files.size() + 1);
+    EXPECT_EQ(stats.count_bytes, pipeline_indexer.TotalFileSize());
+
+    for (size_t i = 1; i <= pipeline_indexer.file_id; ++i) {
+        EXPECT_EQ(serial_indexer.DocumentLength(i), pipeline_indexer.DocumentLength(i));
+    }
+    for (const std::string& word : array_words) {
+        auto serial_word = serial_indexer.SearchWord(word);
+        auto pipeline_word = pipeline_indexer.SearchWord(word);
+        ASSERT_NE(pipeline_word, pipeline_indexer.end());
+
+        std::unordered_set<size_t> serial_keys = serial_word.GetKeyArray();
+        EXPECT_EQ(serial_keys, pipeline_word.GetKeyArray());
+        for (size_t index : serial_keys) {
+            EXPECT_EQ(CollectLines(serial_word, index), CollectLines(pipeline_word, index));
+        }
+    }
+
+    std::filesystem::remove_all(test_dir);
+}
+
+void FillPostings(Indexer<true>& indexer) {
+    for (size_t i = 0; i < array_words.size(); ++i) {
+        auto iterator_word = indexer.SearchWord(array_words[i]);
+        for (size_t j = 0; j <= i % 5; ++j) {
+            iterator_word.insert(i % 7 + 1, i * 10 + j);
+        }
+    }
+}
+
+void CheckMappedIndex(const MappedIndex& mapped_index) {
+    for (size_t i = 0; i < array_words.size(); ++i) {
+        auto iterator_word = mapped_index.SearchWord(array_words[i]);
+        ASSERT_NE(iterator_word, mapped_index.end());
+        EXPECT_EQ(array_words[i].back(), *iterator_word);
+        EXPECT_EQ(iterator_word.GetKeyArray(), std::unordered_set<size_t>({i % 7 + 1}));
+        EXPECT_EQ(iterator_word.size(i % 7 + 1), i % 5 + 1);
+        EXPECT_TRUE(iterator_word.empty(i % 7 + 2));
+
+        std::vector<size_t> lines(iterator_word.GetStartArray(i % 7 + 1), iterator_word.GetEndArray(i % 7 + 1));
+        for (size_t j = 0; j < lines.size(); ++j) {
+            EXPECT_EQ(lines[j], i * 10 + j);
+        }
+    }
+
+    EXPECT_EQ(mapped_index.SearchWord("missingword"), mapped_index.end());
+    EXPECT_EQ(mapped_index.SearchWord("APPLE"), mapped_index.SearchWord("apple"));
+}
+
+TEST(MappedIndexTest, WriteAndSearch) {
+    {
+        Indexer<true> indexer;
+        AddAndCheckWords(indexer, array_words);
+        FillPostings(indexer);
+    }
+
+    MappedIndex mapped_index;
+    CheckMappedIndex(mapped_index);
+}
+
+TEST(MappedIndexTest, RewriteKeepsOpenIndex) {
+    {
+        Indexer<true> indexer;
+        AddAndCheckWords(indexer, array_words);
+        FillPostings(indexer);
+    }
+
+    MappedIndex mapped_index;
+    {
+        Indexer<true> indexer;
+        AddAndCheckWords(indexer, {"apple"});
+    }
+
+    CheckMappedIndex(mapped_index);
+    EXPECT_FALSE(std::filesystem::exists(std::string(MappedIndex::kFileNameMappedIndex) + ".tmp"));
+
+    MappedIndex rewritten_index;
+    EXPECT_EQ(rewritten_index.SearchWord("banana"), rewritten_index.end());
+}
+
+TEST(MappedIndexTest, ConvertFromBfs) {
+    {
+        Indexer<true> indexer;
+        AddAndCheckWords(indexer, array_words);
+        FillPostings(indexer);
+    }
+
+    Indexer<false> indexer_from_file("trie.bin");
+    indexer_from_file.ConvertToMappedIndex("converted.map");
+
+    MappedIndex mapped_index("converted.map");
+    CheckMappedIndex(mapped_index);
+
+    std::filesystem::remove("converted.map");
+}
+
+TEST(MappedIndexTest, StringIndex) {
+    std::filesystem::path test_dir = "test_mapped_dir";
+    std::filesystem::create_directory(test_dir);
+    CreateTestFile(test_dir / "a.cpp", "int main");
+    CreateTestFile(test_dir / "b.hpp", "struct Main");
+
+    {
+        Indexer<true> indexer;
+        indexer.StartIndexer(test_dir);
+    }
+
+    MappedIndex mapped_index;
+    EXPECT_EQ(mapped_index.CountFile(), 2);
+    EXPECT_EQ(mapped_index.DocumentLength(1), 2);
+    EXPECT_EQ(mapped_index.DocumentLength(2), 2);
+    EXPECT_DOUBLE_EQ(mapped_index.AverageDocumentLength(), 2.0);
+    EXPECT_EQ(mapped_index.StringIndex(1), (test_dir / "a.cpp").string());
+    EXPECT_EQ(mapped_index.StringIndex(2), (test_dir / "b.hpp").string());
+    EXPECT_EQ(mapped_index.SearchWord("main").GetKeyArray(), std::unordered_set<size_t>({1, 2}));
+
+    std::filesystem::remove_all(test_dir);
+}
+
+TEST(MappedIndexTest, MaxScore) {
+    std::filesystem::path test_dir = "test_max_score_dir";
+    std::filesystem::create_directory(test_dir);
+    CreateTestFile(test_dir / "a.cpp", "int main\nmain");
+    CreateTestFile(test_dir / "b.cpp", "int value = 0 ;\nint other = 1 ;");
+    CreateTestFile(test_dir / "c.cpp", "void f ( ) ;");
+
+    {
+        Indexer<true> indexer;
+        indexer.StartIndexer(test_dir);
+    }
+
+    MappedIndex mapped_index;
+    Searcher searcher(mapped_index.AverageDocumentLength(), mapped_index.CountDocuments());
+    for (std::string_view word : {"int", "main", "void"}) {
+        MappedIndex::iterator iterator_word = mapped_index.SearchWord(std::string(word));
+        ASSERT_NE(iterator_word, mapped_index.end());
+
+        double max_score = searcher.GetMaxScore(iterator_word.GetSortedKeys(), iterator_word.GetSortedFrequencies(),
+            [&mapped_index](size_t file_id) { return mapped_index.DocumentLength(file_id); });
+        EXPECT_GE(iterator_word.MaxScore(), max_score);
+        EXPECT_NEAR(iterator_word.MaxScore(), max_score, 1e-5);
+    }
+
+    std::filesystem::remove_all(test_dir);
+}
+
+TEST(IndexerTest, DocumentLength) {
+    std::filesystem::path test_dir = "test_length_dir";
+    std::filesystem::create_directory(test_dir);
+    CreateTestFile(test_dir / "a.cpp", "int main ( ) {\n return 0 ;\n}");
+    CreateTestFile(test_dir / "b.cpp", "void f ( ) ;");
+
+    {
+        Indexer<true> indexer;
+        indexer.StartIndexer(test_dir, 2);
+
+        EXPECT_EQ(indexer.DocumentLength(1), 9);
+        EXPECT_EQ(indexer.DocumentLength(2), 5);
+        EXPECT_DOUBLE_EQ(indexer.AverageDocumentLength(), 7.0);
+    }
+
+    Indexer<false> indexer_from_file(ParserArgument::WordLeveling({"main"}));
+    EXPECT_EQ(indexer_from_file.CountDocuments(), 2);
+    EXPECT_EQ(indexer_from_file.DocumentLength(1), 9);
+    EXPECT_EQ(indexer_from_file.DocumentLength(2), 5);
+    EXPECT_DOUBLE_EQ(indexer_from_file.AverageDocumentLength(), 7.0);
+
+    std::filesystem::remove_all(test_dir);
+}
+
+TEST(MappedIndexTest, InvalidFile) {
+    EXPECT_THROW(MappedIndex("missing.map"), std::runtime_error);
+}
+
+TEST(MappedIndexTest, SectionOutOfBounds) {
+    {
+        Indexer<true> indexer;
+        AddAndCheckWords(indexer, array_words);
+        FillPostings(indexer);
+    }
+
+    // count_node, nodes_offset and suffix_offsets_offset in the header
+    for (size_t field_offset : {8, 48, 96}) {
+        std::filesystem::copy_file(MappedIndex::kFileNameMappedIndex, "corrupt.map",
+                                   std::filesystem::copy_options::overwrite_existing);
+        {
+            std::fstream file_mapped("corrupt.map", std::ios::binary | std::ios::in | std::ios::out);
+            uint64_t value = std::filesystem::file_size("corrupt.map");
+            file_mapped.seekp(static_cast<std::streamoff>(field_offset));
+            file_mapped.write(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+        EXPECT_THROW(MappedIndex("corrupt.map"), std::runtime_error);
+    }
+
+    std::filesystem::remove("corrupt.map");
+}
+
+TEST(PostingCodecTest, VarintRoundTrip) {
+    std::vector<uint64_t> values = {0, 1, 127, 128, 16383, 16384, UINT32_MAX, UINT64_MAX};
+    std::vector<uint8_t> encoded;
+    for (uint64_t value : values) {
+        PostingCodec::EncodeVarint(value, encoded);
+    }
+
+    const uint8_t* input = encoded.data();
+    for (uint64_t value : values) {
+        EXPECT_EQ(PostingCodec::DecodeVarint(input), value);
+    }
+    EXPECT_EQ(input, encoded.data() + encoded.size());
+}
+
+TEST(PostingCodecTest, ListRoundTrip) {
+    std::mt19937_64 generator(42);
+
+    for (size_t count : {0, 1, 127, 128, 129, 256, 1000}) {
+        for (uint64_t max_gap : {1ull, 3ull, 1000ull, 1ull << 40}) {
+            std::vector<uint64_t> sorted_values;
+            uint64_t current = 0;
+            for (size_t i = 0; i < count; ++i) {
+                current += generator() % max_gap + 1;
+                sorted_values.push_back(current);
+            }
+
+            std::vector<uint64_t> raw_values;
+            for (size_t i = 0; i < count; ++i) {
+                raw_values.push_back(generator() % max_gap);
+            }
+
+            std::vector<uint8_t> encoded;
+            PostingCodec::EncodeList(sorted_values, true, encoded);
+            PostingCodec::EncodeList(raw_values, false, encoded);
+
+            std::vector<uint64_t> decoded_sorted;
+            std::vector<uint64_t> decoded_raw;
+            const uint8_t* input = PostingCodec::DecodeList(encoded.data(), count, true, decoded_sorted);
+            input = PostingCodec::DecodeList(input, count, false, decoded_raw);
+
+            EXPECT_EQ(decoded_sorted, sorted_values);
+            EXPECT_EQ(decoded_raw, raw_values);
+            EXPECT_EQ(input, encoded.data() + encoded.size());
+        }
+    }
+
+    std::vector<uint64_t> zero_values(PostingCodec::kBlockSize, 0);
+    std::vector<uint8_t> zero_encoded;
+    PostingCodec::EncodeList(zero_values, false, zero_encoded);
+
+    std::vector<uint64_t> zero_decoded(PostingCodec::kBlockSize, 1);
+    PostingCodec::DecodeList(zero_encoded.data(), zero_values.size(), false, zero_decoded.data());
+    EXPECT_EQ(zero_decoded, zero_values);
+
+    std::vector<uint64_t> wide_values(PostingCodec::kBlockSize, UINT64_MAX);
+    std::vector<uint8_t> encoded;
+    PostingCodec::EncodeList(wide_values, false, encoded);
+
+    std::vector<uint64_t> decoded;
+    PostingCodec::DecodeList(encoded.data(), wide_values.size(), false, decoded);
+    EXPECT_EQ(decoded, wide_values);
+}
+
+void WriteLegacyTrie(const std::string& path_trie) {
+    struct LegacyHeader {
+        char symbol;
+        size_t children_size;
+        size_t string_word_lenght;
+        size_t word_string_size;
+    };
+
+    std::ofstream file_trie(path_trie, std::ios::binary);
+    LegacyHeader root = {'\0', 1, 0, 0};
+    LegacyHeader child = {'a', 0, 1, 4 * sizeof(size_t)};
+    size_t postings[] = {2, 7, 5, 3};
+
+    file_trie.write(reinterpret_cast<char*>(&root), sizeof(root));
+    file_trie.write(reinterpret_cast<char*>(&child), sizeof(child));
+    file_trie.write(reinterpret_cast<char*>(postings), sizeof(postings));
+}
+
+TEST(IndexerTest, ReadLegacyTrieFormat) {
+    WriteLegacyTrie("legacy_trie.bin");
+
+    Ties word_repository("legacy_trie.bin");
+    auto iterator_word = word_repository.search("a");
+
+    ASSERT_NE(iterator_word, word_repository.end());
+    EXPECT_FALSE(word_repository.HasPositions());
+    EXPECT_EQ(iterator_word.GetKeyArray(), std::unordered_set<size_t>({7}));
+
+    std::set<size_t> lines;
+    for (uint64_t position : CollectLines(iterator_word, 7)) {
+        lines.insert(PostingCodec::PositionLine(position));
+    }
+    EXPECT_EQ(lines, std::set<size_t>({3, 5}));
+
+    std::filesystem::remove("legacy_trie.bin");
+}
+
+TEST(IndexerTest, LegacyTrieSurvivesFailedUpdate) {
+    std::filesystem::path test_dir = "test_legacy_update_dir";
+    std::filesystem::create_directories(test_dir);
+    std::ofstream(test_dir / "file.cpp") << "int main";
+
+    WriteLegacyTrie(Indexer<true>::kFileNameTrie);
+    auto read_trie = [] {
+        std::ifstream file_trie(Indexer<true>::kFileNameTrie, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(file_trie), std::istreambuf_iterator<char>());
+    };
+    std::string legacy_trie = read_trie();
+
+    {
+        Indexer<true> indexer(Indexer<true>::kFileNameTrie);
+        EXPECT_FALSE(indexer.HasPositions());
+        EXPECT_THROW(indexer.UpdateIndexer(test_dir), std::runtime_error);
+        EXPECT_THROW(indexer.StartIndexer(test_dir), std::runtime_error);
+        EXPECT_THROW(indexer.SaveIndexer(), std::runtime_error);
+    }
+
+    EXPECT_EQ(read_trie(), legacy_trie);
+
+    std::filesystem::remove(Indexer<true>::kFileNameTrie);
+    std::filesystem::remove_all(test_dir);
+}
+
 // LOCAL TESTS
 /*
 TEST(IndexerTest, WriteAndReadIdDirectory) {
@@ -267,4 +685,765 @@ TEST(IndexerTest, SingleElementDirectory) {
     ASSERT_EQ(indexer_read.id_directory_.size(), 1);
     EXPECT_EQ(indexer_read.id_directory_[42], "answer");
 }
-*/
\ No newline at end of file
+*/
+TEST(IdDirectoryTest, FrontCodedRoundTrip) {
+    IdDirectory id_directory;
+    std::vector<std::string> paths;
+    for (size_t i = 1; i <= 500; ++i) {
+        paths.push_back("/home/user/projects/library/include/module_" + std::to_string(i % 7) + "/file_"
+                        + std::to_string(i) + ".hpp");
+        id_directory.Insert(i, paths.back());
+    }
+    id_directory.Insert(1000, "");
+    id_directory.Erase(250);
+
+    std::stringstream stream;
+    id_directory.Write(stream);
+    size_t raw_size = 0;
+    for (const std::string& path : paths) {
+        raw_size += path.size();
+    }
+    EXPECT_LT(stream.str().size(), raw_size / 2);
+
+    IdDirectory id_directory_read;
+    id_directory_read.Read(stream);
+
+    ASSERT_EQ(id_directory_read.size(), 500);
+    EXPECT_EQ(id_directory_read.MaxId(), 1000);
+    EXPECT_FALSE(id_directory_read.Contains(0));
+    EXPECT_FALSE(id_directory_read.Contains(250));
+    EXPECT_TRUE(id_directory_read.Contains(1000));
+    EXPECT_EQ(id_directory_read[1000], "");
+    for (size_t i = 1; i <= 500; ++i) {
+        if (i != 250) {
+            EXPECT_EQ(id_directory_read[i], paths[i - 1]);
+        }
+    }
+
+    size_t previous_id = 0;
+    for (const auto& [id, path] : id_directory_read) {
+        EXPECT_GT(id, previous_id);
+        EXPECT_EQ(path, id_directory[id]);
+        previous_id = id;
+    }
+}
+
+TEST(IdDirectoryTest, ReadsLegacyFormat) {
+    std::stringstream stream;
+    auto write_value = [&stream](uint64_t value) {
+        stream.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    };
+    write_value(2);
+    for (const auto& [id, path] : std::vector<std::pair<uint64_t, std::string>>{{7, "b.cpp"}, {3, "a.cpp"}}) {
+        write_value(id);
+        write_value(path.size());
+        stream.write(path.data(), static_cast<std::streamsize>(path.size()));
+    }
+
+    IdDirectory id_directory;
+    id_directory.Read(stream);
+
+    ASSERT_EQ(id_directory.size(), 2);
+    EXPECT_EQ(id_directory[3], "a.cpp");
+    EXPECT_EQ(id_directory[7], "b.cpp");
+    EXPECT_EQ(id_directory[5], "");
+}
+
+TEST(IdDirectoryTest, ReinsertCompactsBlob) {
+    IdDirectory id_directory;
+    for (size_t round = 0; round < 10; ++round) {
+        for (size_t i = 1; i <= 100; ++i) {
+            id_directory.Insert(i, "path/" + std::to_string(round) + "/" + std::to_string(i));
+        }
+    }
+
+    EXPECT_EQ(id_directory.size(), 100);
+    EXPECT_EQ(id_directory[42], "path/9/42");
+    EXPECT_LT(id_directory.BlobSize(), 3 * 100 * std::string("path/9/100").size());
+
+    id_directory.Erase(100);
+    EXPECT_EQ(id_directory.MaxId(), 99);
+    EXPECT_FALSE(id_directory.Contains(100));
+}
+
+TEST(TokenizerTest, MatchesStreamTokenization) {
+    const std::string alphabet = "abcXYZ_09(){};  \t\t\n\n\r\v\f\x80\xff";
+    std::mt19937 generator(11);
+
+    std::string content;
+    for (size_t i = 0; i < 3 * Tokenizer::kBufferSize; ++i) {
+        content += alphabet[generator() % alphabet.size()];
+    }
+    content += "\n" + std::string(Tokenizer::kBufferSize + 17, 'Q') + "\nTail";
+
+    std::filesystem::path file_path = "test_tokenizer.cpp";
+    CreateTestFile(file_path, content);
+
+    std::vector<std::pair<std::string, size_t>> expected;
+    std::istringstream content_stream(content);
+    std::string line;
+    size_t line_number = 0;
+    while (std::getline(content_stream, line)) {
+        ++line_number;
+        std::istringstream line_stream(line);
+        std::string word;
+        while (line_stream >> word) {
+            expected.emplace_back(Indexer<true>::ProcessingWord(word), line_number);
+        }
+    }
+
+    std::vector<std::pair<std::string, size_t>> result;
+    Tokenizer tokenizer(file_path);
+    std::string_view word;
+    while (tokenizer.Next(word)) {
+        result.emplace_back(std::string(word), tokenizer.LineNumber());
+    }
+
+    EXPECT_EQ(result, expected);
+    std::filesystem::remove(file_path);
+}
+
+TEST(TiesTest, TermCacheMatchesInsert) {
+    Ties cached_repository;
+    Ties plain_repository;
+    std::mt19937 generator(5);
+
+    {
+        Ties::TermCache term_cache(cached_repository);
+        for (size_t i = 0; i < 20000; ++i) {
+            std::string word = array_words[generator() % array_words.size()] + std::to_string(generator() % 20);
+            size_t file_id = i / 5000 + 1;
+            size_t line = i / 7 + 1;
+
+            term_cache.insert(word, file_id, line);
+            plain_repository.insert(word, file_id, line);
+        }
+    }
+
+    for (const std::string& word : array_words) {
+        for (size_t i = 0; i < 20; ++i) {
+            Ties::iterator plain_word = plain_repository.search(word + std::to_string(i));
+            Ties::iterator cached_word = cached_repository.search(word + std::to_string(i));
+            ASSERT_EQ(plain_word == plain_repository.end(), cached_word == cached_repository.end());
+            if (plain_word == plain_repository.end()) {
+                continue;
+            }
+
+            EXPECT_EQ(plain_word.GetSortedKeys(), cached_word.GetSortedKeys());
+            for (size_t file_id : plain_word.GetSortedKeys()) {
+                EXPECT_EQ(CollectLines(plain_word, file_id), CollectLines(cached_word, file_id));
+            }
+        }
+    }
+}
+
+void CheckPostings(const Ties& word_repository, const std::map<size_t, std::set<uint64_t>>& expected) {
+    Ties::iterator iterator_word = word_repository.search("term");
+    ASSERT_NE(iterator_word, word_repository.end());
+
+    std::vector<size_t> file_ids;
+    std::vector<size_t> frequencies;
+    for (const auto& [file_id, positions] : expected) {
+        file_ids.push_back(file_id);
+        frequencies.push_back(positions.size());
+        EXPECT_EQ(std::vector<uint64_t>(iterator_word.GetStartArray(file_id), iterator_word.GetEndArray(file_id)),
+                  std::vector<uint64_t>(positions.begin(), positions.end()));
+    }
+    EXPECT_EQ(iterator_word.GetSortedKeys(), file_ids);
+    EXPECT_EQ(iterator_word.GetSortedFrequencies(), frequencies);
+}
+
+TEST(TiesTest, ColumnarPostings) {
+    std::mt19937_64 generator(11);
+    Ties word_repository;
+    Ties other_repository;
+    std::map<size_t, std::set<uint64_t>> expected;
+
+    for (size_t i = 0; i < 5000; ++i) {
+        size_t file_id = i < 2500 ? i / 100 : generator() % 40;
+        uint64_t position = i < 2500 ? PostingCodec::PackPosition(i / 3, i % 3 * 7)
+                                     : PostingCodec::PackPosition(generator() % 1000, generator() % 80);
+        Ties& target = i % 2 == 0 ? word_repository : other_repository;
+        target.insert("term", file_id, position);
+        expected[file_id].insert(position);
+    }
+
+    word_repository.merge(std::move(other_repository));
+    CheckPostings(word_repository, expected);
+
+    word_repository.SaveTies("columnar_trie.bin");
+    Ties read_repository("columnar_trie.bin");
+    CheckPostings(read_repository, expected);
+
+    EXPECT_EQ(read_repository.RemoveDocuments({0, 7, 39}), 3);
+    expected.erase(0);
+    expected.erase(7);
+    expected.erase(39);
+    CheckPostings(read_repository, expected);
+    EXPECT_EQ(read_repository.search("term").size(7), 0);
+
+    read_repository.insert("term", 7, 5);
+    expected[7].insert(5);
+    CheckPostings(read_repository, expected);
+
+    std::filesystem::remove("columnar_trie.bin");
+}
+
+TEST(IndexerTest, UpdateIndexer) {
+    std::filesystem::path test_dir = "test_update_dir";
+    std::filesystem::remove_all(test_dir);
+    std::filesystem::create_directory(test_dir);
+    CreateTestFile(test_dir / "a.cpp", "int alpha");
+    CreateTestFile(test_dir / "b.cpp", "int beta");
+    CreateTestFile(test_dir / "c.cpp", "int gamma");
+
+    {
+        Indexer<true> indexer;
+        indexer.StartIndexer(test_dir);
+    }
+
+    auto a_time = std::filesystem::last_write_time(test_dir / "a.cpp");
+    CreateTestFile(test_dir / "a.cpp", "int alpha");
+    std::filesystem::last_write_time(test_dir / "a.cpp", a_time + std::chrono::seconds(5));
+    CreateTestFile(test_dir / "b.cpp", "int beta2 delta");
+    std::filesystem::remove(test_dir / "c.cpp");
+    CreateTestFile(test_dir / "d.cpp", "int omega");
+
+    {
+        Indexer<true> indexer("trie.bin");
+        indexer.UpdateIndexer(test_dir);
+
+        EXPECT_EQ(indexer.CountDocuments(), 3);
+        EXPECT_EQ(indexer.CountTombstones(), 0);
+        EXPECT_EQ(indexer.StringIndex(1), (test_dir / "a.cpp").string());
+        EXPECT_EQ(indexer.StringIndex(4), (test_dir / "b.cpp").string());
+        EXPECT_EQ(indexer.StringIndex(5), (test_dir / "d.cpp").string());
+        EXPECT_EQ(indexer.DocumentLength(4), 3);
+        EXPECT_DOUBLE_EQ(indexer.AverageDocumentLength(), 7.0 / 3);
+        EXPECT_TRUE(indexer.SearchWord("beta").GetSortedKeys().empty());
+        EXPECT_TRUE(indexer.SearchWord("gamma").GetSortedKeys().empty());
+        EXPECT_EQ(indexer.SearchWord("int").GetSortedKeys(), std::vector<size_t>({1, 4, 5}));
+    }
+
+    MappedIndex mapped_index;
+    EXPECT_EQ(mapped_index.SearchWord("int").GetSortedKeys(), std::vector<uint64_t>({1, 4, 5}));
+    EXPECT_EQ(mapped_index.SearchWord("omega").GetSortedKeys(), std::vector<uint64_t>({5}));
+    EXPECT_EQ(mapped_index.SearchWord("beta"), mapped_index.end());
+    EXPECT_EQ(mapped_index.SearchWord("gamma"), mapped_index.end());
+
+    CreateTestFile(test_dir / "e.cpp", "int epsilon");
+    {
+        Indexer<true> indexer("trie.bin");
+        indexer.UpdateIndexer(test_dir);
+        EXPECT_EQ(indexer.SearchWord("epsilon").GetSortedKeys(), std::vector<size_t>({2}));
+    }
+
+    std::filesystem::remove_all(test_dir);
+}
+
+TEST(IndexerTest, UpdateIndexerTombstones) {
+    std::filesystem::path test_dir = "test_tombstone_dir";
+    std::filesystem::remove_all(test_dir);
+    std::filesystem::create_directory(test_dir);
+    for (size_t i = 0; i < 20; ++i) {
+        CreateTestFile(test_dir / ("f" + std::to_string(i + 10) + ".cpp"), "int value" + std::to_string(i));
+    }
+
+    {
+        Indexer<true> indexer;
+        indexer.StartIndexer(test_dir);
+    }
+
+    std::filesystem::remove(test_dir / "f10.cpp");
+    {
+        Indexer<true> indexer("trie.bin");
+        indexer.UpdateIndexer(test_dir);
+        EXPECT_EQ(indexer.CountTombstones(), 1);
+        EXPECT_EQ(indexer.CountDocuments(), 19);
+    }
+
+    Indexer<false> indexer_from_file("trie.bin");
+    EXPECT_TRUE(indexer_from_file.HasDeletedDocuments());
+    EXPECT_FALSE(indexer_from_file.ContainsDocument(1));
+    EXPECT_EQ(indexer_from_file.SearchWord("value0").GetSortedKeys(), std::vector<size_t>({1}));
+
+    MappedIndex mapped_index;
+    EXPECT_TRUE(mapped_index.SearchWord("value0").GetSortedKeys().empty());
+    EXPECT_EQ(mapped_index.SearchWord("int").GetSortedKeys().size(), 19);
+
+    std::filesystem::remove_all(test_dir);
+}
+
+TEST(SegmentedIndexTest, MergeMatchesMappedIndex) {
+    std::filesystem::path test_dir = "test_segmented_dir";
+    std::filesystem::path segments_dir = "test_segments";
+    std::filesystem::remove_all(test_dir);
+    std::filesystem::remove_all(segments_dir);
+    std::filesystem::create_directory(test_dir);
+    for (size_t i = 0; i < 14; ++i) {
+        std::string content;
+        for (size_t line = 0; line < 6; ++line) {
+            for (size_t j = 0; j < 5; ++j) {
+                content += array_words[(i * 11 + line * 5 + j * 3) % array_words.size()] + " ";
+            }
+            content += "\n";
+        }
+        CreateTestFile(test_dir / ("file" + std::to_string(i + 10) + ".cpp"), content);
+    }
+
+    {
+        Indexer<true> indexer;
+        indexer.StartIndexer(test_dir);
+    }
+
+    {
+        SegmentedIndexer indexer(segments_dir, 1);
+        indexer.StartIndexer(test_dir);
+        indexer.WaitMerges();
+        EXPECT_EQ(indexer.CountDocuments(), 14);
+        EXPECT_EQ(indexer.CountMerges(), 4);
+        EXPECT_EQ(indexer.CountSegments(), 2);
+    }
+
+    MappedIndex mapped_index;
+    SegmentedIndex segmented_index(segments_dir);
+    EXPECT_EQ(segmented_index.CountSegments(), 2);
+    EXPECT_EQ(segmented_index.CountDocuments(), mapped_index.CountDocuments());
+    EXPECT_DOUBLE_EQ(segmented_index.AverageDocumentLength(), mapped_index.AverageDocumentLength());
+
+    for (const std::string& word : array_words) {
+        auto mapped_word = mapped_index.SearchWord(word);
+        auto segmented_word = segmented_index.SearchWord(word);
+        ASSERT_EQ(mapped_word == mapped_index.end(), segmented_word == segmented_index.end());
+        if (mapped_word == mapped_index.end()) {
+            continue;
+        }
+
+        EXPECT_EQ(segmented_word.GetSortedKeys(), mapped_word.GetSortedKeys());
+        EXPECT_EQ(segmented_word.GetSortedFrequencies(), mapped_word.GetSortedFrequencies());
+        for (size_t index : mapped_word.GetSortedKeys()) {
+            EXPECT_EQ(std::vector<uint64_t>(segmented_word.GetStartArray(index), segmented_word.GetEndArray(index)),
+                      std::vector<uint64_t>(mapped_word.GetStartArray(index), mapped_word.GetEndArray(index)));
+            EXPECT_EQ(segmented_index.StringIndex(index), mapped_index.StringIndex(index));
+            EXPECT_EQ(segmented_index.DocumentLength(index), mapped_index.DocumentLength(index));
+        }
+    }
+    EXPECT_EQ(segmented_index.SearchWord("missingword"), segmented_index.end());
+    for (const char* pattern : {"a*", "*e", "*o*n"}) {
+        EXPECT_EQ(segmented_index.ExpandWildcard(pattern), mapped_index.ExpandWildcard(pattern));
+    }
+    for (const char* word : {"lemn", "tigr", "umbrela"}) {
+        std::vector<FuzzyTerm> segmented_terms = segmented_index.ExpandFuzzy(word, 2);
+        std::vector<FuzzyTerm> mapped_terms = mapped_index.ExpandFuzzy(word, 2);
+        ASSERT_EQ(segmented_terms.size(), mapped_terms.size());
+        for (size_t i = 0; i < mapped_terms.size(); ++i) {
+            EXPECT_EQ(segmented_terms[i].term, mapped_terms[i].term);
+            EXPECT_EQ(segmented_terms[i].distance, mapped_terms[i].distance);
+        }
+    }
+
+    std::filesystem::remove_all(test_dir);
+    std::filesystem::remove_all(segments_dir);
+}
+
+TEST(SegmentedIndexTest, UpdateIndexer) {
+    std::filesystem::path test_dir = "test_segmented_update_dir";
+    std::filesystem::path segments_dir = "test_segments_update";
+    std::filesystem::remove_all(test_dir);
+    std::filesystem::remove_all(segments_dir);
+    std::filesystem::create_directory(test_dir);
+    CreateTestFile(test_dir / "a.cpp", "int alpha");
+    CreateTestFile(test_dir / "b.cpp", "int beta");
+    CreateTestFile(test_dir / "c.cpp", "int gamma");
+
+    {
+        SegmentedIndexer indexer(segments_dir, 1);
+        indexer.StartIndexer(test_dir);
+    }
+
+    CreateTestFile(test_dir / "b.cpp", "int beta2 delta");
+    std::filesystem::remove(test_dir / "c.cpp");
+    CreateTestFile(test_dir / "d.cpp", "int omega");
+
+    {
+        SegmentedIndexer indexer(segments_dir, 1);
+        indexer.UpdateIndexer(test_dir);
+        indexer.WaitMerges();
+        EXPECT_EQ(indexer.CountDocuments(), 3);
+        EXPECT_EQ(indexer.CountMerges(), 1);
+    }
+
+    SegmentedIndex segmented_index(segments_dir);
+    EXPECT_EQ(segmented_index.CountDocuments(), 3);
+    EXPECT_DOUBLE_EQ(segmented_index.AverageDocumentLength(), 7.0 / 3);
+    EXPECT_EQ(segmented_index.SearchWord("int").GetSortedKeys(), std::vector<uint64_t>({1, 4, 5}));
+    EXPECT_TRUE(segmented_index.SearchWord("beta").GetSortedKeys().empty());
+    EXPECT_TRUE(segmented_index.SearchWord("gamma").GetSortedKeys().empty());
+    EXPECT_EQ(segmented_index.StringIndex(4), (test_dir / "b.cpp").string());
+    EXPECT_EQ(segmented_index.DocumentLength(4), 3);
+
+    std::filesystem::remove_all(test_dir);
+    std::filesystem::remove_all(segments_dir);
+}
+
+TEST(SegmentedIndexTest, RemoveSegments) {
+    std::filesystem::path test_dir = "test_segmented_remove_dir";
+    std::filesystem::path segments_dir = "test_segments_remove";
+    std::filesystem::remove_all(test_dir);
+    std::filesystem::remove_all(segments_dir);
+    std::filesystem::create_directory(test_dir);
+    std::filesystem::create_directory(segments_dir);
+    CreateTestFile(test_dir / "a.cpp", "int alpha");
+    CreateTestFile(segments_dir / "keep.txt", "keep");
+
+    EXPECT_THROW(SegmentedIndex::RemoveSegments(segments_dir), std::runtime_error);
+    EXPECT_TRUE(std::filesystem::exists(segments_dir / "keep.txt"));
+    std::filesystem::remove_all(segments_dir);
+
+    {
+        SegmentedIndexer indexer(segments_dir, 1);
+        indexer.StartIndexer(test_dir);
+    }
+    SegmentedIndex::RemoveSegments(segments_dir);
+    EXPECT_FALSE(std::filesystem::exists(segments_dir));
+    EXPECT_NO_THROW(SegmentedIndex::RemoveSegments(segments_dir));
+
+    std::filesystem::remove_all(test_dir);
+}
+
+TEST(PostingCodecTest, PositionsRoundTrip) {
+    std::mt19937_64 generator(7);
+
+    for (size_t count : {0, 1, 127, 128, 300}) {
+        std::vector<uint64_t> positions;
+        uint64_t line = 1;
+        uint64_t offset = 0;
+        for (size_t i = 0; i < count; ++i) {
+            line += generator() % 3;
+            offset += generator() % 50 + 1;
+            positions.push_back(PostingCodec::PackPosition(line, offset));
+        }
+
+        std::vector<uint8_t> encoded;
+        PostingCodec::EncodePositions(positions, encoded);
+
+        std::vector<uint64_t> decoded;
+        const uint8_t* input = PostingCodec::DecodePositions(encoded.data(), count, decoded);
+        EXPECT_EQ(decoded, positions);
+        EXPECT_EQ(input, encoded.data() + encoded.size());
+    }
+
+    uint64_t position = PostingCodec::PackPosition(12, 345);
+    EXPECT_EQ(PostingCodec::PositionLine(position), 12);
+    EXPECT_EQ(PostingCodec::PositionOffset(position), 345);
+}
+
+TEST(MappedIndexTest, PhraseQuery) {
+    std::filesystem::path test_dir = "test_phrase_dir";
+    std::filesystem::remove_all(test_dir);
+    std::filesystem::create_directory(test_dir);
+    CreateTestFile(test_dir / "a.cpp", "std unique_ptr p\nreturn std\nunique_ptr q");
+    CreateTestFile(test_dir / "b.cpp", "unique_ptr std\nstd shared_ptr\n");
+    CreateTestFile(test_dir / "c.cpp", "std vector\nint x = 0 ;\nunique_ptr");
+
+    {
+        Indexer<true> indexer;
+        indexer.StartIndexer(test_dir);
+    }
+
+    MappedIndex mapped_index;
+    std::unordered_map<std::string, std::vector<size_t>> file_words_and_indexes;
+    std::unordered_map<std::string, MappedIndex::iterator> iterators;
+    for (const char* word : {"std", "unique_ptr", "vector"}) {
+        auto iterator = mapped_index.SearchWord(word);
+        ASSERT_NE(iterator, mapped_index.end());
+        const auto& sorted_keys = iterator.GetSortedKeys();
+        file_words_and_indexes[word].assign(sorted_keys.begin(), sorted_keys.end());
+        iterators[word] = iterator;
+    }
+
+    auto std_word = iterators["std"];
+    size_t file_a = 1;
+    ASSERT_EQ(mapped_index.StringIndex(file_a), (test_dir / "a.cpp").string());
+    EXPECT_EQ(std::vector<uint64_t>(std_word.GetStartArray(file_a), std_word.GetEndArray(file_a)),
+              std::vector<uint64_t>({PostingCodec::PackPosition(1, 0), PostingCodec::PackPosition(2, 4)}));
+
+    ParserArgument::PositionsLookup positions_lookup = [&iterators](const std::string& word, size_t file_id,
+                                                                    std::vector<uint64_t>& offsets) {
+        offsets.clear();
+        const MappedIndex::iterator& iterator = iterators.at(word);
+        for (auto it = iterator.GetStartArray(file_id); it != iterator.GetEndArray(file_id); ++it) {
+            offsets.push_back(PostingCodec::PositionOffset(*it));
+        }
+    };
+    auto evaluate = [&](const std::string& expression) {
+        ParserArgument parser;
+        parser.CreateStackRequest(Searcher::TokenizeExpression(expression));
+        std::vector<std::string> names;
+        for (size_t file_id : parser.ExpressionCalculation(file_words_and_indexes, positions_lookup)) {
+            names.push_back(std::filesystem::path(mapped_index.StringIndex(file_id)).filename().string());
+        }
+        return names;
+    };
+
+    EXPECT_EQ(evaluate("\"std unique_ptr\""), std::vector<std::string>({"a.cpp"}));
+    EXPECT_EQ(evaluate("\"unique_ptr std\""), std::vector<std::string>({"b.cpp"}));
+    EXPECT_EQ(evaluate("std NEAR/1 unique_ptr"), std::vector<std::string>({"a.cpp", "b.cpp"}));
+    EXPECT_EQ(evaluate("std NEAR/7 unique_ptr"), std::vector<std::string>({"a.cpp", "b.cpp", "c.cpp"}));
+    EXPECT_EQ(evaluate("\"std vector\" OR \"std unique_ptr\""), std::vector<std::string>({"a.cpp", "c.cpp"}));
+    EXPECT_EQ(evaluate("\"std unique_ptr\" AND vector"), std::vector<std::string>());
+    EXPECT_THROW(evaluate("(std AND vector) NEAR unique_ptr"), std::invalid_argument);
+
+    std::filesystem::remove_all(test_dir);
+}
+
+TEST(WildcardTest, Match) {
+    EXPECT_TRUE(Wildcard::Match("uni*", "unique_ptr"));
+    EXPECT_TRUE(Wildcard::Match("*_ptr", "unique_ptr"));
+    EXPECT_TRUE(Wildcard::Match("u*_*r", "unique_ptr"));
+    EXPECT_TRUE(Wildcard::Match("*", ""));
+    EXPECT_TRUE(Wildcard::Match("a**b", "ab"));
+    EXPECT_FALSE(Wildcard::Match("*_ptr", "unique_ptrs"));
+    EXPECT_FALSE(Wildcard::Match("uni*", "un"));
+    EXPECT_FALSE(Wildcard::Match("a*b*c", "acb"));
+
+    EXPECT_EQ(Wildcard::LiteralPrefix("make_*_impl"), "make_");
+    EXPECT_EQ(Wildcard::LiteralSuffix("make_*_impl"), "_impl");
+    EXPECT_EQ(Wildcard::LiteralPrefix("*_impl"), "");
+    EXPECT_FALSE(Wildcard::IsWildcard("unique_ptr"));
+}
+
+size_t EditDistance(const std::string& lhs, const std::string& rhs) {
+    std::vector<size_t> previous(rhs.size() + 1);
+    std::vector<size_t> current(rhs.size() + 1);
+    for (size_t j = 0; j <= rhs.size(); ++j) {
+        previous[j] = j;
+    }
+    for (size_t i = 1; i <= lhs.size(); ++i) {
+        current[0] = i;
+        for (size_t j = 1; j <= rhs.size(); ++j) {
+            current[j] = std::min({previous[j] + 1, current[j - 1] + 1,
+                                   previous[j - 1] + (lhs[i - 1] == rhs[j - 1] ? 0 : 1)});
+        }
+        std::swap(previous, current);
+    }
+
+    return previous[rhs.size()];
+}
+
+TEST(LevenshteinAutomatonTest, MatchesEditDistance) {
+    std::mt19937_64 generator(11);
+    auto random_word = [&generator]() {
+        std::string word(generator() % 8, 'a');
+        for (char& symbol : word) {
+            symbol = static_cast<char>('a' + generator() % 3);
+        }
+        return word;
+    };
+
+    for (size_t max_distance = 0; max_distance <= LevenshteinAutomaton::kMaxDistance; ++max_distance) {
+        for (size_t i = 0; i < 500; ++i) {
+            std::string word = random_word();
+            std::string term = random_word();
+
+            LevenshteinAutomaton automaton(word, max_distance);
+            LevenshteinAutomaton::State state = automaton.Start();
+            LevenshteinAutomaton::State next;
+            bool can_match = true;
+            for (char symbol : term) {
+                automaton.Step(state, symbol, next);
+                std::swap(state, next);
+                can_match &= automaton.CanMatch(state);
+            }
+
+            size_t distance = EditDistance(word, term);
+            EXPECT_EQ(automaton.IsMatch(state), distance <= max_distance) << word << " " << term;
+            if (distance <= max_distance) {
+                EXPECT_TRUE(can_match);
+                EXPECT_EQ(automaton.Distance(state), distance);
+            }
+        }
+    }
+
+    std::string term;
+    size_t max_distance = 0;
+    EXPECT_TRUE(LevenshteinAutomaton::ParseFuzzy("vectr~1", term, max_distance));
+    EXPECT_EQ(term, "vectr");
+    EXPECT_EQ(max_distance, 1);
+    EXPECT_TRUE(LevenshteinAutomaton::ParseFuzzy("vectr~", term, max_distance));
+    EXPECT_EQ(max_distance, LevenshteinAutomaton::kMaxDistance);
+    EXPECT_FALSE(LevenshteinAutomaton::IsFuzzy("~vector"));
+    EXPECT_FALSE(LevenshteinAutomaton::IsFuzzy("a~b"));
+    EXPECT_THROW(LevenshteinAutomaton::IsFuzzy("vectr~3"), std::invalid_argument);
+}
+
+TEST(MappedIndexTest, FuzzyExpansion) {
+    std::filesystem::path test_dir = "test_fuzzy_dir";
+    std::filesystem::remove_all(test_dir);
+    std::filesystem::create_directory(test_dir);
+    CreateTestFile(test_dir / "a.cpp", "vector vectors\nvecto Sector\nvector");
+    CreateTestFile(test_dir / "b.cpp", "victor factor\nbector vec");
+
+    {
+        Indexer<true> indexer;
+        indexer.StartIndexer(test_dir);
+    }
+
+    MappedIndex mapped_index;
+    Indexer<false> indexer("trie.bin");
+    auto expand = [](const std::vector<FuzzyTerm>& fuzzy_terms) {
+        std::vector<std::pair<std::string, size_t>> terms;
+        for (const FuzzyTerm& fuzzy_term : fuzzy_terms) {
+            terms.emplace_back(fuzzy_term.term, fuzzy_term.distance);
+        }
+        return terms;
+    };
+    using Terms = std::vector<std::pair<std::string, size_t>>;
+
+    Terms vector_1 = {{"vector", 0}, {"bector", 1}, {"sector", 1}, {"vecto", 1}, {"vectors", 1}, {"victor", 1}};
+    EXPECT_EQ(expand(mapped_index.ExpandFuzzy("VECTOR", 1)), vector_1);
+    EXPECT_EQ(expand(indexer.ExpandFuzzy("vector", 1)), vector_1);
+
+    Terms vectr_2 = {{"vecto", 1}, {"vector", 1}, {"bector", 2}, {"sector", 2}, {"vec", 2}, {"vectors", 2}, {"victor", 2}};
+    EXPECT_EQ(expand(mapped_index.ExpandFuzzy("vectr", 2)), vectr_2);
+    EXPECT_EQ(expand(indexer.ExpandFuzzy("vectr", 2)), vectr_2);
+    EXPECT_EQ(expand(mapped_index.ExpandFuzzy("vectr", 2, 2)), Terms({{"vecto", 1}, {"vector", 1}}));
+    EXPECT_EQ(expand(mapped_index.ExpandFuzzy("vectr", 0)), Terms());
+    EXPECT_THROW(mapped_index.ExpandFuzzy("vectr", 3), std::invalid_argument);
+
+    std::filesystem::remove_all(test_dir);
+}
+
+TEST(MappedIndexTest, WildcardExpansion) {
+    std::filesystem::path test_dir = "test_wildcard_dir";
+    std::filesystem::remove_all(test_dir);
+    std::filesystem::create_directory(test_dir);
+    CreateTestFile(test_dir / "a.cpp", "unique_ptr make_unique\nshared_ptr unique_ptr\nfoo_impl");
+    CreateTestFile(test_dir / "b.cpp", "Weak_Ptr make_shared\nbar_impl unique_lock");
+    CreateTestFile(test_dir / "c.cpp", "ptr make_unique make_unique\nimpl");
+
+    {
+        Indexer<true> indexer;
+        indexer.StartIndexer(test_dir);
+    }
+
+    MappedIndex mapped_index;
+    Indexer<false> indexer("trie.bin");
+    using Terms = std::vector<std::string>;
+    const std::vector<std::pair<std::string, Terms>> expansions = {
+        {"*_ptr", {"shared_ptr", "unique_ptr", "weak_ptr"}},
+        {"MAKE_*", {"make_shared", "make_unique"}},
+        {"uni*", {"unique_lock", "unique_ptr"}},
+        {"*_impl", {"bar_impl", "foo_impl"}},
+        {"*impl", {"bar_impl", "foo_impl", "impl"}},
+        {"u*_*r", {"unique_ptr"}},
+        {"*a*e_*", {"make_shared", "make_unique"}},
+        {"zzz*", {}},
+        {"*zzz", {}},
+    };
+    for (const auto& [pattern, terms] : expansions) {
+        EXPECT_EQ(mapped_index.ExpandWildcard(pattern), terms) << pattern;
+        EXPECT_EQ(indexer.ExpandWildcard(pattern), terms) << pattern;
+    }
+    EXPECT_THROW(mapped_index.ExpandWildcard("*", 3), std::invalid_argument);
+    EXPECT_THROW(indexer.ExpandWildcard("*_*", 3), std::invalid_argument);
+
+    Indexer<false> cold_indexer(ParserArgument::WildcardLeveling({"make_*", "*_impl"}));
+    EXPECT_EQ(cold_indexer.ExpandWildcard("make_*"), Terms({"make_shared", "make_unique"}));
+    EXPECT_EQ(cold_indexer.ExpandWildcard("*_impl"), Terms({"bar_impl", "foo_impl"}));
+
+    std::vector<MappedIndex::iterator> iterators;
+    for (const std::string& term : mapped_index.ExpandWildcard("*ptr")) {
+        iterators.push_back(mapped_index.SearchWord(term));
+    }
+    ASSERT_EQ(mapped_index.StringIndex(1), (test_dir / "a.cpp").string());
+    TermUnion<MappedIndex::iterator> term_union(iterators);
+    std::vector<size_t> file_ids;
+    std::vector<size_t> frequencies;
+    term_union.GetPostings(file_ids, &frequencies);
+    EXPECT_EQ(file_ids, std::vector<size_t>({1, 2, 3}));
+    EXPECT_EQ(frequencies, std::vector<size_t>({3, 1, 1}));
+    EXPECT_EQ(term_union.size(1), 3);
+
+    std::vector<uint64_t> positions;
+    term_union.GetPositions(1, positions);
+    EXPECT_EQ(positions, std::vector<uint64_t>({PostingCodec::PackPosition(1, 0), PostingCodec::PackPosition(2, 2),
+                                                PostingCodec::PackPosition(2, 3)}));
+
+    std::filesystem::remove_all(test_dir);
+}
+
+TEST(ExternalIndexerTest, MatchesMappedIndex) {
+    std::filesystem::path test_dir = "test_external_dir";
+    std::filesystem::remove_all(test_dir);
+    std::filesystem::create_directory(test_dir);
+    for (size_t i = 0; i < 12; ++i) {
+        std::string content;
+        for (size_t line = 0; line < 20; ++line) {
+            for (size_t j = 0; j < 4; ++j) {
+                content += array_words[(i * 13 + line * 7 + j * 5) % array_words.size()] + " ";
+            }
+            content += "\n";
+        }
+        CreateTestFile(test_dir / ("file" + std::to_string(i + 10) + ".cpp"), content);
+    }
+
+    {
+        Indexer<true> indexer;
+        indexer.StartIndexer(test_dir);
+    }
+
+    std::filesystem::path scratch_dir = "test_scratch_dir";
+    std::filesystem::remove_all(scratch_dir);
+    std::filesystem::create_directories(scratch_dir / "runs");
+    CreateTestFile(scratch_dir / "runs" / "keep.txt", "keep");
+    {
+        ExternalIndexer indexer(4096, scratch_dir);
+        indexer.StartIndexer(test_dir, "external.map");
+        EXPECT_EQ(indexer.CountDocuments(), 12);
+        EXPECT_GT(indexer.CountRuns(), 2);
+    }
+    EXPECT_TRUE(std::filesystem::exists(scratch_dir / "runs" / "keep.txt"));
+    EXPECT_EQ(std::distance(std::filesystem::directory_iterator(scratch_dir), std::filesystem::directory_iterator()),
+              1);
+    std::filesystem::remove_all(scratch_dir);
+    EXPECT_FALSE(std::filesystem::exists(Indexer<true>::kFileNameTrie));
+
+    EXPECT_TRUE(std::filesystem::exists(Indexer<true>::kFileNameFileState));
+    EXPECT_TRUE(std::filesystem::exists(Indexer<true>::kFileNameDocumentLength));
+
+    IdDirectory external_directory;
+    std::ifstream file_id_directory(Indexer<true>::kFileNameIdDirectory, std::ios::binary);
+    external_directory.Read(file_id_directory);
+    EXPECT_EQ(external_directory.size(), 12);
+
+    MappedIndex mapped_index;
+    MappedIndex external_index("external.map");
+    EXPECT_EQ(external_index.CountDocuments(), mapped_index.CountDocuments());
+    EXPECT_DOUBLE_EQ(external_index.AverageDocumentLength(), mapped_index.AverageDocumentLength());
+
+    for (const std::string& word : array_words) {
+        auto mapped_word = mapped_index.SearchWord(word);
+        auto external_word = external_index.SearchWord(word);
+        ASSERT_EQ(mapped_word == mapped_index.end(), external_word == external_index.end());
+        if (mapped_word == mapped_index.end()) {
+            continue;
+        }
+
+        EXPECT_EQ(external_word.GetSortedKeys(), mapped_word.GetSortedKeys());
+        EXPECT_EQ(external_word.GetSortedFrequencies(), mapped_word.GetSortedFrequencies());
+        EXPECT_EQ(external_word.MaxScore(), mapped_word.MaxScore());
+        for (size_t index : mapped_word.GetSortedKeys()) {
+            EXPECT_EQ(std::vector<uint64_t>(external_word.GetStartArray(index), external_word.GetEndArray(index)),
+                      std::vector<uint64_t>(mapped_word.GetStartArray(index), mapped_word.GetEndArray(index)));
+            EXPECT_EQ(external_index.StringIndex(index), mapped_index.StringIndex(index));
+        }
+    }
+    EXPECT_EQ(external_index.SearchWord("missingword"), external_index.end());
+    for (const char* pattern : {"a*", "*e", "*o*n", "x*"}) {
+        EXPECT_EQ(external_index.ExpandWildcard(pattern), mapped_index.ExpandWildcard(pattern));
+    }
+
+    std::filesystem::remove("external.map");
+    std::filesystem::remove_all(test_dir);
+}
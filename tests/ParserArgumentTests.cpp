@@ -1,6 +1,14 @@
 #include <gtest/gtest.h>
 
+#include "ParserArgument/LruCache.hpp"
 #include "ParserArgument/ParserArgument.hpp"
+#include "ParserArgument/QueryPlan.hpp"
+#include "ParserArgument/SortedOperations.hpp"
+#include "ThreadPool/ThreadPool.hpp"
+
+#include <algorithm>
+#include <map>
+#include <random>
 
 TEST(ParserArgumentTest, HandlesEmptyInput) {
     std::vector<std::string> words;
@@ -249,4 +257,377 @@ TEST(GetWordsFromExpressionTest, EmptyExpression) {
     std::vector<std::string> expected = {};
     std::vector<std::string> result = ParserArgument::GetWordsFromExpression(expression);
     ASSERT_EQ(result, expected);
-}
\ No newline at end of file
+}
+TEST(ParserArgumentTest, RequestWithMissingOperator) {
+    ParserArgument parser;
+
+    std::vector<std::string> request = {"vector", "list"};
+    EXPECT_THROW(parser.CreateStackRequest(request), std::invalid_argument);
+}
+
+TEST(ParserArgumentTest, ExpressionWithMissingOperand) {
+    std::unordered_map<std::string, std::unordered_set<size_t>> file_words_and_indexes = {
+        {"for", {1, 2}}
+    };
+
+    ParserArgument parser;
+    parser.CreateStackRequest({"for", "AND"});
+
+    EXPECT_THROW(parser.ExpressionCalculation(file_words_and_indexes), std::invalid_argument);
+}
+
+TEST(ParserArgumentTest, ExpressionWithUnknownWord) {
+    std::unordered_map<std::string, std::unordered_set<size_t>> file_words_and_indexes = {
+        {"word1", {1, 2, 3}}
+    };
+
+    ParserArgument parser;
+    parser.SetPostfix({"word1", "word2", "OR"});
+    EXPECT_EQ(parser.ExpressionCalculation(file_words_and_indexes), std::unordered_set<size_t>({1, 2, 3}));
+
+    parser.SetPostfix({"word1", "word2", "AND"});
+    EXPECT_TRUE(parser.ExpressionCalculation(file_words_and_indexes).empty());
+}
+
+std::vector<size_t> RandomSortedList(std::mt19937_64& generator, size_t size, size_t max_value) {
+    std::uniform_int_distribution<size_t> distribution(0, max_value);
+    std::vector<size_t> list(size);
+    for (size_t& value : list) {
+        value = distribution(generator);
+    }
+    std::sort(list.begin(), list.end());
+    list.erase(std::unique(list.begin(), list.end()), list.end());
+    return list;
+}
+
+TEST(SortedOperationsTest, IntersectMatchesStd) {
+    std::mt19937_64 generator(42);
+    const std::vector<std::pair<size_t, size_t>> sizes = {{0, 10}, {1, 1}, {7, 9}, {100, 120}, {5, 5000}, {3000, 2500}};
+
+    for (const auto& [lhs_size, rhs_size] : sizes) {
+        std::vector<size_t> lhs = RandomSortedList(generator, lhs_size, 4 * (lhs_size + rhs_size));
+        std::vector<size_t> rhs = RandomSortedList(generator, rhs_size, 4 * (lhs_size + rhs_size));
+
+        std::vector<size_t> expected;
+        std::set_intersection(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), std::back_inserter(expected));
+
+        std::vector<size_t> result;
+        SortedOperations::Intersect(lhs, rhs, result);
+        EXPECT_EQ(result, expected);
+
+        SortedOperations::IntersectMerge(lhs, rhs, result);
+        EXPECT_EQ(result, expected);
+
+        SortedOperations::IntersectSimd(lhs, rhs, result);
+        EXPECT_EQ(result, expected);
+
+        SortedOperations::IntersectGalloping(lhs, rhs, result);
+        EXPECT_EQ(result, expected);
+        SortedOperations::IntersectGalloping(rhs, lhs, result);
+        EXPECT_EQ(result, expected);
+    }
+}
+
+TEST(SortedOperationsTest, UnionInPlace) {
+    std::vector<size_t> lhs = {1, 4, 6, 9};
+    std::vector<size_t> rhs = {2, 4, 9, 12};
+
+    SortedOperations::UnionInPlace(lhs, rhs);
+    EXPECT_EQ(rhs, std::vector<size_t>({1, 2, 4, 6, 9, 12}));
+}
+
+TEST(SortedOperationsTest, UnionManyMatchesStd) {
+    std::mt19937_64 generator(7);
+    std::vector<std::vector<size_t>> lists;
+    std::vector<std::vector<size_t>> list_weights;
+    for (size_t size : {0, 1, 30, 200, 200, 1000}) {
+        lists.push_back(RandomSortedList(generator, size, 1500));
+        list_weights.emplace_back();
+        for (size_t value : lists.back()) {
+            list_weights.back().push_back(value % 7 + 1);
+        }
+    }
+
+    std::map<size_t, size_t> expected;
+    std::vector<std::span<const size_t>> keys;
+    std::vector<std::span<const size_t>> weights;
+    for (size_t i = 0; i < lists.size(); ++i) {
+        for (size_t j = 0; j < lists[i].size(); ++j) {
+            expected[lists[i][j]] += list_weights[i][j];
+        }
+        keys.push_back(lists[i]);
+        weights.push_back(list_weights[i]);
+    }
+
+    std::vector<size_t> result;
+    std::vector<size_t> result_weights;
+    SortedOperations::UnionMany(keys, result, &weights, &result_weights);
+    ASSERT_EQ(result.size(), expected.size());
+    size_t i = 0;
+    for (const auto& [value, weight] : expected) {
+        EXPECT_EQ(result[i], value);
+        EXPECT_EQ(result_weights[i], weight);
+        ++i;
+    }
+
+    SortedOperations::UnionMany({}, result);
+    EXPECT_TRUE(result.empty());
+}
+
+TEST(ParserArgumentTest, SortedExpressionCalculation) {
+    std::unordered_map<std::string, std::vector<size_t>> file_words_and_indexes = {
+        {"word1", {1, 2, 3, 5, 8}},
+        {"word2", {2, 3, 4, 8}},
+        {"word3", {3, 8, 9}},
+        {"word4", {10}}
+    };
+
+    ParserArgument parser;
+    parser.CreateStackRequest({"word1", "AND", "word2", "AND", "(", "word3", "OR", "word4", ")"});
+    EXPECT_EQ(parser.ExpressionCalculation(file_words_and_indexes), std::vector<size_t>({3, 8}));
+
+    ParserArgument parser_or;
+    parser_or.CreateStackRequest({"word3", "OR", "word4", "OR", "word1", "AND", "word2"});
+    EXPECT_EQ(parser_or.ExpressionCalculation(file_words_and_indexes), std::vector<size_t>({2, 3, 8, 9, 10}));
+    EXPECT_EQ(file_words_and_indexes["word3"], std::vector<size_t>({3, 8, 9}));
+}
+
+TEST(ParserArgumentTest, PositionalOperatorPrecedence) {
+    ParserArgument parser;
+    parser.CreateStackRequest({"a", "AND", "b", "NEXT", "c", "OR", "d", "NEAR/3", "e"});
+    EXPECT_EQ(parser.GetPostfix(), std::vector<std::string>({"a", "b", "c", "NEXT", "AND", "d", "e", "NEAR/3", "OR"}));
+    EXPECT_FALSE(parser.IsDisjunction());
+
+    EXPECT_EQ(ParserArgument::NearDistance("NEAR/3"), 3);
+    EXPECT_EQ(ParserArgument::NearDistance("NEAR"), ParserArgument::kDefaultNearDistance);
+    EXPECT_EQ(ParserArgument::NearDistance("NEXT"), 1);
+    EXPECT_THROW(ParserArgument::NearDistance("NEAR/x"), std::invalid_argument);
+    EXPECT_TRUE(ParserArgument::IsOperation("NEAR/12"));
+    EXPECT_FALSE(ParserArgument::IsOperation("NEARBY"));
+}
+
+TEST(ParserArgumentTest, MatchPositions) {
+    std::vector<uint64_t> result;
+    ParserArgument::MatchPositions({1, 5, 9}, {2, 4, 10, 20}, 1, true, result);
+    EXPECT_EQ(result, std::vector<uint64_t>({2, 10}));
+
+    result.clear();
+    ParserArgument::MatchPositions({1, 5, 9}, {2, 4, 10, 20}, 1, false, result);
+    EXPECT_EQ(result, std::vector<uint64_t>({2, 4, 10}));
+
+    result.clear();
+    ParserArgument::MatchPositions({3, 7}, {7, 15}, 4, false, result);
+    EXPECT_EQ(result, std::vector<uint64_t>({7}));
+
+    result.clear();
+    ParserArgument::MatchPositions({7}, {7}, 3, false, result);
+    EXPECT_TRUE(result.empty());
+}
+
+TEST(ParserArgumentTest, NormalizedPostfix) {
+    auto normalize = [](const std::vector<std::string>& request) {
+        ParserArgument parser;
+        parser.CreateStackRequest(request);
+        return parser.GetNormalizedPostfix();
+    };
+
+    EXPECT_EQ(normalize({"b", "AND", "a"}), "a b AND");
+    EXPECT_EQ(normalize({"(", "a", ")", "AND", "b"}), normalize({"b", "AND", "a"}));
+    EXPECT_EQ(normalize({"a", "OR", "b", "AND", "c"}), normalize({"c", "AND", "b", "OR", "a"}));
+    EXPECT_NE(normalize({"a", "NEXT", "b"}), normalize({"b", "NEXT", "a"}));
+    EXPECT_NE(normalize({"a", "AND", "b", "OR", "c"}), normalize({"a", "AND", "(", "b", "OR", "c", ")"}));
+    EXPECT_THROW(normalize({"a", "AND"}), std::invalid_argument);
+}
+
+TEST(LruCacheTest, EvictsLeastRecentlyUsed) {
+    constexpr size_t kValueSize = 100;
+    constexpr size_t kEntrySize = 1 + kValueSize + LruCache<int>::kEntryOverhead;
+    LruCache<int> cache(3 * kEntrySize);
+
+    cache.Insert("a", 1, kValueSize);
+    cache.Insert("b", 2, kValueSize);
+    cache.Insert("c", 3, kValueSize);
+    ASSERT_NE(cache.Find("a"), nullptr);
+    cache.Insert("d", 4, kValueSize);
+
+    EXPECT_EQ(cache.Find("b"), nullptr);
+    EXPECT_EQ(*cache.Find("a"), 1);
+    EXPECT_EQ(*cache.Find("d"), 4);
+    EXPECT_EQ(cache.size(), 3);
+    EXPECT_EQ(cache.ByteSize(), 3 * kEntrySize);
+
+    cache.Insert("d", 5, kValueSize);
+    EXPECT_EQ(*cache.Find("d"), 5);
+    EXPECT_EQ(cache.size(), 3);
+
+    cache.Insert("e", 6, 4 * kEntrySize);
+    EXPECT_EQ(cache.Find("e"), nullptr);
+
+    EXPECT_EQ(cache.GetStats().count_hits, 4);
+    EXPECT_EQ(cache.GetStats().count_misses, 2);
+    EXPECT_EQ(cache.GetStats().count_evictions, 1);
+
+    cache.Clear();
+    EXPECT_EQ(cache.size(), 0);
+    EXPECT_EQ(cache.ByteSize(), 0);
+    EXPECT_EQ(cache.Find("a"), nullptr);
+    EXPECT_EQ(cache.GetStats().count_invalidations, 1);
+}
+
+std::vector<std::string> RandomExpression(std::mt19937_64& generator, const std::vector<std::string>& words,
+                                          size_t depth) {
+    if (depth == 0 || generator() % 3 == 0) {
+        return {words[generator() % words.size()]};
+    }
+
+    std::vector<std::string> expression = {"("};
+    std::vector<std::string> lhs = RandomExpression(generator, words, depth - 1);
+    std::vector<std::string> rhs = RandomExpression(generator, words, depth - 1);
+    expression.insert(expression.end(), lhs.begin(), lhs.end());
+    expression.push_back(generator() % 2 == 0 ? ParserArgument::kOperationAND : ParserArgument::kOperationOR);
+    expression.insert(expression.end(), rhs.begin(), rhs.end());
+    expression.push_back(")");
+    return expression;
+}
+
+TEST(ParserArgumentTest, SubexpressionCacheMatchesUncached) {
+    std::mt19937_64 generator(23);
+    std::unordered_map<std::string, std::vector<size_t>> file_words_and_indexes;
+    std::vector<std::string> words = {"a", "b", "c", "d", "e"};
+    for (const std::string& word : words) {
+        file_words_and_indexes[word] = RandomSortedList(generator, 40, 100);
+    }
+
+    ParserArgument::SubexpressionCache cache;
+    for (size_t i = 0; i < 300; ++i) {
+        std::vector<std::string> expression = RandomExpression(generator, words, 4);
+        ParserArgument parser;
+        parser.CreateStackRequest(expression);
+        ParserArgument cached_parser;
+        cached_parser.CreateStackRequest(expression);
+
+        EXPECT_EQ(cached_parser.ExpressionCalculation(file_words_and_indexes, nullptr, &cache),
+                  parser.ExpressionCalculation(file_words_and_indexes)) << cached_parser.GetNormalizedPostfix();
+    }
+    EXPECT_GT(cache.GetStats().count_hits, 0);
+
+    ParserArgument::SubexpressionCache shared_cache;
+    ParserArgument first;
+    first.CreateStackRequest({"(", "a", "OR", "b", ")", "AND", "c"});
+    first.ExpressionCalculation(file_words_and_indexes, nullptr, &shared_cache);
+    ParserArgument second;
+    second.CreateStackRequest({"d", "OR", "(", "b", "OR", "a", ")"});
+    second.ExpressionCalculation(file_words_and_indexes, nullptr, &shared_cache);
+    EXPECT_EQ(shared_cache.GetStats().count_hits, 1);
+}
+
+TEST(QueryPlanTest, MatchesExpressionCalculation) {
+    std::mt19937_64 generator(29);
+    std::unordered_map<std::string, std::vector<size_t>> file_words_and_indexes = {
+        {"a", RandomSortedList(generator, 200, 1000)},
+        {"b", RandomSortedList(generator, 50, 1000)},
+        {"c", RandomSortedList(generator, 500, 1000)},
+        {"d", RandomSortedList(generator, 5, 1000)},
+        {"e", {}}
+    };
+    std::vector<std::string> words = {"a", "b", "c", "d", "e", "missing"};
+
+    ParserArgument::SubexpressionCache cache;
+    for (size_t i = 0; i < 500; ++i) {
+        std::vector<std::string> expression = RandomExpression(generator, words, 5);
+        ParserArgument parser;
+        parser.CreateStackRequest(expression);
+        std::vector<size_t> expected = parser.ExpressionCalculation(file_words_and_indexes);
+
+        EXPECT_EQ(QueryPlan(parser, file_words_and_indexes).Execute(), expected);
+        EXPECT_EQ(QueryPlan(parser, file_words_and_indexes, nullptr, &cache).Execute(), expected);
+    }
+    EXPECT_GT(cache.GetStats().count_hits, 0);
+}
+
+TEST(QueryPlanTest, FlattensReordersAndShortCircuits) {
+    std::unordered_map<std::string, std::vector<size_t>> file_words_and_indexes = {
+        {"a", {1, 2, 3, 4, 5, 6}},
+        {"b", {2, 4, 6}},
+        {"c", {4, 5, 6, 7}},
+        {"d", {9}}
+    };
+    auto plan = [&file_words_and_indexes](const std::vector<std::string>& request) {
+        ParserArgument parser;
+        parser.CreateStackRequest(request);
+        return QueryPlan(parser, file_words_and_indexes);
+    };
+
+    QueryPlan and_plan = plan({"a", "AND", "(", "c", "AND", "b", ")"});
+    EXPECT_EQ(and_plan.Explain(), "AND(b[3], c[4], a[6])");
+    EXPECT_EQ(and_plan.Root().key, "a b AND c AND");
+    EXPECT_EQ(and_plan.Execute(), std::vector<size_t>({4, 6}));
+
+    QueryPlan or_plan = plan({"(", "a", "OR", "missing", ")", "OR", "d", "AND", "b", "OR", "c"});
+    EXPECT_EQ(or_plan.Explain(), "OR(a[6], AND(d[1], b[3]), c[4])");
+    EXPECT_EQ(or_plan.Execute(), std::vector<size_t>({1, 2, 3, 4, 5, 6, 7}));
+
+    QueryPlan empty_plan = plan({"a", "AND", "(", "b", "OR", "c", ")", "AND", "missing"});
+    EXPECT_EQ(empty_plan.Explain(), "EMPTY");
+    EXPECT_TRUE(empty_plan.Execute().empty());
+
+    EXPECT_EQ(plan({"missing", "OR", "b"}).Explain(), "b[3]");
+    EXPECT_EQ(plan({"b", "OR", "a"}).Root().key, plan({"a", "OR", "b"}).Root().key);
+}
+
+TEST(QueryPlanTest, PositionalOperands) {
+    std::unordered_map<std::string, std::vector<size_t>> file_words_and_indexes = {
+        {"a", {1, 2, 3}},
+        {"b", {1, 2, 3}},
+        {"c", {2, 3}}
+    };
+    std::map<std::pair<std::string, size_t>, std::vector<uint64_t>> offsets = {
+        {{"a", 1}, {1}}, {{"b", 1}, {5}},
+        {{"a", 2}, {1}}, {{"b", 2}, {2}}, {{"c", 2}, {3}},
+        {{"a", 3}, {4}}, {{"b", 3}, {5}}, {{"c", 3}, {9}}
+    };
+    ParserArgument::PositionsLookup positions_lookup = [&offsets](const std::string& word, size_t file_id,
+                                                                  std::vector<uint64_t>& result) {
+        result = offsets[{word, file_id}];
+    };
+
+    ParserArgument parser;
+    parser.CreateStackRequest({"a", "NEXT", "b", "NEXT", "c", "OR", "c", "AND", "a"});
+    QueryPlan query_plan(parser, file_words_and_indexes, positions_lookup);
+    EXPECT_EQ(query_plan.Explain(), "OR(a b NEXT c NEXT[1], AND(c[2], a[3]))");
+    EXPECT_EQ(query_plan.Execute(), parser.ExpressionCalculation(file_words_and_indexes, positions_lookup));
+    EXPECT_EQ(query_plan.Execute(), std::vector<size_t>({2, 3}));
+
+    ParserArgument invalid_parser;
+    invalid_parser.CreateStackRequest({"(", "a", "OR", "b", ")", "NEXT", "c"});
+    EXPECT_THROW(QueryPlan(invalid_parser, file_words_and_indexes, positions_lookup), std::invalid_argument);
+}
+
+TEST(QueryPlanTest, ParallelExecuteMatchesSequential) {
+    std::mt19937_64 generator(31);
+    std::unordered_map<std::string, std::vector<size_t>> file_words_and_indexes = {
+        {"a", RandomSortedList(generator, 150000, 300000)},
+        {"b", RandomSortedList(generator, 100000, 300000)},
+        {"c", RandomSortedList(generator, 2000, 300000)},
+        {"d", RandomSortedList(generator, 80000, 300000)},
+        {"e", {}}
+    };
+    std::vector<std::string> words = {"a", "b", "c", "d", "e"};
+
+    ThreadPool thread_pool(4);
+    for (size_t i = 0; i < 30; ++i) {
+        std::vector<std::string> expression = RandomExpression(generator, words, 3);
+        ParserArgument parser;
+        parser.CreateStackRequest(expression);
+
+        std::vector<size_t> expected = QueryPlan(parser, file_words_and_indexes).Execute();
+        EXPECT_EQ(QueryPlan(parser, file_words_and_indexes).Execute(&thread_pool), expected);
+    }
+
+    ParserArgument parser;
+    parser.CreateStackRequest({"a", "OR", "b"});
+    ParserArgument::SubexpressionCache cache;
+    std::vector<size_t> expected = QueryPlan(parser, file_words_and_indexes).Execute();
+    EXPECT_EQ(QueryPlan(parser, file_words_and_indexes, nullptr, &cache).Execute(&thread_pool), expected);
+    EXPECT_EQ(QueryPlan(parser, file_words_and_indexes, nullptr, &cache).Explain(), "a b OR[" + std::to_string(expected.size()) + "]");
+}
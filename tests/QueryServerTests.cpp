@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+
+#include "Server/QueryClient.hpp"
+#include "Server/QueryServer.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace {
+
+std::string TestSocketPath() {
+    return (std::filesystem::temp_directory_path() / ("query_server_test_" + std::to_string(getpid()) + ".sock")).string();
+}
+
+void AnswerEcho(const std::string& request, std::ostream& response) {
+    if (request.empty()) {
+        return;
+    }
+    if (request == "fail") {
+        throw std::runtime_error("failed request");
+    }
+    if (request.starts_with("slow")) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    response << "echo " << request << '\n' << QueryServer::kResponseEnd;
+}
+
+}
+
+TEST(QueryServerTest, PipelinedRequestsKeepOrder) {
+    std::string socket_path = TestSocketPath();
+    QueryServer server(socket_path, 4, AnswerEcho);
+    std::thread server_thread([&server] { server.Run(); });
+
+    constexpr size_t kCountClients = 4;
+    constexpr size_t kCountRequests = 200;
+    std::vector<std::thread> clients;
+    std::vector<size_t> count_matched(kCountClients, 0);
+    for (size_t client_id = 0; client_id < kCountClients; ++client_id) {
+        clients.emplace_back([&, client_id] {
+            QueryClient client(socket_path);
+            for (size_t i = 0; i < kCountRequests; ++i) {
+                client.Send((i % 7 == 0 ? "slow " : "query ") + std::to_string(client_id) + " " + std::to_string(i));
+                if (i % 50 == 0) {
+                    client.Send("");
+                }
+            }
+            for (size_t i = 0; i < kCountRequests; ++i) {
+                std::string expected = (i % 7 == 0 ? "echo slow " : "echo query ") + std::to_string(client_id) + " "
+                                       + std::to_string(i) + "\nend\n";
+                count_matched[client_id] += client.ReadResponse() == expected;
+            }
+        });
+    }
+    for (std::thread& client : clients) {
+        client.join();
+    }
+
+    server.Stop();
+    server_thread.join();
+
+    for (size_t count : count_matched) {
+        EXPECT_EQ(count, kCountRequests);
+    }
+    EXPECT_EQ(server.GetStats().count_connections, kCountClients);
+    EXPECT_EQ(server.GetStats().count_requests, kCountClients * (kCountRequests + kCountRequests / 50));
+}
+
+TEST(QueryServerTest, HandlerErrorsAreReported) {
+    std::string socket_path = TestSocketPath();
+    {
+        QueryServer server(socket_path, 2, AnswerEcho);
+        std::thread server_thread([&server] { server.Run(); });
+
+        QueryClient client(socket_path);
+        client.Send("fail");
+        client.Send("query");
+        EXPECT_EQ(client.ReadResponse(), "error: failed request\nend\n");
+        EXPECT_EQ(client.ReadResponse(), "echo query\nend\n");
+
+        server.Stop();
+        server_thread.join();
+    }
+
+    EXPECT_FALSE(std::filesystem::exists(socket_path));
+}
+
+TEST(QueryServerTest, AcceptPausesWhileOutOfDescriptors) {
+    std::string socket_path = TestSocketPath();
+    QueryServer server(socket_path, 2, AnswerEcho);
+    std::thread server_thread([&server] { server.Run(); });
+
+    rlimit old_limit{};
+    ASSERT_EQ(getrlimit(RLIMIT_NOFILE, &old_limit), 0);
+    rlimit low_limit = old_limit;
+    low_limit.rlim_cur = 64;
+    ASSERT_EQ(setrlimit(RLIMIT_NOFILE, &low_limit), 0);
+
+    std::vector<int> filler_fds;
+    for (int fd = dup(STDIN_FILENO); fd != -1; fd = dup(STDIN_FILENO)) {
+        filler_fds.push_back(fd);
+    }
+    ASSERT_FALSE(filler_fds.empty());
+    close(filler_fds.back());
+    filler_fds.pop_back();
+
+    std::string response;
+    {
+        QueryClient client(socket_path);
+        client.Send("query");
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+
+        for (int fd : filler_fds) {
+            close(fd);
+        }
+        setrlimit(RLIMIT_NOFILE, &old_limit);
+        response = client.ReadResponse();
+    }
+
+    server.Stop();
+    server_thread.join();
+
+    EXPECT_EQ(response, "echo query\nend\n");
+    EXPECT_GE(server.GetStats().count_accept_pauses, 1);
+    EXPECT_LE(server.GetStats().count_accept_pauses, 10);
+}
@@ -1,7 +1,10 @@
 #include <gtest/gtest.h>
 #include "Searcher/Searcher.hpp"
+#include "ThreadPool/ThreadPool.hpp"
 
+#include <algorithm>
 #include <fstream>
+#include <random>
 
 TEST(BM25Test, CalculationIDF) {
     EXPECT_NEAR(BM25::calculationIDF(1000, 10), 4.59511985, 1e-5);
@@ -128,4 +131,216 @@ TEST(SearcherTest, GetWordCountLargeFile) {
     largeFile.close();
 
     EXPECT_EQ(Searcher::GetWordCount(filename), numWords);
-}
\ No newline at end of file
+}
+
+TEST(SearcherTest, GetBM25FromDocumentLength) {
+    std::vector<std::string> request = {"missing/short.cpp", "missing/long.cpp"};
+    std::unordered_map<std::string, size_t> count_word_in_file = {
+        {"missing/short.cpp", 10},
+        {"missing/long.cpp", 1000}
+    };
+
+    Searcher searcher(request, count_word_in_file, 100.0, 50);
+
+    std::unordered_map<std::string, std::unordered_map<std::string, size_t>> data_word = {
+        {"word", {{"missing/short.cpp", 2}, {"missing/long.cpp", 2}}}
+    };
+
+    std::vector<std::pair<std::string, double>> result = searcher.GetBM25(data_word);
+
+    ASSERT_EQ(result.size(), 2);
+    EXPECT_EQ(result[0].first, "missing/short.cpp");
+    EXPECT_NEAR(result[0].second, BM25::calculation(50, 2, 2, 10, 100.0), 1e-9);
+    EXPECT_NEAR(result[1].second, BM25::calculation(50, 2, 2, 1000, 100.0), 1e-9);
+}
+
+std::vector<std::pair<size_t, double>> ExhaustiveTopBM25(const std::vector<TermPostings>& terms,
+        const std::vector<size_t>& document_length, double average_length_of_documents, size_t count_top,
+        const std::vector<size_t>* filter) {
+    std::vector<std::pair<size_t, double>> result;
+    for (size_t file_id = 0; file_id < document_length.size(); ++file_id) {
+        if (filter != nullptr && !std::binary_search(filter->begin(), filter->end(), file_id)) {
+            continue;
+        }
+
+        bool is_found = false;
+        double score = 0;
+        for (const TermPostings& term : terms) {
+            auto posting = std::lower_bound(term.file_ids.begin(), term.file_ids.end(), file_id);
+            if (posting != term.file_ids.end() && *posting == file_id) {
+                is_found = true;
+                score += term.weight * BM25::calculation(document_length.size(), term.file_ids.size(),
+                    term.frequencies[posting - term.file_ids.begin()], document_length[file_id],
+                    average_length_of_documents);
+            }
+        }
+        if (is_found) {
+            result.emplace_back(file_id, score);
+        }
+    }
+
+    std::sort(result.begin(), result.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.second > rhs.second || (lhs.second == rhs.second && lhs.first < rhs.first);
+    });
+    result.resize(std::min(result.size(), count_top));
+
+    return result;
+}
+
+TEST(SearcherTest, GetTopBM25MatchesExhaustive) {
+    const size_t count_documents = 2000;
+    std::mt19937_64 generator(7);
+
+    std::vector<size_t> document_length(count_documents);
+    for (size_t& length : document_length) {
+        length = generator() % 500 + 1;
+    }
+    double average_length_of_documents = 0;
+    for (size_t length : document_length) {
+        average_length_of_documents += length;
+    }
+    average_length_of_documents /= count_documents;
+    auto get_document_length = [&document_length](size_t file_id) {
+        return document_length[file_id];
+    };
+
+    std::vector<std::vector<size_t>> file_ids(4);
+    std::vector<std::vector<size_t>> frequencies(4);
+    const std::vector<size_t> density = {2, 3, 40, 1500};
+    for (size_t i = 0; i < file_ids.size(); ++i) {
+        for (size_t file_id = 0; file_id < count_documents; ++file_id) {
+            if (generator() % density[i] == 0) {
+                file_ids[i].push_back(file_id);
+                frequencies[i].push_back(generator() % 20 + 1);
+            }
+        }
+    }
+
+    Searcher searcher(average_length_of_documents, count_documents);
+    std::vector<TermPostings> terms;
+    for (size_t i = 0; i < file_ids.size(); ++i) {
+        terms.push_back(TermPostings{file_ids[i], frequencies[i],
+            searcher.GetMaxScore(file_ids[i], frequencies[i], get_document_length)});
+    }
+
+    std::vector<size_t> filter;
+    for (size_t file_id = 0; file_id < count_documents; file_id += 3) {
+        filter.push_back(file_id);
+    }
+
+    for (size_t count_top : {1, 10, 100, 5000}) {
+        for (const std::vector<size_t>* current_filter : std::vector<const std::vector<size_t>*>{nullptr, &filter}) {
+            std::vector<std::pair<size_t, double>> expected = ExhaustiveTopBM25(terms, document_length,
+                average_length_of_documents, count_top, current_filter);
+            EXPECT_EQ(searcher.GetTopBM25(terms, get_document_length, count_top, current_filter), expected);
+        }
+    }
+
+    const std::vector<double> weights = {1.0, BM25::FuzzyWeight(1), BM25::FuzzyWeight(2), 0.0};
+    for (size_t i = 0; i < terms.size(); ++i) {
+        terms[i].weight = weights[i];
+    }
+    for (size_t count_top : {1, 10, 100}) {
+        std::vector<std::pair<size_t, double>> expected = ExhaustiveTopBM25(terms, document_length,
+            average_length_of_documents, count_top, nullptr);
+        EXPECT_EQ(searcher.GetTopBM25(terms, get_document_length, count_top), expected);
+    }
+}
+
+TEST(SearcherTest, GetTopBM25SkipsDocuments) {
+    std::vector<size_t> document_length(10000, 100);
+    auto get_document_length = [&document_length](size_t file_id) {
+        return document_length[file_id];
+    };
+
+    std::vector<size_t> rare_ids = {10, 20, 5000};
+    std::vector<size_t> rare_frequencies = {5, 5, 5};
+    std::vector<size_t> common_ids;
+    for (size_t file_id = 0; file_id < 6000; ++file_id) {
+        common_ids.push_back(file_id);
+    }
+    std::vector<size_t> common_frequencies(common_ids.size(), 1);
+
+    Searcher searcher(100.0, document_length.size());
+    std::vector<TermPostings> terms = {
+        {rare_ids, rare_frequencies, searcher.GetMaxScore(rare_ids, rare_frequencies, get_document_length)},
+        {common_ids, common_frequencies, searcher.GetMaxScore(common_ids, common_frequencies, get_document_length)}
+    };
+
+    std::vector<std::pair<size_t, double>> result = searcher.GetTopBM25(terms, get_document_length, 2);
+    ASSERT_EQ(result.size(), 2);
+    EXPECT_EQ(result[0].first, 10);
+    EXPECT_EQ(result[1].first, 20);
+    EXPECT_LT(searcher.CountScoredDocuments(), 100);
+}
+
+TEST(TokenizeExpressionTest, PhraseTokenization) {
+    std::vector<std::string> expected_tokens = {"(", "(", "std", "NEXT", "unique_ptr", "NEXT", "p", ")", "OR", "x", ")"};
+    EXPECT_EQ(Searcher::TokenizeExpression("(\"std unique_ptr p\" OR x)"), expected_tokens);
+    EXPECT_EQ(Searcher::TokenizeExpression("\"single\""), std::vector<std::string>({"(", "single", ")"}));
+    EXPECT_THROW(Searcher::TokenizeExpression("\"std unique_ptr"), std::invalid_argument);
+}
+
+TEST(SearcherTest, ParallelScoringMatchesSequential) {
+    const size_t count_documents = 200000;
+    std::mt19937_64 generator(11);
+
+    std::vector<size_t> document_length(count_documents);
+    for (size_t& length : document_length) {
+        length = generator() % 500 + 1;
+    }
+    auto get_document_length = [&document_length](size_t file_id) {
+        return document_length[file_id];
+    };
+
+    std::vector<std::vector<size_t>> file_ids(3);
+    std::vector<std::vector<size_t>> frequencies(3);
+    const std::vector<size_t> density = {2, 5, 300};
+    for (size_t i = 0; i < file_ids.size(); ++i) {
+        for (size_t file_id = 0; file_id < count_documents; ++file_id) {
+            if (generator() % density[i] == 0) {
+                file_ids[i].push_back(file_id);
+                frequencies[i].push_back(generator() % 4 + 1);
+            }
+        }
+    }
+
+    Searcher searcher(250.0, count_documents);
+    std::vector<TermPostings> terms;
+    for (size_t i = 0; i < file_ids.size(); ++i) {
+        terms.push_back(TermPostings{file_ids[i], frequencies[i],
+            searcher.GetMaxScore(file_ids[i], frequencies[i], get_document_length)});
+    }
+    std::vector<size_t> filter;
+    for (size_t file_id = 0; file_id < count_documents; file_id += 7) {
+        filter.push_back(file_id);
+    }
+
+    ThreadPool thread_pool(4);
+    for (size_t count_top : {1, 10, 1000}) {
+        for (const std::vector<size_t>* current_filter : std::vector<const std::vector<size_t>*>{nullptr, &filter}) {
+            Searcher sequential(250.0, count_documents);
+            Searcher parallel(250.0, count_documents);
+            EXPECT_EQ(parallel.GetTopBM25(terms, get_document_length, count_top, current_filter, &thread_pool),
+                      sequential.GetTopBM25(terms, get_document_length, count_top, current_filter));
+            EXPECT_GE(parallel.CountScoredDocuments(), sequential.CountScoredDocuments());
+        }
+    }
+
+    std::vector<std::string> documents;
+    std::unordered_map<std::string, size_t> count_word_in_file;
+    for (size_t file_id = 0; file_id < 20000; ++file_id) {
+        documents.push_back("file" + std::to_string(file_id));
+        count_word_in_file[documents.back()] = document_length[file_id];
+    }
+    std::unordered_map<std::string, std::unordered_map<std::string, size_t>> data_word;
+    for (size_t i = 0; i < file_ids.size(); ++i) {
+        for (size_t j = 0; j < file_ids[i].size() && file_ids[i][j] < documents.size(); ++j) {
+            data_word["word" + std::to_string(i)][documents[file_ids[i][j]]] = frequencies[i][j];
+        }
+    }
+
+    Searcher sequential(documents, count_word_in_file, 250.0, count_documents);
+    Searcher parallel(documents, count_word_in_file, 250.0, count_documents);
+    EXPECT_EQ(parallel.GetBM25(data_word, {}, &thread_pool), sequential.GetBM25(data_word));
+}
@@ -0,0 +1,125 @@
+#include <gtest/gtest.h>
+
+#include "ThreadPool/BoundedQueue.hpp"
+#include "ThreadPool/ThreadPool.hpp"
+
+#include <atomic>
+
+TEST(ThreadPoolTest, RunsAllTasks) {
+    ThreadPool thread_pool(4);
+    std::atomic<size_t> sum = 0;
+
+    for (size_t i = 1; i <= 1000; ++i) {
+        thread_pool.Submit([&sum, i] { sum += i; });
+    }
+    thread_pool.Wait();
+
+    EXPECT_EQ(sum, 500500);
+}
+
+TEST(ThreadPoolTest, CurrentWorkerInsideTask) {
+    ThreadPool thread_pool(3);
+    std::vector<size_t> workers(100, ThreadPool::kNotWorker);
+
+    for (size_t i = 0; i < workers.size(); ++i) {
+        thread_pool.Submit([&workers, i] { workers[i] = ThreadPool::CurrentWorker(); });
+    }
+    thread_pool.Wait();
+
+    EXPECT_EQ(ThreadPool::CurrentWorker(), ThreadPool::kNotWorker);
+    for (size_t worker : workers) {
+        EXPECT_LT(worker, thread_pool.Size());
+    }
+}
+
+TEST(ThreadPoolTest, NestedSubmit) {
+    ThreadPool thread_pool(2);
+    std::atomic<size_t> count = 0;
+
+    for (size_t i = 0; i < 10; ++i) {
+        thread_pool.Submit([&thread_pool, &count] {
+            for (size_t j = 0; j < 10; ++j) {
+                thread_pool.Submit([&count] { ++count; });
+            }
+        });
+    }
+    thread_pool.Wait();
+
+    EXPECT_EQ(count, 100);
+}
+
+TEST(ThreadPoolTest, RethrowsTaskException) {
+    ThreadPool thread_pool(2);
+
+    thread_pool.Submit([] { throw std::runtime_error("task failed"); });
+
+    EXPECT_THROW(thread_pool.Wait(), std::runtime_error);
+}
+
+TEST(BoundedQueueTest, PreservesOrderUnderBackpressure) {
+    BoundedQueue<size_t> queue(4);
+    std::thread producer([&queue] {
+        for (size_t i = 0; i < 10000; ++i) {
+            queue.Push(size_t(i));
+        }
+        queue.Close();
+    });
+
+    size_t expected = 0;
+    size_t value = 0;
+    while (queue.Pop(value)) {
+        EXPECT_EQ(value, expected++);
+    }
+    producer.join();
+
+    EXPECT_EQ(expected, 10000);
+    EXPECT_EQ(queue.Capacity(), 4);
+}
+
+TEST(BoundedQueueTest, CancelUnblocksProducer) {
+    BoundedQueue<size_t> queue(2);
+    std::atomic<size_t> count_pushed = 0;
+    std::thread producer([&queue, &count_pushed] {
+        while (queue.Push(size_t(count_pushed))) {
+            ++count_pushed;
+        }
+    });
+
+    size_t value = 0;
+    EXPECT_TRUE(queue.Pop(value));
+    queue.Cancel();
+    producer.join();
+
+    EXPECT_LE(count_pushed, 3);
+}
+
+TEST(ThreadPoolTest, ParallelFor) {
+    ThreadPool thread_pool(3);
+    std::vector<size_t> values(100, 0);
+    thread_pool.ParallelFor(values.size(), [&values](size_t i) { values[i] = i * i; });
+    for (size_t i = 0; i < values.size(); ++i) {
+        EXPECT_EQ(values[i], i * i);
+    }
+
+    EXPECT_THROW(thread_pool.ParallelFor(10, [](size_t i) {
+        if (i == 7) {
+            throw std::runtime_error("task failed");
+        }
+    }), std::runtime_error);
+
+    std::vector<size_t> sequential(5, 0);
+    ParallelFor(nullptr, sequential.size(), [&sequential](size_t i) { sequential[i] = i + 1; });
+    EXPECT_EQ(sequential, std::vector<size_t>({1, 2, 3, 4, 5}));
+}
+
+TEST(ThreadPoolTest, ParallelForFromAnotherPool) {
+    ThreadPool outer_pool(4);
+    ThreadPool inner_pool(2);
+    std::atomic<size_t> sum = 0;
+
+    outer_pool.ParallelFor(8, [&inner_pool, &sum](size_t i) {
+        inner_pool.ParallelFor(10, [&sum, i](size_t j) { sum += i * 10 + j; });
+    });
+
+    EXPECT_EQ(sum, 3160);
+}
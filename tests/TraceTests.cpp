@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+
+#include "Trace/Trace.hpp"
+
+#include <sstream>
+
+class TraceTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        Trace::Reset();
+    }
+
+    void TearDown() override {
+        Trace::Enable(false);
+        Trace::Reset();
+    }
+};
+
+TEST_F(TraceTest, DisabledRecordsNothing) {
+    Trace::Enable(false);
+    {
+        Trace::ScopedTimer timer(Trace::Phase::kScoring);
+    }
+    Trace::Add(Trace::Counter::kScored, 5);
+
+    EXPECT_EQ(Trace::GetHistogram(Trace::Phase::kScoring).count, 0);
+    EXPECT_EQ(Trace::TotalCounter(Trace::Counter::kScored), 0);
+}
+
+TEST_F(TraceTest, QueryBreakdown) {
+    Trace::Enable(true);
+    Trace::BeginQuery();
+    Trace::Record(Trace::Phase::kTermLookup, 1500000);
+    Trace::Record(Trace::Phase::kTermLookup, 500000);
+    Trace::Add(Trace::Counter::kPostings, 42);
+
+    EXPECT_EQ(Trace::QueryNanoseconds(Trace::Phase::kTermLookup), 2000000);
+    EXPECT_EQ(Trace::QueryCounter(Trace::Counter::kPostings), 42);
+
+    std::ostringstream out;
+    Trace::PrintQuery(out);
+    EXPECT_EQ(out.str(), "trace: term lookup 2 ms, postings 42\n");
+
+    Trace::BeginQuery();
+    EXPECT_EQ(Trace::QueryNanoseconds(Trace::Phase::kTermLookup), 0);
+    EXPECT_EQ(Trace::TotalCounter(Trace::Counter::kPostings), 42);
+}
+
+TEST_F(TraceTest, StoppedTimerRecordsOnce) {
+    Trace::Enable(true);
+    {
+        Trace::ScopedTimer timer(Trace::Phase::kPrinting);
+        timer.Stop();
+    }
+
+    EXPECT_EQ(Trace::GetHistogram(Trace::Phase::kPrinting).count, 1);
+}
+
+TEST_F(TraceTest, HistogramPercentiles) {
+    Trace::Enable(true);
+    for (uint64_t i = 1; i <= 100; ++i) {
+        Trace::Record(Trace::Phase::kQuery, i * 1000);
+    }
+
+    const Trace::Histogram& histogram = Trace::GetHistogram(Trace::Phase::kQuery);
+    EXPECT_EQ(histogram.count, 100);
+    EXPECT_EQ(histogram.total_nanoseconds, 5050000);
+    EXPECT_EQ(histogram.max_nanoseconds, 100000);
+
+    uint64_t p50 = histogram.Percentile(0.5);
+    EXPECT_GE(p50, 50000);
+    EXPECT_LT(p50, 2 * 50000);
+    EXPECT_LE(histogram.Percentile(0.5), histogram.Percentile(0.9));
+    EXPECT_LE(histogram.Percentile(0.9), histogram.Percentile(0.99));
+    EXPECT_EQ(histogram.Percentile(1.0), 100000);
+}